@@ -0,0 +1,176 @@
+// Bounding volumes of meshes, and the world bounds of the draws of a scene
+
+#include <algorithm>
+#include <cmath>
+#include "Bounds.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BOUNDS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// the sphere is not the smallest one, but it is tight for the symmetric
+// shapes generated here and needs only two passes
+///////////////////////////////////////////////////////////////////////////////
+void computeBounds(const float* positions, int positionStride, std::size_t vertexCount,
+    BoundingBox& box, BoundingSphere& sphere)
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        box.minCorner[k] = box.maxCorner[k] = 0.0f;
+        sphere.center[k] = 0.0f;
+    }
+    sphere.radius = 0.0f;
+    if (vertexCount == 0)
+        return;
+
+    for (int k = 0; k < 3; ++k)
+        box.minCorner[k] = box.maxCorner[k] = positions[k];
+    for (std::size_t i = 1; i < vertexCount; ++i)
+    {
+        const float* p = positions + i * positionStride;
+        for (int k = 0; k < 3; ++k)
+        {
+            box.minCorner[k] = std::min(box.minCorner[k], p[k]);
+            box.maxCorner[k] = std::max(box.maxCorner[k], p[k]);
+        }
+    }
+
+    float radius2 = 0.0f;
+    for (int k = 0; k < 3; ++k)
+        sphere.center[k] = (box.minCorner[k] + box.maxCorner[k]) * 0.5f;
+    for (std::size_t i = 0; i < vertexCount; ++i)
+    {
+        const float* p = positions + i * positionStride;
+        float dx = p[0] - sphere.center[0], dy = p[1] - sphere.center[1], dz = p[2] - sphere.center[2];
+        radius2 = std::max(radius2, dx * dx + dy * dy + dz * dz);
+    }
+    sphere.radius = sqrtf(radius2);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// the centre goes through the whole matrix, the radius only through the
+// longest of the 3 axes
+///////////////////////////////////////////////////////////////////////////////
+BoundingSphere transformBoundingSphere(const BoundingSphere& sphere, const glm::mat4& model)
+{
+    glm::vec4 center = model * glm::vec4(sphere.center[0], sphere.center[1], sphere.center[2], 1.0f);
+    float scale2 = std::max(glm::dot(glm::vec3(model[0]), glm::vec3(model[0])),
+        std::max(glm::dot(glm::vec3(model[1]), glm::vec3(model[1])), glm::dot(glm::vec3(model[2]), glm::vec3(model[2]))));
+
+    // an affine matrix may still scale w, e.g. glm::mat4(2.0f) as a start
+    float w = center.w;
+    BoundingSphere transformed = { { center.x / w, center.y / w, center.z / w }, sphere.radius * sqrtf(scale2) / fabsf(w) };
+    return transformed;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// DrawBoundsList
+///////////////////////////////////////////////////////////////////////////////
+void DrawBoundsList::clear()
+{
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    radii.clear();
+}
+
+
+
+std::size_t DrawBoundsList::add(const BoundingSphere& localSphere, const glm::mat4& model)
+{
+    centerX.push_back(0.0f);
+    centerY.push_back(0.0f);
+    centerZ.push_back(0.0f);
+    radii.push_back(0.0f);
+    set(radii.size() - 1, localSphere, model);
+    return radii.size() - 1;
+}
+
+
+
+void DrawBoundsList::set(std::size_t draw, const BoundingSphere& localSphere, const glm::mat4& model)
+{
+    BoundingSphere sphere = transformBoundingSphere(localSphere, model);
+    centerX[draw] = sphere.center[0];
+    centerY[draw] = sphere.center[1];
+    centerZ[draw] = sphere.center[2];
+    radii[draw] = sphere.radius;
+}
+
+
+
+BoundingSphere DrawBoundsList::get(std::size_t draw) const
+{
+    BoundingSphere sphere = { { centerX[draw], centerY[draw], centerZ[draw] }, radii[draw] };
+    return sphere;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// a draw is outside if, for some plane, the signed distance of its centre is
+// below -radius; SSE2 takes 4 draws per plane test, the rest are done one by
+// one with the same operations, so both give the same answer
+///////////////////////////////////////////////////////////////////////////////
+std::size_t DrawBoundsList::cull(const Frustum& frustum, std::vector<unsigned char>& visible) const
+{
+    std::size_t count = radii.size();
+    visible.resize(count);
+
+    std::size_t i = 0;
+#ifdef BOUNDS_SSE2
+    __m128 planeX[FRUSTUM_PLANE_COUNT], planeY[FRUSTUM_PLANE_COUNT];
+    __m128 planeZ[FRUSTUM_PLANE_COUNT], planeW[FRUSTUM_PLANE_COUNT];
+    for (int p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+    {
+        const glm::vec4& plane = frustum.getPlane(p);
+        planeX[p] = _mm_set1_ps(plane.x);
+        planeY[p] = _mm_set1_ps(plane.y);
+        planeZ[p] = _mm_set1_ps(plane.z);
+        planeW[p] = _mm_set1_ps(plane.w);
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(&centerX[i]);
+        __m128 y = _mm_loadu_ps(&centerY[i]);
+        __m128 z = _mm_loadu_ps(&centerZ[i]);
+        __m128 minusRadius = _mm_sub_ps(zero, _mm_loadu_ps(&radii[i]));
+
+        __m128 outside = zero;
+        for (int p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+        {
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+                _mm_mul_ps(planeZ[p], z)), planeW[p]);
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(d, minusRadius));
+        }
+
+        int mask = _mm_movemask_ps(outside);
+        for (int k = 0; k < 4; ++k)
+            visible[i + k] = (mask >> k & 1) ? 0 : 1;
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        bool outside = false;
+        for (int p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+        {
+            const glm::vec4& plane = frustum.getPlane(p);
+            float d = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w;
+            outside = outside || d < 0.0f - radii[i];
+        }
+        visible[i] = outside ? 0 : 1;
+    }
+
+    return (std::size_t)std::count(visible.begin(), visible.end(), (unsigned char)1);
+}
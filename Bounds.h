@@ -0,0 +1,64 @@
+#pragma once
+// Bounding volumes of meshes, and the world bounds of the draws of a scene
+// a mesh gets an axis-aligned box and a sphere around the box centre, in
+// model space; the draws keep their world space spheres in DrawBoundsList, one
+// array per component, so the frustum test runs on 4 draws at a time (SSE2)
+// and the visible ones are known before anything is drawn
+
+#ifndef GEOMETRY_BOUNDS_H
+#define GEOMETRY_BOUNDS_H
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Frustum.h"
+
+// plain data, stored as is in mesh files
+struct BoundingBox
+{
+    float minCorner[3];
+    float maxCorner[3];
+};
+
+struct BoundingSphere
+{
+    float center[3];
+    float radius;
+};
+
+// box of the positions, and the sphere around its centre through the farthest one
+// positions: 3 floats per vertex with the given stride in floats
+void computeBounds(const float* positions, int positionStride, std::size_t vertexCount,
+    BoundingBox& box, BoundingSphere& sphere);
+
+// model space sphere moved to world space; the radius grows by the largest
+// axis scale of the model matrix, so it still encloses with non-uniform scales
+BoundingSphere transformBoundingSphere(const BoundingSphere& sphere, const glm::mat4& model);
+
+
+
+// world space bounding spheres of draws, as a structure of arrays
+class DrawBoundsList
+{
+public:
+    void clear();
+
+    // add the bounds of a draw, returns the index of the draw
+    std::size_t add(const BoundingSphere& localSphere, const glm::mat4& model);
+    void set(std::size_t draw, const BoundingSphere& localSphere, const glm::mat4& model);   // after the draw moved
+    BoundingSphere get(std::size_t draw) const;
+    std::size_t getCount() const { return radii.size(); }
+
+    // visible[i] = 1 if draw i may be visible, 0 if its sphere is entirely
+    // outside one of the planes; returns the # of visible draws
+    // planes in world space, e.g. Frustum(projection * view)
+    std::size_t cull(const Frustum& frustum, std::vector<unsigned char>& visible) const;
+
+private:
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> radii;
+};
+
+#endif
@@ -4,23 +4,23 @@
 #include <windows.h>    // include windows.h to avoid thousands of compile errors even though this class is not depending on Windows
 #endif
 
-#ifdef __APPLE__
-#include <OpenGL/gl.h>
-#else
-#include <GL/gl.h>
-#include <GL/glu.h>
-#endif
+#include <GL/glew.h>
 
 #include <iostream>
 #include <iomanip>
 #include <cmath>
 #include "Cylinder.h"
+#include "MeshBuilder.h"
+#include "SinCos.h"
+#include "ThreadPool.h"
 
 
 
 // constants //////////////////////////////////////////////////////////////////
 const int MIN_SECTOR_COUNT = 3;
 const int MIN_STACK_COUNT = 1;
+const unsigned int MIN_PARALLEL_VERTEX_COUNT = 64 * 1024;   // smaller meshes build faster serially
+enum VertexPart { PART_SIDE, PART_BASE, PART_TOP };         // see getVertexParts()
 
 
 
@@ -28,7 +28,8 @@ const int MIN_STACK_COUNT = 1;
 // ctor
 ///////////////////////////////////////////////////////////////////////////////
 Cylinder::Cylinder(float baseRadius, float topRadius, float height, int sectors,
-    int stacks, bool smooth) : interleavedStride(32)
+    int stacks, bool smooth, ThreadPool* threadPool)
+    : threadPool(threadPool)
 {
     set(baseRadius, topRadius, height, sectors, stacks, smooth);
 }
@@ -55,28 +56,43 @@ void Cylinder::set(float baseRadius, float topRadius, float height, int sectors,
     // generate unit circle vertices first
     buildUnitCircleVertices();
 
-    if (smooth)
-        buildVerticesSmooth();
-    else
-        buildVerticesFlat();
+    buildVertices();
+    applyStorage();
 }
 
+// radius/height setters move the existing vertices in place; a radius or
+// height of 0 leaves nothing to scale from, so it is rebuilt instead
 void Cylinder::setBaseRadius(float radius)
 {
-    if (this->baseRadius != radius)
+    if (this->baseRadius == radius)
+        return;
+
+    if (this->baseRadius == 0 || height == 0)
         set(radius, topRadius, height, sectorCount, stackCount, smooth);
+    else
+        updateRadii(radius, topRadius);
 }
 
 void Cylinder::setTopRadius(float radius)
 {
-    if (this->topRadius != radius)
+    if (this->topRadius == radius)
+        return;
+
+    if (this->topRadius == 0 || height == 0)
         set(baseRadius, radius, height, sectorCount, stackCount, smooth);
+    else
+        updateRadii(baseRadius, radius);
 }
 
 void Cylinder::setHeight(float height)
 {
-    if (this->height != height)
+    if (this->height == height)
+        return;
+
+    if (this->height == 0)
         set(baseRadius, topRadius, height, sectorCount, stackCount, smooth);
+    else
+        updateHeight(height);
 }
 
 void Cylinder::setSectorCount(int sectors)
@@ -97,10 +113,48 @@ void Cylinder::setSmooth(bool smooth)
         return;
 
     this->smooth = smooth;
-    if (smooth)
-        buildVerticesSmooth();
-    else
-        buildVerticesFlat();
+    buildVertices();
+    applyStorage();
+}
+
+void Cylinder::setThreadPool(ThreadPool* pool)
+{
+    threadPool = pool;
+}
+
+
+float Cylinder::getBoundingRadius() const
+{
+    float radius = baseRadius > topRadius ? baseRadius : topRadius;
+    return sqrtf(radius * radius + height * height * 0.25f);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// side, base and top are optimized and split into meshlets separately, so
+// drawSide()/drawBase()/drawTop() still find them at the same ranges; the
+// lines come from the side only
+///////////////////////////////////////////////////////////////////////////////
+std::vector<unsigned int> Cylinder::getIndexParts() const
+{
+    std::vector<unsigned int> parts(4);
+    parts[0] = 0;
+    parts[1] = baseIndex;
+    parts[2] = topIndex;
+    parts[3] = (unsigned int)indices.size();
+    return parts;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// bounds and normal cones of the meshlets after the vertices moved
+///////////////////////////////////////////////////////////////////////////////
+void Cylinder::updateMeshletBounds()
+{
+    for (std::size_t i = 0; i < meshlets.size(); ++i)
+        computeMeshletBounds(meshlets[i], indices.data(), vertices.data(), 3);
 }
 
 
@@ -127,143 +181,221 @@ void Cylinder::printSelf() const
 
 
 ///////////////////////////////////////////////////////////////////////////////
-// draw a cylinder in VertexArray mode
-// OpenGL RC must be set before calling it
+// draw side of cylinder only
 ///////////////////////////////////////////////////////////////////////////////
-void Cylinder::draw() const
+void Cylinder::drawSide() const
 {
-    // interleaved array
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glEnableClientState(GL_NORMAL_ARRAY);
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-    glVertexPointer(3, GL_FLOAT, interleavedStride, &interleavedVertices[0]);
-    glNormalPointer(GL_FLOAT, interleavedStride, &interleavedVertices[3]);
-    glTexCoordPointer(2, GL_FLOAT, interleavedStride, &interleavedVertices[6]);
-
-    glDrawElements(GL_TRIANGLES, (unsigned int)indices.size(), GL_UNSIGNED_INT, indices.data());
-
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableClientState(GL_NORMAL_ARRAY);
-    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    drawRange(0, baseIndex);
 }
 
 
 
 ///////////////////////////////////////////////////////////////////////////////
-// draw side of cylinder only
+// draw base and top only
 ///////////////////////////////////////////////////////////////////////////////
-void Cylinder::drawSide() const
+void Cylinder::drawBase() const
+{
+    drawRange(baseIndex, baseIndexCount);
+}
+
+void Cylinder::drawTop() const
 {
-    // interleaved array
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glEnableClientState(GL_NORMAL_ARRAY);
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-    glVertexPointer(3, GL_FLOAT, interleavedStride, &interleavedVertices[0]);
-    glNormalPointer(GL_FLOAT, interleavedStride, &interleavedVertices[3]);
-    glTexCoordPointer(2, GL_FLOAT, interleavedStride, &interleavedVertices[6]);
-
-    glDrawElements(GL_TRIANGLES, baseIndex, GL_UNSIGNED_INT, indices.data());
-
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableClientState(GL_NORMAL_ARRAY);
-    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    drawRange(topIndex, topIndexCount);
 }
 
 
 
 ///////////////////////////////////////////////////////////////////////////////
-// draw base and top only
+// scale the rings of the side and the rims of the caps to the new radii, then
+// tilt the side normals to the new slope; tex coords and indices stay
+// a side vertex finds its ring from its tex coord t = 1 - stack / stackCount,
+// so this works in any vertex order (after optimize() too)
 ///////////////////////////////////////////////////////////////////////////////
-void Cylinder::drawBase() const
+void Cylinder::updateRadii(float baseRadius, float topRadius)
 {
-    // interleaved array
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glEnableClientState(GL_NORMAL_ARRAY);
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-    glVertexPointer(3, GL_FLOAT, interleavedStride, &interleavedVertices[0]);
-    glNormalPointer(GL_FLOAT, interleavedStride, &interleavedVertices[3]);
-    glTexCoordPointer(2, GL_FLOAT, interleavedStride, &interleavedVertices[6]);
-
-    unsigned int indexCount = ((unsigned int)indices.size() - baseIndex) / 2;
-    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, &indices[baseIndex]);
-
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableClientState(GL_NORMAL_ARRAY);
-    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    restoreArrays();
+
+    // the cap rims follow the same rule as the rings: a collapsed cap has lost
+    // its directions, and one that stays collapsed scales by 0, not 0 / 0
+    if ((this->baseRadius == 0 && baseRadius != 0) || (this->topRadius == 0 && topRadius != 0))
+    {
+        set(baseRadius, topRadius, height, sectorCount, stackCount, smooth);
+        return;
+    }
+    float baseScale = this->baseRadius == 0 ? 0 : baseRadius / this->baseRadius;
+    float topScale = this->topRadius == 0 ? 0 : topRadius / this->topRadius;
+
+    // xy scale of every ring, the same lerp as the builders
+    std::vector<float> ringScales(stackCount + 1);
+    for (int i = 0; i <= stackCount; ++i)
+    {
+        float oldRadius = this->baseRadius + (float)i / stackCount * (this->topRadius - this->baseRadius);
+        float newRadius = baseRadius + (float)i / stackCount * (topRadius - baseRadius);
+        if (oldRadius == 0 && newRadius != 0)
+        {
+            // a ring collapsed to a point has lost its directions
+            set(baseRadius, topRadius, height, sectorCount, stackCount, smooth);
+            return;
+        }
+        ringScales[i] = oldRadius == 0 ? 0 : newRadius / oldRadius;
+    }
+    this->baseRadius = baseRadius;
+    this->topRadius = topRadius;
+
+    std::vector<unsigned char> parts = getVertexParts();
+    unsigned int count = getVertexCount();
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        float scale;
+        if (parts[i] == PART_BASE)
+            scale = baseScale;
+        else if (parts[i] == PART_TOP)
+            scale = topScale;
+        else
+            scale = ringScales[(int)((1.0f - texCoords[i * 2 + 1]) * stackCount + 0.5f)];
+
+        vertices[i * 3] *= scale;
+        vertices[i * 3 + 1] *= scale;
+        interleavedVertices[i * 8] *= scale;
+        interleavedVertices[i * 8 + 1] *= scale;
+    }
+    markDirty(0, count);
+
+    updateSideNormals(parts);
+    updateMeshletBounds();
+    applyStorage();
 }
 
-void Cylinder::drawTop() const
+
+
+///////////////////////////////////////////////////////////////////////////////
+// scale z of every vertex, then tilt the side normals to the new slope
+///////////////////////////////////////////////////////////////////////////////
+void Cylinder::updateHeight(float height)
 {
-    // interleaved array
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glEnableClientState(GL_NORMAL_ARRAY);
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-    glVertexPointer(3, GL_FLOAT, interleavedStride, &interleavedVertices[0]);
-    glNormalPointer(GL_FLOAT, interleavedStride, &interleavedVertices[3]);
-    glTexCoordPointer(2, GL_FLOAT, interleavedStride, &interleavedVertices[6]);
-
-    unsigned int indexCount = ((unsigned int)indices.size() - baseIndex) / 2;
-    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, &indices[topIndex]);
-
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableClientState(GL_NORMAL_ARRAY);
-    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    restoreArrays();
+
+    float scale = height / this->height;
+    this->height = height;
+
+    unsigned int count = getVertexCount();
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        vertices[i * 3 + 2] *= scale;
+        interleavedVertices[i * 8 + 2] *= scale;
+    }
+    markDirty(0, count);
+
+    updateSideNormals(getVertexParts());
+    updateMeshletBounds();
+    applyStorage();
 }
 
 
 
 ///////////////////////////////////////////////////////////////////////////////
-// draw lines only
-// the caller must set the line width before call this
+// recompute the normals of the side after its slope changed
+// smooth: the shared normal of the vertex's sector, found from s = j / sectorCount
+// flat: the face normal of the side triangles using the vertex
+// cap normals point straight down/up and never change
 ///////////////////////////////////////////////////////////////////////////////
-void Cylinder::drawLines(const float lineColor[4]) const
+void Cylinder::updateSideNormals(const std::vector<unsigned char>& parts)
 {
-    // set line colour
-    glColor4fv(lineColor);
-    glMaterialfv(GL_FRONT, GL_DIFFUSE, lineColor);
+    unsigned int count = getVertexCount();
+    if (smooth)
+    {
+        std::vector<float> sideNormals = getSideNormals();
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            if (parts[i] != PART_SIDE)
+                continue;
+
+            int j = (int)(texCoords[i * 2] * sectorCount + 0.5f);
+            const float* n = &sideNormals[j * 3];
+            normals[i * 3] = interleavedVertices[i * 8 + 3] = n[0];
+            normals[i * 3 + 1] = interleavedVertices[i * 8 + 4] = n[1];
+            normals[i * 3 + 2] = interleavedVertices[i * 8 + 5] = n[2];
+        }
+    }
+    else
+    {
+        // side triangles come first; both triangles of a flat quad share the
+        // normal, so a triangle collapsed at a cone tip takes it from the
+        // other triangle through their common vertices
+        std::vector<bool> done(count, false);
+        std::vector<unsigned int> collapsed;
+        float n[3];
+        for (unsigned int i = 0; i < baseIndex; i += 3)
+        {
+            const float* v1 = &vertices[indices[i] * 3];
+            const float* v2 = &vertices[indices[i + 1] * 3];
+            const float* v3 = &vertices[indices[i + 2] * 3];
+            computeFaceNormal(v1[0], v1[1], v1[2], v2[0], v2[1], v2[2], v3[0], v3[1], v3[2], n);
+            if (n[0] == 0 && n[1] == 0 && n[2] == 0)
+            {
+                collapsed.push_back(i);
+                continue;
+            }
 
-    // draw lines with VA
-    glDisable(GL_LIGHTING);
-    glDisable(GL_TEXTURE_2D);
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glVertexPointer(3, GL_FLOAT, 0, vertices.data());
+            for (unsigned int k = 0; k < 3; ++k)
+            {
+                unsigned int v = indices[i + k];
+                normals[v * 3] = interleavedVertices[v * 8 + 3] = n[0];
+                normals[v * 3 + 1] = interleavedVertices[v * 8 + 4] = n[1];
+                normals[v * 3 + 2] = interleavedVertices[v * 8 + 5] = n[2];
+                done[v] = true;
+            }
+        }
 
-    glDrawElements(GL_LINES, (unsigned int)lineIndices.size(), GL_UNSIGNED_INT, lineIndices.data());
+        for (std::size_t c = 0; c < collapsed.size(); ++c)
+        {
+            const unsigned int* triangle = &indices[collapsed[c]];
+            int from = done[triangle[0]] ? 0 : (done[triangle[1]] ? 1 : (done[triangle[2]] ? 2 : -1));
+            if (from < 0)
+                continue;
 
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glEnable(GL_LIGHTING);
-    glEnable(GL_TEXTURE_2D);
+            const float* source = &normals[triangle[from] * 3];
+            for (int k = 0; k < 3; ++k)
+            {
+                unsigned int v = triangle[k];
+                if (done[v])
+                    continue;
+                normals[v * 3] = interleavedVertices[v * 8 + 3] = source[0];
+                normals[v * 3 + 1] = interleavedVertices[v * 8 + 4] = source[1];
+                normals[v * 3 + 2] = interleavedVertices[v * 8 + 5] = source[2];
+            }
+        }
+    }
+    markDirty(0, count);
 }
 
 
 
 ///////////////////////////////////////////////////////////////////////////////
-// draw a cylinder surfaces and lines on top of it
-// the caller must set the line width before call this
+// which part (PART_SIDE/BASE/TOP) every vertex belongs to, from the index
+// ranges of the caps; valid in any vertex order
 ///////////////////////////////////////////////////////////////////////////////
-void Cylinder::drawWithLines(const float lineColor[4]) const
+std::vector<unsigned char> Cylinder::getVertexParts() const
 {
-    glEnable(GL_POLYGON_OFFSET_FILL);
-    glPolygonOffset(1.0, 1.0f); // move polygon backward
-    this->draw();
-    glDisable(GL_POLYGON_OFFSET_FILL);
-
-    // draw lines with VA
-    drawLines(lineColor);
+    std::vector<unsigned char> parts(getVertexCount(), PART_SIDE);
+    for (std::size_t i = baseIndex; i < topIndex; ++i)
+        parts[indices[i]] = PART_BASE;
+    for (std::size_t i = topIndex; i < indices.size(); ++i)
+        parts[indices[i]] = PART_TOP;
+    return parts;
 }
 
 
 
 ///////////////////////////////////////////////////////////////////////////////
-// dealloc vectors
+// build the mesh for the current shading
 ///////////////////////////////////////////////////////////////////////////////
-void Cylinder::clearArrays()
+void Cylinder::buildVertices()
 {
-    std::vector<float>().swap(vertices);
-    std::vector<float>().swap(normals);
-    std::vector<float>().swap(texCoords);
-    std::vector<unsigned int>().swap(indices);
-    std::vector<unsigned int>().swap(lineIndices);
+    if (smooth)
+        buildVerticesSmooth();
+    else
+        buildVerticesFlat();
 }
 
 
@@ -271,73 +403,116 @@ void Cylinder::clearArrays()
 ///////////////////////////////////////////////////////////////////////////////
 // build vertices of cylinder with smooth shading
 // where v: sector angle (0 <= v <= 360)
+//
+// all counts are known from sectors/stacks, so the arrays are sized once and
+// positions, normals, tex coords (separate and interleaved) and indices are
+// written in a single pass
+// with a thread pool, the side of a large mesh is split into ranges of stacks
+// built concurrently; every element is still computed by the same expression at
+// the same offset, so the result is identical to the serial build
 ///////////////////////////////////////////////////////////////////////////////
 void Cylinder::buildVerticesSmooth()
 {
-    // clear memory of prev arrays
-    clearArrays();
-
-    float x, y, z;                                  // vertex position
-    //float s, t;                                     // texCoord
-    float radius;                                   // radius for each stack
+    // side: (sectorCount+1) vertices per stack, 2 triangles per sector
+    // base/top: centre + sectorCount vertices, 1 triangle per sector
+    unsigned int sideVertexCount = (stackCount + 1) * (sectorCount + 1);
+    unsigned int vertexCount = sideVertexCount + 2 * (sectorCount + 1);
+    unsigned int indexCount = 6 * sectorCount * stackCount + 6 * sectorCount;
+    // strips: 2 indices per vertex column per stack, sectorCount per cap, restarts in between
+    unsigned int stripIndexCount = stackCount * (2 * sectorCount + 3) + 2 * sectorCount + 1;
+    resizeArrays(vertexCount, indexCount, stripIndexCount);
 
     // get normals for cylinder sides
     std::vector<float> sideNormals = getSideNormals();
 
+    // put vertices and indices of side cylinder
+    if (threadPool && vertexCount >= MIN_PARALLEL_VERTEX_COUNT)
+    {
+        threadPool->parallelFor(0, stackCount + 1, [this, &sideNormals](int first, int last)
+            { buildStacksSmooth(first, last, sideNormals); });
+    }
+    else
+    {
+        buildStacksSmooth(0, stackCount + 1, sideNormals);
+    }
+
+    // base and top right after the side
+    unsigned int baseVertexIndex = sideVertexCount;
+    unsigned int topVertexIndex = baseVertexIndex + sectorCount + 1;
+    buildCaps(baseVertexIndex, 6 * sectorCount * stackCount);
+
+    // caps as zigzag strips over the rim (the centre vertex is not needed):
+    // top 0, 1, n-1, 2, n-2, ... and the mirrored order for the base
+    unsigned int* strip = stripIndices.data() + (2 * sectorCount + 3) * stackCount;
+    buildCapStrip(strip, baseVertexIndex + 1, true);
+    strip += sectorCount;
+    *strip++ = RESTART_INDEX;
+    buildCapStrip(strip, topVertexIndex + 1, false);
+
+    packIndices();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// write a triangle strip covering the cap polygon of sectorCount rim vertices
+// starting at rimIndex, facing down (base) or up (top)
+///////////////////////////////////////////////////////////////////////////////
+void Cylinder::buildCapStrip(unsigned int* strip, unsigned int rimIndex, bool base)
+{
+    *strip++ = rimIndex;
+    for (int a = 1, b = sectorCount - 1; a <= b; ++a, --b)
+    {
+        *strip++ = rimIndex + (base ? b : a);
+        if (a != b)
+            *strip++ = rimIndex + (base ? a : b);
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// write the side vertex rows [firstStack, lastStack) and the triangles/strips of
+// the stacks starting on those rows into the presized arrays
+// the write offsets depend only on the stack number, so disjoint ranges can be
+// built in any order or at the same time
+///////////////////////////////////////////////////////////////////////////////
+void Cylinder::buildStacksSmooth(int firstStack, int lastStack, const std::vector<float>& sideNormals)
+{
+    float x, y, z;                                  // vertex position
+    float radius;                                   // radius for each stack
+
     // put vertices of side cylinder to array by scaling unit circle
-    for (int i = 0; i <= stackCount; ++i)
+    unsigned int index = firstStack * (sectorCount + 1);
+    for (int i = firstStack; i < lastStack; ++i)
     {
         z = -(height * 0.5f) + (float)i / stackCount * height;      // vertex position z
         radius = baseRadius + (float)i / stackCount * (topRadius - baseRadius);     // lerp
         float t = 1.0f - (float)i / stackCount;   // top-to-bottom
 
-        for (int j = 0, k = 0; j <= sectorCount; ++j, k += 3)
+        for (int j = 0, k = 0; j <= sectorCount; ++j, k += 3, ++index)
         {
             x = unitCircleVertices[k];
             y = unitCircleVertices[k + 1];
-            addVertex(x * radius, y * radius, z);   // position
-            addNormal(sideNormals[k], sideNormals[k + 1], sideNormals[k + 2]); // normal
-            addTexCoord((float)j / sectorCount, t); // tex coord
+            setVertex(index, x * radius, y * radius, z,
+                sideNormals[k], sideNormals[k + 1], sideNormals[k + 2],
+                (float)j / sectorCount, t);
         }
     }
 
-    // remember where the base.top vertices start
-    unsigned int baseVertexIndex = (unsigned int)vertices.size() / 3;
-
-    // put vertices of base of cylinder
-    z = -height * 0.5f;
-    addVertex(0, 0, z);
-    addNormal(0, 0, -1);
-    addTexCoord(0.5f, 0.5f);
-    for (int i = 0, j = 0; i < sectorCount; ++i, j += 3)
-    {
-        x = unitCircleVertices[j];
-        y = unitCircleVertices[j + 1];
-        addVertex(x * baseRadius, y * baseRadius, z);
-        addNormal(0, 0, -1);
-        addTexCoord(-x * 0.5f + 0.5f, -y * 0.5f + 0.5f);    // flip horizontal
-    }
+    // the last row only closes the stack below it
+    if (lastStack > stackCount)
+        lastStack = stackCount;
+    if (firstStack >= lastStack)
+        return;
 
-    // remember where the base vertices start
-    unsigned int topVertexIndex = (unsigned int)vertices.size() / 3;
-
-    // put vertices of top of cylinder
-    z = height * 0.5f;
-    addVertex(0, 0, z);
-    addNormal(0, 0, 1);
-    addTexCoord(0.5f, 0.5f);
-    for (int i = 0, j = 0; i < sectorCount; ++i, j += 3)
-    {
-        x = unitCircleVertices[j];
-        y = unitCircleVertices[j + 1];
-        addVertex(x * topRadius, y * topRadius, z);
-        addNormal(0, 0, 1);
-        addTexCoord(x * 0.5f + 0.5f, -y * 0.5f + 0.5f);
-    }
+    // 6 triangle indices per sector; 2 strip indices per column plus a restart
+    unsigned int* triangle = indices.data() + 6 * sectorCount * firstStack;
+    unsigned int* strip = stripIndices.data() + (2 * sectorCount + 3) * firstStack;
 
     // put indices for sides
     unsigned int k1, k2;
-    for (int i = 0; i < stackCount; ++i)
+    for (int i = firstStack; i < lastStack; ++i)
     {
         k1 = i * (sectorCount + 1);     // bebinning of current stack
         k2 = k1 + sectorCount + 1;      // beginning of next stack
@@ -345,242 +520,178 @@ void Cylinder::buildVerticesSmooth()
         for (int j = 0; j < sectorCount; ++j, ++k1, ++k2)
         {
             // 2 trianles per sector
-            addIndices(k1, k1 + 1, k2);
-            addIndices(k2, k1 + 1, k2 + 1);
-
-            // vertical lines for all stacks
-            lineIndices.push_back(k1);
-            lineIndices.push_back(k2);
-            // horizontal lines
-            lineIndices.push_back(k2);
-            lineIndices.push_back(k2 + 1);
-            if (i == 0)
-            {
-                lineIndices.push_back(k1);
-                lineIndices.push_back(k1 + 1);
-            }
+            *triangle++ = k1;
+            *triangle++ = k1 + 1;
+            *triangle++ = k2;
+            *triangle++ = k2;
+            *triangle++ = k1 + 1;
+            *triangle++ = k2 + 1;
         }
-    }
 
-    // remember where the base indices start
-    baseIndex = (unsigned int)indices.size();
-
-    // put indices for base
-    for (int i = 0, k = baseVertexIndex + 1; i < sectorCount; ++i, ++k)
-    {
-        if (i < (sectorCount - 1))
-            addIndices(baseVertexIndex, k + 1, k);
-        else    // last triangle
-            addIndices(baseVertexIndex, baseVertexIndex + 1, k);
-    }
-
-    // remember where the base indices start
-    topIndex = (unsigned int)indices.size();
-
-    for (int i = 0, k = topVertexIndex + 1; i < sectorCount; ++i, ++k)
-    {
-        if (i < (sectorCount - 1))
-            addIndices(topVertexIndex, k, k + 1);
-        else
-            addIndices(topVertexIndex, k, topVertexIndex + 1);
+        // strip k2, k1, k2+1, k1+1, ...
+        // splits each side quad along the other diagonal, which is the same
+        // plane since the quads are flat trapezoids
+        k1 = i * (sectorCount + 1);
+        k2 = k1 + sectorCount + 1;
+        for (int j = 0; j <= sectorCount; ++j)
+        {
+            *strip++ = k2 + j;
+            *strip++ = k1 + j;
+        }
+        *strip++ = RESTART_INDEX;
     }
-
-    // generate interleaved vertex array as well
-    buildInterleavedVertices();
 }
 
 
 
 ///////////////////////////////////////////////////////////////////////////////
 // generate vertices with flat shading
-// each triangle is independent (no shared vertices)
+// each side quad is independent (no shared vertices)
+// the counts are known from sectors/stacks, so the arrays are sized once and
+// every vertex is written in place from the unit circle
 ///////////////////////////////////////////////////////////////////////////////
 void Cylinder::buildVerticesFlat()
 {
-    // tmp vertex definition (x,y,z,s,t)
-    struct Vertex
-    {
-        float x, y, z, s, t;
-    };
-    std::vector<Vertex> tmpVertices;
+    // side: 4 vertices and 2 triangles per sector and stack
+    // base/top: centre + sectorCount vertices, 1 triangle per sector
+    unsigned int sideVertexCount = 4 * sectorCount * stackCount;
+    unsigned int vertexCount = sideVertexCount + 2 * (sectorCount + 1);
+    unsigned int indexCount = 6 * sectorCount * stackCount + 6 * sectorCount;
+    resizeArrays(vertexCount, indexCount, 0);
 
-    int i, j, k;    // indices
-    float x, y, z, s, t, radius;
+    float x1, y1, x2, y2, x3, y3, x4, y4;           // 4 vertex positions v1, v2, v3, v4
+    float z1, z2, radius1, radius2;
+    float s1, s2, t1, t2;
+    float n[3];                                     // 1 face normal
 
-    // put tmp vertices of cylinder side to array by scaling unit circle
-    //NOTE: start and end vertex positions are same, but texcoords are different
-    //      so, add additional vertex at the end point
-    for (i = 0; i <= stackCount; ++i)
-    {
-        z = -(height * 0.5f) + (float)i / stackCount * height;      // vertex position z
-        radius = baseRadius + (float)i / stackCount * (topRadius - baseRadius);     // lerp
-        t = 1.0f - (float)i / stackCount;   // top-to-bottom
-
-        for (j = 0, k = 0; j <= sectorCount; ++j, k += 3)
-        {
-            x = unitCircleVertices[k];
-            y = unitCircleVertices[k + 1];
-            s = (float)j / sectorCount;
-
-            Vertex vertex;
-            vertex.x = x * radius;
-            vertex.y = y * radius;
-            vertex.z = z;
-            vertex.s = s;
-            vertex.t = t;
-            tmpVertices.push_back(vertex);
-        }
-    }
-
-    // clear memory of prev arrays
-    clearArrays();
-
-    Vertex v1, v2, v3, v4;      // 4 vertex positions v1, v2, v3, v4
-    std::vector<float> n;       // 1 face normal
-    int vi1, vi2;               // indices
-    int index = 0;
+    unsigned int* triangle = indices.data();
+    unsigned int index = 0;
 
     // v2-v4 <== stack at i+1
     // | \ |
     // v1-v3 <== stack at i
-    for (i = 0; i < stackCount; ++i)
+    //NOTE: start and end vertex positions are same, but texcoords are different
+    for (int i = 0; i < stackCount; ++i)
     {
-        vi1 = i * (sectorCount + 1);            // index of tmpVertices
-        vi2 = (i + 1) * (sectorCount + 1);
-
-        for (j = 0; j < sectorCount; ++j, ++vi1, ++vi2)
+        z1 = -(height * 0.5f) + (float)i / stackCount * height;                     // vertex position z
+        z2 = -(height * 0.5f) + (float)(i + 1) / stackCount * height;
+        radius1 = baseRadius + (float)i / stackCount * (topRadius - baseRadius);    // lerp
+        radius2 = baseRadius + (float)(i + 1) / stackCount * (topRadius - baseRadius);
+        t1 = 1.0f - (float)i / stackCount;                                          // top-to-bottom
+        t2 = 1.0f - (float)(i + 1) / stackCount;
+
+        for (int j = 0, k = 0; j < sectorCount; ++j, k += 3)
         {
-            v1 = tmpVertices[vi1];
-            v2 = tmpVertices[vi2];
-            v3 = tmpVertices[vi1 + 1];
-            v4 = tmpVertices[vi2 + 1];
+            x1 = unitCircleVertices[k] * radius1;
+            y1 = unitCircleVertices[k + 1] * radius1;
+            x2 = unitCircleVertices[k] * radius2;
+            y2 = unitCircleVertices[k + 1] * radius2;
+            x3 = unitCircleVertices[k + 3] * radius1;
+            y3 = unitCircleVertices[k + 4] * radius1;
+            x4 = unitCircleVertices[k + 3] * radius2;
+            y4 = unitCircleVertices[k + 4] * radius2;
+            s1 = (float)j / sectorCount;
+            s2 = (float)(j + 1) / sectorCount;
 
             // compute a face normal of v1-v3-v2
-            n = computeFaceNormal(v1.x, v1.y, v1.z, v3.x, v3.y, v3.z, v2.x, v2.y, v2.z);
+            computeFaceNormal(x1, y1, z1, x3, y3, z1, x2, y2, z2, n);
 
             // put quad vertices: v1-v2-v3-v4
-            addVertex(v1.x, v1.y, v1.z);
-            addVertex(v2.x, v2.y, v2.z);
-            addVertex(v3.x, v3.y, v3.z);
-            addVertex(v4.x, v4.y, v4.z);
-
-            // put tex coords of quad
-            addTexCoord(v1.s, v1.t);
-            addTexCoord(v2.s, v2.t);
-            addTexCoord(v3.s, v3.t);
-            addTexCoord(v4.s, v4.t);
-
-            // put normal
-            for (k = 0; k < 4; ++k)  // same normals for all 4 vertices
-            {
-                addNormal(n[0], n[1], n[2]);
-            }
+            setVertex(index, x1, y1, z1, n[0], n[1], n[2], s1, t1);
+            setVertex(index + 1, x2, y2, z2, n[0], n[1], n[2], s1, t2);
+            setVertex(index + 2, x3, y3, z1, n[0], n[1], n[2], s2, t1);
+            setVertex(index + 3, x4, y4, z2, n[0], n[1], n[2], s2, t2);
 
             // put indices of a quad
-            addIndices(index, index + 2, index + 1);    // v1-v3-v2
-            addIndices(index + 1, index + 2, index + 3);    // v2-v3-v4
-
-            // vertical line per quad: v1-v2
-            lineIndices.push_back(index);
-            lineIndices.push_back(index + 1);
-            // horizontal line per quad: v2-v4
-            lineIndices.push_back(index + 1);
-            lineIndices.push_back(index + 3);
-            if (i == 0)
-            {
-                lineIndices.push_back(index);
-                lineIndices.push_back(index + 2);
-            }
+            *triangle++ = index;            // v1-v3-v2
+            *triangle++ = index + 2;
+            *triangle++ = index + 1;
+            *triangle++ = index + 1;        // v2-v3-v4
+            *triangle++ = index + 2;
+            *triangle++ = index + 3;
 
             index += 4;     // for next
         }
     }
 
-    // remember where the base index starts
-    baseIndex = (unsigned int)indices.size();
-    unsigned int baseVertexIndex = (unsigned int)vertices.size() / 3;
+    buildCaps(sideVertexCount, 6 * sectorCount * stackCount);
+    packIndices();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// write the base and top: centre + sectorCount rim vertices each from
+// vertexIndex, then sectorCount triangles each from triangleIndex
+// the same for smooth and flat shading, since the caps are flat anyway
+///////////////////////////////////////////////////////////////////////////////
+void Cylinder::buildCaps(unsigned int vertexIndex, unsigned int triangleIndex)
+{
+    float x, y, z;                                  // vertex position
+
+    // remember where the base.top vertices start
+    unsigned int index = vertexIndex;
+    unsigned int baseVertexIndex = index;
 
     // put vertices of base of cylinder
     z = -height * 0.5f;
-    addVertex(0, 0, z);
-    addNormal(0, 0, -1);
-    addTexCoord(0.5f, 0.5f);
-    for (i = 0, j = 0; i < sectorCount; ++i, j += 3)
+    setVertex(index++, 0, 0, z, 0, 0, -1, 0.5f, 0.5f);
+    for (int i = 0, j = 0; i < sectorCount; ++i, j += 3, ++index)
     {
         x = unitCircleVertices[j];
         y = unitCircleVertices[j + 1];
-        addVertex(x * baseRadius, y * baseRadius, z);
-        addNormal(0, 0, -1);
-        addTexCoord(-x * 0.5f + 0.5f, -y * 0.5f + 0.5f); // flip horizontal
-    }
-
-    // put indices for base
-    for (i = 0, k = baseVertexIndex + 1; i < sectorCount; ++i, ++k)
-    {
-        if (i < sectorCount - 1)
-            addIndices(baseVertexIndex, k + 1, k);
-        else
-            addIndices(baseVertexIndex, baseVertexIndex + 1, k);
+        setVertex(index, x * baseRadius, y * baseRadius, z, 0, 0, -1,
+            -x * 0.5f + 0.5f, -y * 0.5f + 0.5f);    // flip horizontal
     }
 
-    // remember where the top index starts
-    topIndex = (unsigned int)indices.size();
-    unsigned int topVertexIndex = (unsigned int)vertices.size() / 3;
+    // remember where the base vertices start
+    unsigned int topVertexIndex = index;
 
     // put vertices of top of cylinder
     z = height * 0.5f;
-    addVertex(0, 0, z);
-    addNormal(0, 0, 1);
-    addTexCoord(0.5f, 0.5f);
-    for (i = 0, j = 0; i < sectorCount; ++i, j += 3)
+    setVertex(index++, 0, 0, z, 0, 0, 1, 0.5f, 0.5f);
+    for (int i = 0, j = 0; i < sectorCount; ++i, j += 3, ++index)
     {
         x = unitCircleVertices[j];
         y = unitCircleVertices[j + 1];
-        addVertex(x * topRadius, y * topRadius, z);
-        addNormal(0, 0, 1);
-        addTexCoord(x * 0.5f + 0.5f, -y * 0.5f + 0.5f);
+        setVertex(index, x * topRadius, y * topRadius, z, 0, 0, 1,
+            x * 0.5f + 0.5f, -y * 0.5f + 0.5f);
     }
 
-    for (i = 0, k = topVertexIndex + 1; i < sectorCount; ++i, ++k)
+    // remember where the base indices start
+    baseIndex = triangleIndex;
+    unsigned int* triangle = indices.data() + baseIndex;
+
+    // put indices for base
+    for (int i = 0, k = baseVertexIndex + 1; i < sectorCount; ++i, ++k)
     {
-        if (i < sectorCount - 1)
-            addIndices(topVertexIndex, k, k + 1);
-        else
-            addIndices(topVertexIndex, k, topVertexIndex + 1);
+        *triangle++ = baseVertexIndex;
+        if (i < (sectorCount - 1))
+        {
+            *triangle++ = k + 1;
+            *triangle++ = k;
+        }
+        else    // last triangle
+        {
+            *triangle++ = baseVertexIndex + 1;
+            *triangle++ = k;
+        }
     }
 
-    // generate interleaved vertex array as well
-    buildInterleavedVertices();
-}
-
-
+    // remember where the top indices start
+    topIndex = (unsigned int)(triangle - indices.data());
+    baseIndexCount = topIndex - baseIndex;
 
-///////////////////////////////////////////////////////////////////////////////
-// generate interleaved vertices: V/N/T
-// stride must be 32 bytes
-///////////////////////////////////////////////////////////////////////////////
-void Cylinder::buildInterleavedVertices()
-{
-    std::vector<float>().swap(interleavedVertices);
-
-    std::size_t i, j;
-    std::size_t count = vertices.size();
-    for (i = 0, j = 0; i < count; i += 3, j += 2)
+    for (int i = 0, k = topVertexIndex + 1; i < sectorCount; ++i, ++k)
     {
-        //interleavedVertices.push_back(vertices[i]);
-        //interleavedVertices.push_back(vertices[i+1]);
-        //interleavedVertices.push_back(vertices[i+2]);
-        interleavedVertices.insert(interleavedVertices.end(), &vertices[i], &vertices[i] + 3);
-
-        //interleavedVertices.push_back(normals[i]);
-        //interleavedVertices.push_back(normals[i+1]);
-        //interleavedVertices.push_back(normals[i+2]);
-        interleavedVertices.insert(interleavedVertices.end(), &normals[i], &normals[i] + 3);
-
-        //interleavedVertices.push_back(texCoords[j]);
-        //interleavedVertices.push_back(texCoords[j+1]);
-        interleavedVertices.insert(interleavedVertices.end(), &texCoords[j], &texCoords[j] + 2);
+        *triangle++ = topVertexIndex;
+        *triangle++ = k;
+        if (i < (sectorCount - 1))
+            *triangle++ = k + 1;
+        else
+            *triangle++ = topVertexIndex + 1;
     }
+    topIndexCount = (unsigned int)(triangle - indices.data()) - topIndex;
 }
 
 
@@ -592,141 +703,42 @@ void Cylinder::buildUnitCircleVertices()
 {
     const float PI = acos(-1);
     float sectorStep = 2 * PI / sectorCount;
-    float sectorAngle;  // radian
 
-    std::vector<float>().swap(unitCircleVertices);
-    for (int i = 0; i <= sectorCount; ++i)
+    // sin/cos of all sector angles in one batch
+    std::vector<float> sines(sectorCount + 1);
+    std::vector<float> cosines(sectorCount + 1);
+    computeSinCosRing(0, sectorStep, sectorCount + 1, sines.data(), cosines.data());
+
+    unitCircleVertices.resize((sectorCount + 1) * 3);
+    for (int i = 0, k = 0; i <= sectorCount; ++i, k += 3)
     {
-        sectorAngle = i * sectorStep;
-        unitCircleVertices.push_back(cos(sectorAngle)); // x
-        unitCircleVertices.push_back(sin(sectorAngle)); // y
-        unitCircleVertices.push_back(0);                // z
+        unitCircleVertices[k] = cosines[i];     // x
+        unitCircleVertices[k + 1] = sines[i];   // y
+        unitCircleVertices[k + 2] = 0;          // z
     }
 }
 
 
 
-///////////////////////////////////////////////////////////////////////////////
-// add single vertex to array
-///////////////////////////////////////////////////////////////////////////////
-void Cylinder::addVertex(float x, float y, float z)
-{
-    vertices.push_back(x);
-    vertices.push_back(y);
-    vertices.push_back(z);
-}
-
-
-
-///////////////////////////////////////////////////////////////////////////////
-// add single normal to array
-///////////////////////////////////////////////////////////////////////////////
-void Cylinder::addNormal(float nx, float ny, float nz)
-{
-    normals.push_back(nx);
-    normals.push_back(ny);
-    normals.push_back(nz);
-}
-
-
-
-///////////////////////////////////////////////////////////////////////////////
-// add single texture coord to array
-///////////////////////////////////////////////////////////////////////////////
-void Cylinder::addTexCoord(float s, float t)
-{
-    texCoords.push_back(s);
-    texCoords.push_back(t);
-}
-
-
-
-///////////////////////////////////////////////////////////////////////////////
-// add 3 indices to array
-///////////////////////////////////////////////////////////////////////////////
-void Cylinder::addIndices(unsigned int i1, unsigned int i2, unsigned int i3)
-{
-    indices.push_back(i1);
-    indices.push_back(i2);
-    indices.push_back(i3);
-}
-
-
-
 ///////////////////////////////////////////////////////////////////////////////
 // generate shared normal vectors of the side of cylinder
 ///////////////////////////////////////////////////////////////////////////////
 std::vector<float> Cylinder::getSideNormals()
 {
-    const float PI = acos(-1);
-    float sectorStep = 2 * PI / sectorCount;
-    float sectorAngle;  // radian
-
     // compute the normal vector at 0 degree first
     // tanA = (baseRadius-topRadius) / height
     float zAngle = atan2(baseRadius - topRadius, height);
     float x0 = cos(zAngle);     // nx
-    float y0 = 0;               // ny
     float z0 = sin(zAngle);     // nz
 
-    // rotate (x0,y0,z0) per sector angle
-    std::vector<float> normals;
-    for (int i = 0; i <= sectorCount; ++i)
+    // rotate (x0,0,z0) per sector angle, reusing sin/cos of the unit circle
+    std::vector<float> normals((sectorCount + 1) * 3);
+    for (int i = 0, k = 0; i <= sectorCount; ++i, k += 3)
     {
-        sectorAngle = i * sectorStep;
-        normals.push_back(cos(sectorAngle) * x0 - sin(sectorAngle) * y0);   // nx
-        normals.push_back(sin(sectorAngle) * x0 + cos(sectorAngle) * y0);   // ny
-        normals.push_back(z0);  // nz
-        /*
-        //debug
-        float nx = cos(sectorAngle)*x0 - sin(sectorAngle)*y0;
-        float ny = sin(sectorAngle)*x0 + cos(sectorAngle)*y0;
-        std::cout << "normal=(" << nx << ", " << ny << ", " << z0
-                  << "), length=" << sqrtf(nx*nx + ny*ny + z0*z0) << std::endl;
-        */
+        normals[k] = unitCircleVertices[k] * x0;            // nx = cos(a) * x0
+        normals[k + 1] = unitCircleVertices[k + 1] * x0;    // ny = sin(a) * x0
+        normals[k + 2] = z0;                                // nz
     }
 
     return normals;
 }
-
-
-
-///////////////////////////////////////////////////////////////////////////////
-// return face normal of a triangle v1-v2-v3
-// if a triangle has no surface (normal length = 0), then return a zero vector
-///////////////////////////////////////////////////////////////////////////////
-std::vector<float> Cylinder::computeFaceNormal(float x1, float y1, float z1,  // v1
-    float x2, float y2, float z2,  // v2
-    float x3, float y3, float z3)  // v3
-{
-    const float EPSILON = 0.000001f;
-
-    std::vector<float> normal(3, 0.0f);     // default return value (0,0,0)
-    float nx, ny, nz;
-
-    // find 2 edge vectors: v1-v2, v1-v3
-    float ex1 = x2 - x1;
-    float ey1 = y2 - y1;
-    float ez1 = z2 - z1;
-    float ex2 = x3 - x1;
-    float ey2 = y3 - y1;
-    float ez2 = z3 - z1;
-
-    // cross product: e1 x e2
-    nx = ey1 * ez2 - ez1 * ey2;
-    ny = ez1 * ex2 - ex1 * ez2;
-    nz = ex1 * ey2 - ey1 * ex2;
-
-    // normalize only if the length is > 0
-    float length = sqrtf(nx * nx + ny * ny + nz * nz);
-    if (length > EPSILON)
-    {
-        // normalize
-        float lengthInv = 1.0f / length;
-        normal[0] = nx * lengthInv;
-        normal[1] = ny * lengthInv;
-        normal[2] = nz * lengthInv;
-    }
-
-    return normal;
-}
@@ -1,113 +1,90 @@
-#pragma once
-// Source: Song Ho Ahn - http://www.songho.ca/opengl/gl_cylinder.html
-
-#ifndef GEOMETRY_CYLINDER_H
-#define GEOMETRY_CYLINDER_H
-
-#include <vector>
-
-class Cylinder
-{
-public:
-    // ctor/dtor
-    Cylinder(float baseRadius = 1.0f, float topRadius = 1.0f, float height = 1.0f,
-        int sectorCount = 36, int stackCount = 1, bool smooth = true);
-    ~Cylinder() {}
-
-    // getters/setters
-    float getBaseRadius() const { return baseRadius; }
-    float getTopRadius() const { return topRadius; }
-    float getHeight() const { return height; }
-    int getSectorCount() const { return sectorCount; }
-    int getStackCount() const { return stackCount; }
-    void set(float baseRadius, float topRadius, float height,
-        int sectorCount, int stackCount, bool smooth = true);
-    void setBaseRadius(float radius);
-    void setTopRadius(float radius);
-    void setHeight(float radius);
-    void setSectorCount(int sectorCount);
-    void setStackCount(int stackCount);
-    void setSmooth(bool smooth);
-
-    // for vertex data
-    unsigned int getVertexCount() const { return (unsigned int)vertices.size() / 3; }
-    unsigned int getNormalCount() const { return (unsigned int)normals.size() / 3; }
-    unsigned int getTexCoordCount() const { return (unsigned int)texCoords.size() / 2; }
-    unsigned int getIndexCount() const { return (unsigned int)indices.size(); }
-    unsigned int getLineIndexCount() const { return (unsigned int)lineIndices.size(); }
-    unsigned int getTriangleCount() const { return getIndexCount() / 3; }
-    unsigned int getVertexSize() const { return (unsigned int)vertices.size() * sizeof(float); }
-    unsigned int getNormalSize() const { return (unsigned int)normals.size() * sizeof(float); }
-    unsigned int getTexCoordSize() const { return (unsigned int)texCoords.size() * sizeof(float); }
-    unsigned int getIndexSize() const { return (unsigned int)indices.size() * sizeof(unsigned int); }
-    unsigned int getLineIndexSize() const { return (unsigned int)lineIndices.size() * sizeof(unsigned int); }
-    const float* getVertices() const { return vertices.data(); }
-    const float* getNormals() const { return normals.data(); }
-    const float* getTexCoords() const { return texCoords.data(); }
-    const unsigned int* getIndices() const { return indices.data(); }
-    const unsigned int* getLineIndices() const { return lineIndices.data(); }
-
-    // for interleaved vertices: V/N/T
-    unsigned int getInterleavedVertexCount() const { return getVertexCount(); }    // # of vertices
-    unsigned int getInterleavedVertexSize() const { return (unsigned int)interleavedVertices.size() * sizeof(unsigned int); }    // # of bytes
-    int getInterleavedStride() const { return interleavedStride; }   // should be 32 bytes
-    const float* getInterleavedVertices() const { return &interleavedVertices[0]; }
-
-    // for indices of base/top/side parts
-    unsigned int getBaseIndexCount() const { return ((unsigned int)indices.size() - baseIndex) / 2; }
-    unsigned int getTopIndexCount() const { return ((unsigned int)indices.size() - baseIndex) / 2; }
-    unsigned int getSideIndexCount() const { return baseIndex; }
-    unsigned int getBaseStartIndex() const { return baseIndex; }
-    unsigned int getTopStartIndex() const { return topIndex; }
-    unsigned int getSideStartIndex() const { return 0; }   // side starts from the begining
-
-    // draw in VertexArray mode
-    void draw() const;          // draw all
-    void drawBase() const;      // draw base cap only
-    void drawTop() const;       // draw top cap only
-    void drawSide() const;      // draw side only
-    void drawLines(const float lineColor[4]) const;     // draw lines only
-    void drawWithLines(const float lineColor[4]) const; // draw surface and lines
-
-    // debug
-    void printSelf() const;
-
-    // member functions
-    void clearArrays();
-    void buildVerticesSmooth();
-    void buildVerticesFlat();
-    void buildInterleavedVertices();
-    void buildUnitCircleVertices();
-    void addVertex(float x, float y, float z);
-    void addNormal(float x, float y, float z);
-    void addTexCoord(float s, float t);
-    void addIndices(unsigned int i1, unsigned int i2, unsigned int i3);
-    std::vector<float> getSideNormals();
-    std::vector<float> computeFaceNormal(float x1, float y1, float z1,
-        float x2, float y2, float z2,
-        float x3, float y3, float z3);
-
-    // memeber vars
-    float baseRadius;
-    float topRadius;
-    float height;
-    int sectorCount;                        // # of slices
-    int stackCount;                         // # of stacks
-    unsigned int baseIndex;                 // starting index of base
-    unsigned int topIndex;                  // starting index of top
-    bool smooth;
-    std::vector<float> unitCircleVertices;
-    std::vector<float> vertices;
-    std::vector<float> normals;
-    std::vector<float> texCoords;
-    std::vector<unsigned int> indices;
-    std::vector<unsigned int> lineIndices;
-
-    // interleaved
-    std::vector<float> interleavedVertices;
-    int interleavedStride;                  // # of bytes to hop to the next vertex (should be 32 bytes)
-
-};
-
-#endif
-
+#pragma once
+// Source: Song Ho Ahn - http://www.songho.ca/opengl/gl_cylinder.html
+
+#ifndef GEOMETRY_CYLINDER_H
+#define GEOMETRY_CYLINDER_H
+
+#include <vector>
+#include "IndexedMesh.h"
+
+class ThreadPool;
+
+// storage, indices, dirty ranges, GPU buffers and drawing: see IndexedMesh.h
+// strips are only built for smooth shading; optimize() and buildMeshlets()
+// keep side, base and top apart, and the lines come from the side only
+class Cylinder : public IndexedMesh
+{
+public:
+    // ctor/dtor
+    Cylinder(float baseRadius = 1.0f, float topRadius = 1.0f, float height = 1.0f,
+        int sectorCount = 36, int stackCount = 1, bool smooth = true, ThreadPool* threadPool = nullptr);
+    ~Cylinder() {}
+
+    // getters/setters
+    float getBaseRadius() const { return baseRadius; }
+    float getTopRadius() const { return topRadius; }
+    float getHeight() const { return height; }
+    int getSectorCount() const { return sectorCount; }
+    int getStackCount() const { return stackCount; }
+    float getBoundingRadius() const;                        // about the centre
+    void set(float baseRadius, float topRadius, float height,
+        int sectorCount, int stackCount, bool smooth = true);
+    void setBaseRadius(float radius);       // radius/height setters move the vertices
+    void setTopRadius(float radius);        // in place and keep the meshlet bounds,
+    void setHeight(float height);           // others rebuild
+    void setSectorCount(int sectorCount);
+    void setStackCount(int stackCount);
+    void setSmooth(bool smooth);
+    ThreadPool* getThreadPool() const { return threadPool; }
+    void setThreadPool(ThreadPool* pool);   // used from the next build on, nullptr = serial
+
+    // for indices of base/top/side parts
+    unsigned int getBaseIndexCount() const { return baseIndexCount; }
+    unsigned int getTopIndexCount() const { return topIndexCount; }
+    unsigned int getSideIndexCount() const { return baseIndex; }
+    unsigned int getBaseStartIndex() const { return baseIndex; }
+    unsigned int getTopStartIndex() const { return topIndex; }
+    unsigned int getSideStartIndex() const { return 0; }   // side starts from the begining
+
+    // draw parts of the uploaded buffers, ranges of the same index buffer
+    void drawBase() const;      // draw base cap only
+    void drawTop() const;       // draw top cap only
+    void drawSide() const;      // draw side only
+
+    // debug
+    void printSelf() const;
+
+    // member functions
+    void buildVertices() override;
+    std::vector<unsigned int> getIndexParts() const override;
+    unsigned int getLineSourceIndexCount() const override { return baseIndex; }
+    void buildVerticesSmooth();
+    void buildStacksSmooth(int firstStack, int lastStack, const std::vector<float>& sideNormals);
+    void buildVerticesFlat();
+    void buildCaps(unsigned int vertexIndex, unsigned int triangleIndex);
+    void buildUnitCircleVertices();
+    void buildCapStrip(unsigned int* strip, unsigned int rimIndex, bool base);
+    std::vector<float> getSideNormals();
+    std::vector<unsigned char> getVertexParts() const;
+    void updateRadii(float baseRadius, float topRadius);
+    void updateHeight(float height);
+    void updateSideNormals(const std::vector<unsigned char>& parts);
+    void updateMeshletBounds();
+
+    // memeber vars
+    float baseRadius;
+    float topRadius;
+    float height;
+    int sectorCount;                        // # of slices
+    int stackCount;                         // # of stacks
+    unsigned int baseIndex;                 // starting index of base
+    unsigned int topIndex;                  // starting index of top
+    unsigned int baseIndexCount;            // # of base/top indices, kept when the
+    unsigned int topIndexCount;             // CPU arrays are released
+    bool smooth;
+    ThreadPool* threadPool;                 // not owned; splits large smooth builds by stacks
+    std::vector<float> unitCircleVertices;
+
+};
+
+#endif
@@ -0,0 +1,64 @@
+#pragma once
+// View frustum as 6 planes, for culling bounding volumes on the CPU
+// planes are taken from a combined matrix (Gribb and Hartmann), so they are in
+// the space the matrix transforms from: world space for projection * view,
+// model space for projection * view * model
+
+#ifndef GEOMETRY_FRUSTUM_H
+#define GEOMETRY_FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+enum FrustumPlane
+{
+    FRUSTUM_LEFT = 0,
+    FRUSTUM_RIGHT,
+    FRUSTUM_BOTTOM,
+    FRUSTUM_TOP,
+    FRUSTUM_NEAR,
+    FRUSTUM_FAR,
+    FRUSTUM_PLANE_COUNT
+};
+
+class Frustum
+{
+public:
+    Frustum() {}
+    explicit Frustum(const glm::mat4& matrix) { extract(matrix); }
+
+    // planes (a, b, c, d) with a unit normal pointing inside: ax + by + cz + d >= 0 inside
+    void extract(const glm::mat4& matrix)
+    {
+        glm::vec4 row0(matrix[0][0], matrix[1][0], matrix[2][0], matrix[3][0]);
+        glm::vec4 row1(matrix[0][1], matrix[1][1], matrix[2][1], matrix[3][1]);
+        glm::vec4 row2(matrix[0][2], matrix[1][2], matrix[2][2], matrix[3][2]);
+        glm::vec4 row3(matrix[0][3], matrix[1][3], matrix[2][3], matrix[3][3]);
+
+        planes[FRUSTUM_LEFT] = row3 + row0;
+        planes[FRUSTUM_RIGHT] = row3 - row0;
+        planes[FRUSTUM_BOTTOM] = row3 + row1;
+        planes[FRUSTUM_TOP] = row3 - row1;
+        planes[FRUSTUM_NEAR] = row3 + row2;
+        planes[FRUSTUM_FAR] = row3 - row2;
+        for (int i = 0; i < FRUSTUM_PLANE_COUNT; ++i)
+            planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+
+    // false only if the sphere is entirely outside one of the planes
+    bool intersectsSphere(const glm::vec3& center, float radius) const
+    {
+        for (int i = 0; i < FRUSTUM_PLANE_COUNT; ++i)
+        {
+            if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius)
+                return false;
+        }
+        return true;
+    }
+
+    const glm::vec4& getPlane(int plane) const { return planes[plane]; }
+
+private:
+    glm::vec4 planes[FRUSTUM_PLANE_COUNT];
+};
+
+#endif
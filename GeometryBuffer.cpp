@@ -0,0 +1,281 @@
+// Shared vertex and index buffers for many meshes
+
+#include <algorithm>
+#include "GeometryBuffer.h"
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// indices of one type in another; the primitive restart index of the source
+// type becomes the one of the target type, other indices must fit below it
+///////////////////////////////////////////////////////////////////////////////
+static bool narrowIndices(const GLuint* indices, unsigned int count, std::vector<GLushort>& converted)
+{
+    converted.resize(count);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        if (indices[i] == 0xFFFFFFFF)
+            converted[i] = 0xFFFF;
+        else if (indices[i] < 0xFFFF)
+            converted[i] = (GLushort)indices[i];
+        else
+            return false;
+    }
+    return true;
+}
+
+static void widenIndices(const GLushort* indices, unsigned int count, std::vector<GLuint>& converted)
+{
+    converted.resize(count);
+    for (unsigned int i = 0; i < count; ++i)
+        converted[i] = indices[i] == 0xFFFF ? 0xFFFFFFFF : indices[i];
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// new buffer of newSize bytes with the content of the old one, which is deleted
+///////////////////////////////////////////////////////////////////////////////
+static GLuint growBuffer(GLuint buffer, GLsizeiptr oldSize, GLsizeiptr newSize)
+{
+    GLuint newBuffer;
+    glGenBuffers(1, &newBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, newSize, NULL, GL_STATIC_DRAW);
+    if (buffer)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glDeleteBuffers(1, &buffer);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return newBuffer;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor/dtor
+///////////////////////////////////////////////////////////////////////////////
+GeometryBuffer::GeometryBuffer(VertexFormat format, GLenum indexType,
+    unsigned int vertexCapacity, unsigned int indexCapacity) : format(format), indexType(indexType),
+    vao(0), vbo(0), ibo(0), vertexCapacity(vertexCapacity), indexCapacity(indexCapacity),
+    vertexEnd(0), indexEnd(0), rangeCount(0)
+{
+}
+
+GeometryBuffer::~GeometryBuffer()
+{
+    release();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// convert the vertices to the buffer format if needed, then copy them
+///////////////////////////////////////////////////////////////////////////////
+bool GeometryBuffer::append(const float* interleavedVertices, unsigned int vertexCount,
+    const void* indices, unsigned int indexCount, GLenum indexType, GeometryRange& range)
+{
+    if (format == VERTEX_FORMAT_PACKED)
+    {
+        std::vector<PackedVertex> packedVertices(vertexCount);
+        packVertices(interleavedVertices, vertexCount, packedVertices.data());
+        return appendFormatted(packedVertices.data(), format, vertexCount, indices, indexCount, indexType, range);
+    }
+    return appendFormatted(interleavedVertices, format, vertexCount, indices, indexCount, indexType, range);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// allocate the ranges, grow the buffers if they do not fit, then copy
+///////////////////////////////////////////////////////////////////////////////
+bool GeometryBuffer::appendFormatted(const void* vertexData, VertexFormat format, unsigned int vertexCount,
+    const void* indices, unsigned int indexCount, GLenum indexType, GeometryRange& range)
+{
+    if (format != this->format || vertexCount == 0 || indexCount == 0)
+        return false;
+
+    // indices in the type of the buffer
+    std::vector<GLushort> shortIndices;
+    std::vector<GLuint> intIndices;
+    if (indexType == GL_UNSIGNED_INT && this->indexType == GL_UNSIGNED_SHORT)
+    {
+        if (!narrowIndices((const GLuint*)indices, indexCount, shortIndices))
+            return false;
+        indices = shortIndices.data();
+    }
+    else if (indexType == GL_UNSIGNED_SHORT && this->indexType == GL_UNSIGNED_INT)
+    {
+        widenIndices((const GLushort*)indices, indexCount, intIndices);
+        indices = intIndices.data();
+    }
+
+    range.firstVertex = allocateSpan(freeVertices, vertexEnd, vertexCount);
+    range.vertexCount = vertexCount;
+    range.firstIndex = allocateSpan(freeIndices, indexEnd, indexCount);
+    range.indexCount = indexCount;
+    reserve(vertexEnd, indexEnd);
+
+    GLsizeiptr vertexSize = getVertexFormatStride(format);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, range.firstVertex * vertexSize, vertexCount * vertexSize, vertexData);
+
+    GLsizeiptr indexSize = this->indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ibo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, range.firstIndex * indexSize, indexCount * indexSize, indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    ++rangeCount;
+    return true;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// the spans go back to the free lists; nothing is copied on the GPU
+///////////////////////////////////////////////////////////////////////////////
+void GeometryBuffer::remove(const GeometryRange& range)
+{
+    if (!vao || range.vertexCount == 0)
+        return;     // released since, or never appended
+
+    Span vertices = { range.firstVertex, range.vertexCount };
+    Span indices = { range.firstIndex, range.indexCount };
+    freeSpan(freeVertices, vertexEnd, vertices);
+    freeSpan(freeIndices, indexEnd, indices);
+    --rangeCount;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// delete the GL objects; the capacities are kept for the next append()
+///////////////////////////////////////////////////////////////////////////////
+void GeometryBuffer::release()
+{
+    if (!vao)
+        return;
+
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ibo);
+    vao = vbo = ibo = 0;
+    vertexEnd = indexEnd = 0;
+    freeVertices.clear();
+    freeIndices.clear();
+    rangeCount = 0;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// first fit in the holes, else at the end
+///////////////////////////////////////////////////////////////////////////////
+unsigned int GeometryBuffer::allocateSpan(std::vector<Span>& freeSpans, unsigned int& end, unsigned int count)
+{
+    for (std::size_t i = 0; i < freeSpans.size(); ++i)
+    {
+        Span& span = freeSpans[i];
+        if (span.count < count)
+            continue;
+
+        unsigned int first = span.first;
+        span.first += count;
+        span.count -= count;
+        if (span.count == 0)
+            freeSpans.erase(freeSpans.begin() + i);
+        return first;
+    }
+
+    unsigned int first = end;
+    end += count;
+    return first;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// insert in order and merge with the neighbours; a hole at the end shrinks
+// the part in use instead
+///////////////////////////////////////////////////////////////////////////////
+void GeometryBuffer::freeSpan(std::vector<Span>& freeSpans, unsigned int& end, Span span)
+{
+    std::vector<Span>::iterator it = std::lower_bound(freeSpans.begin(), freeSpans.end(), span,
+        [](const Span& a, const Span& b) { return a.first < b.first; });
+    it = freeSpans.insert(it, span);
+
+    if (it + 1 != freeSpans.end() && it->first + it->count == (it + 1)->first)
+    {
+        it->count += (it + 1)->count;
+        freeSpans.erase(it + 1);
+    }
+    if (it != freeSpans.begin() && (it - 1)->first + (it - 1)->count == it->first)
+    {
+        (it - 1)->count += it->count;
+        freeSpans.erase(it);
+    }
+
+    if (!freeSpans.empty() && freeSpans.back().first + freeSpans.back().count == end)
+    {
+        end = freeSpans.back().first;
+        freeSpans.pop_back();
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// create the VAO and buffers on first use, and grow a buffer to at least
+// twice its size when the part in use passes its end
+///////////////////////////////////////////////////////////////////////////////
+void GeometryBuffer::reserve(unsigned int vertexEnd, unsigned int indexEnd)
+{
+    GLsizeiptr vertexSize = getVertexFormatStride(format);
+    GLsizeiptr indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    if (!vao)
+    {
+        glGenVertexArrays(1, &vao);
+        vertexCapacity = std::max(vertexCapacity, vertexEnd);
+        indexCapacity = std::max(indexCapacity, indexEnd);
+        vbo = growBuffer(0, 0, vertexCapacity * vertexSize);
+        ibo = growBuffer(0, 0, indexCapacity * indexSize);
+        setAttributes();
+        return;
+    }
+
+    bool grown = false;
+    if (vertexEnd > vertexCapacity)
+    {
+        unsigned int capacity = std::max(vertexCapacity * 2, vertexEnd);
+        vbo = growBuffer(vbo, vertexCapacity * vertexSize, capacity * vertexSize);
+        vertexCapacity = capacity;
+        grown = true;
+    }
+    if (indexEnd > indexCapacity)
+    {
+        unsigned int capacity = std::max(indexCapacity * 2, indexEnd);
+        ibo = growBuffer(ibo, indexCapacity * indexSize, capacity * indexSize);
+        indexCapacity = capacity;
+        grown = true;
+    }
+    if (grown)
+        setAttributes();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// point the VAO at the current buffers
+///////////////////////////////////////////////////////////////////////////////
+void GeometryBuffer::setAttributes()
+{
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    setVertexFormatAttributes(format);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
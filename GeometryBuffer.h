@@ -0,0 +1,89 @@
+#pragma once
+// Shared vertex and index buffers for many meshes (geometry mega-buffer)
+// every mesh gets a range of one vertex buffer and one index buffer behind a
+// single VAO, so meshes are drawn without a VAO bind in between, and many of
+// them at once with glMultiDrawElementsIndirect(); the indices of a range stay
+// relative to its first vertex, which is passed as the base vertex
+// ranges are sub-allocated first fit and given back with remove(); the buffers
+// grow by copying on the GPU when a range does not fit
+// owns the VAO and the buffers and deletes them on destruction; the GL context
+// must be current for everything but the ctor
+
+#ifndef GEOMETRY_GEOMETRY_BUFFER_H
+#define GEOMETRY_GEOMETRY_BUFFER_H
+
+#include <vector>
+#include <GL/glew.h>
+#include "VertexFormat.h"
+
+// where a mesh lives in the buffers
+struct GeometryRange
+{
+    unsigned int firstVertex;               // base vertex of the draws
+    unsigned int vertexCount;
+    unsigned int firstIndex;                // in indices, not bytes
+    unsigned int indexCount;
+};
+
+class GeometryBuffer
+{
+public:
+    // ctor/dtor
+    // nothing is created on the GPU until the first append()
+    // indexType: GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, for all ranges
+    GeometryBuffer(VertexFormat format, GLenum indexType,
+        unsigned int vertexCapacity = 16384, unsigned int indexCapacity = 65536);
+    ~GeometryBuffer();
+
+    // copy a mesh into a new range; false if its indices do not fit the index
+    // type of the buffer, or if the vertices are in another format
+    // interleavedVertices: 8 floats per vertex, converted to the buffer format
+    // indices of another type are converted, primitive restart indices included
+    bool append(const float* interleavedVertices, unsigned int vertexCount,
+        const void* indices, unsigned int indexCount, GLenum indexType, GeometryRange& range);
+    // same with vertices already in the given format, e.g. from a mesh file
+    bool appendFormatted(const void* vertexData, VertexFormat format, unsigned int vertexCount,
+        const void* indices, unsigned int indexCount, GLenum indexType, GeometryRange& range);
+    // give a range back for reuse; the data stays until it is overwritten
+    void remove(const GeometryRange& range);
+    void release();                         // delete the GL objects and forget all ranges
+
+    GLuint getVao() const { return vao; }
+    VertexFormat getVertexFormat() const { return format; }
+    GLenum getIndexType() const { return indexType; }
+    unsigned int getRangeCount() const { return rangeCount; }
+    unsigned int getVertexCapacity() const { return vertexCapacity; }
+    unsigned int getIndexCapacity() const { return indexCapacity; }
+
+private:
+    // buffers are not shared between objects
+    GeometryBuffer(const GeometryBuffer&) = delete;
+    GeometryBuffer& operator=(const GeometryBuffer&) = delete;
+
+    // part of one of the buffers
+    struct Span
+    {
+        unsigned int first;
+        unsigned int count;
+    };
+
+    static unsigned int allocateSpan(std::vector<Span>& freeSpans, unsigned int& end, unsigned int count);
+    static void freeSpan(std::vector<Span>& freeSpans, unsigned int& end, Span span);
+    void reserve(unsigned int vertexEnd, unsigned int indexEnd);
+    void setAttributes();
+
+    VertexFormat format;
+    GLenum indexType;
+    GLuint vao;
+    GLuint vbo;
+    GLuint ibo;
+    unsigned int vertexCapacity;            // allocated, in vertices
+    unsigned int indexCapacity;             // allocated, in indices
+    unsigned int vertexEnd;                 // past the last vertex in use
+    unsigned int indexEnd;                  // past the last index in use
+    std::vector<Span> freeVertices;         // holes below vertexEnd, sorted
+    std::vector<Span> freeIndices;          // holes below indexEnd, sorted
+    unsigned int rangeCount;
+};
+
+#endif
@@ -0,0 +1,21 @@
+#pragma once
+// Which CPU copies of the vertex data a geometry class keeps after a build
+// GEOMETRY_STORAGE_ALL:         positions/normals/tex coords (SoA) and interleaved V/N/T
+// GEOMETRY_STORAGE_INTERLEAVED: interleaved only, what upload() reads
+// GEOMETRY_STORAGE_SOA:         separate arrays only
+// GEOMETRY_STORAGE_GPU_ONLY:    interleaved until uploaded, then nothing (see releaseCpuData())
+// the builders still fill both layouts; the dropped one is freed at the end of
+// every build, and rebuilt on demand by the setters that need it
+
+#ifndef GEOMETRY_STORAGE_H
+#define GEOMETRY_STORAGE_H
+
+enum GeometryStorage
+{
+    GEOMETRY_STORAGE_ALL = 0,
+    GEOMETRY_STORAGE_INTERLEAVED,
+    GEOMETRY_STORAGE_SOA,
+    GEOMETRY_STORAGE_GPU_ONLY
+};
+
+#endif
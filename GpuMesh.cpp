@@ -0,0 +1,120 @@
+// GPU buffers of an indexed mesh with interleaved V/N/T vertices
+
+#include <vector>
+#include "GpuMesh.h"
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor/dtor
+///////////////////////////////////////////////////////////////////////////////
+GpuMesh::GpuMesh() : vao(0), vbo(0), ibo(0), indexCount(0), indexType(GL_UNSIGNED_INT),
+    format(VERTEX_FORMAT_FLOAT)
+{
+}
+
+GpuMesh::~GpuMesh()
+{
+    release();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// convert the vertices to the upload format if needed, then send the data
+///////////////////////////////////////////////////////////////////////////////
+void GpuMesh::upload(const float* interleavedVertices, unsigned int vertexCount,
+    const void* indices, unsigned int indexCount, GLenum indexType, VertexFormat format)
+{
+    if (format == VERTEX_FORMAT_PACKED)
+    {
+        std::vector<PackedVertex> packedVertices(vertexCount);
+        packVertices(interleavedVertices, vertexCount, packedVertices.data());
+        uploadFormatted(packedVertices.data(), vertexCount, indices, indexCount, indexType, format);
+    }
+    else
+    {
+        uploadFormatted(interleavedVertices, vertexCount, indices, indexCount, indexType, format);
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// create the VAO and buffers once, then send the data as is
+///////////////////////////////////////////////////////////////////////////////
+void GpuMesh::uploadFormatted(const void* vertexData, unsigned int vertexCount,
+    const void* indices, unsigned int indexCount, GLenum indexType, VertexFormat format)
+{
+    if (!vao)
+    {
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glGenBuffers(1, &ibo);
+    }
+
+    glBindVertexArray(vao); // activate vertex array object
+
+    // vertex data
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    GLsizeiptr vertexSize = (GLsizeiptr)vertexCount * getVertexFormatStride(format);
+    glBufferData(GL_ARRAY_BUFFER, vertexSize, vertexData, GL_STATIC_DRAW);
+
+    // index data
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    GLsizeiptr indexSize = indexCount * (indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint));
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize, indices, GL_STATIC_DRAW);
+
+    // position, normal and texture coordinate attributes
+    setVertexFormatAttributes(format);
+
+    glBindVertexArray(0);
+
+    this->indexCount = indexCount;
+    this->indexType = indexType;
+    this->format = format;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// patch part of the vertex buffer, converted to the format of the last upload
+///////////////////////////////////////////////////////////////////////////////
+void GpuMesh::updateVertices(const float* interleavedVertices, unsigned int firstVertex, unsigned int count)
+{
+    if (!vbo || count == 0)
+        return;
+
+    const float* src = interleavedVertices + firstVertex * 8;
+    GLintptr offset = (GLintptr)firstVertex * getVertexFormatStride(format);
+    GLsizeiptr size = (GLsizeiptr)count * getVertexFormatStride(format);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    if (format == VERTEX_FORMAT_PACKED)
+    {
+        std::vector<PackedVertex> packedVertices(count);
+        packVertices(src, count, packedVertices.data());
+        glBufferSubData(GL_ARRAY_BUFFER, offset, size, packedVertices.data());
+    }
+    else
+    {
+        glBufferSubData(GL_ARRAY_BUFFER, offset, size, src);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// delete the GL objects
+///////////////////////////////////////////////////////////////////////////////
+void GpuMesh::release()
+{
+    if (!vao)
+        return;
+
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ibo);
+    vao = vbo = ibo = 0;
+    indexCount = 0;
+}
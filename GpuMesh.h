@@ -0,0 +1,53 @@
+#pragma once
+// GPU buffers of an indexed mesh with interleaved V/N/T vertices
+// owns one vertex array object, one vertex buffer and one index buffer and
+// deletes them on destruction; the GL context must be current for both
+
+#ifndef GEOMETRY_GPU_MESH_H
+#define GEOMETRY_GPU_MESH_H
+
+#include <GL/glew.h>
+#include "VertexFormat.h"
+
+class GpuMesh
+{
+public:
+    // ctor/dtor
+    GpuMesh();
+    ~GpuMesh();
+
+    // create buffers and send vertex/index data to the GPU
+    // interleavedVertices: 8 floats per vertex, converted to the given format on upload
+    // vertex attributes: 0 = position, 1 = normal, 2 = tex coord
+    // indexType: GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    void upload(const float* interleavedVertices, unsigned int vertexCount,
+        const void* indices, unsigned int indexCount, GLenum indexType,
+        VertexFormat format = VERTEX_FORMAT_FLOAT);
+    // same with vertices already in the given format, e.g. from a mesh file
+    void uploadFormatted(const void* vertexData, unsigned int vertexCount,
+        const void* indices, unsigned int indexCount, GLenum indexType, VertexFormat format);
+    // replace count vertices from firstVertex of the last upload in place,
+    // e.g. the dirty range of a shape after an in-place setter
+    // interleavedVertices: the shape's whole interleaved array (8 floats per vertex)
+    void updateVertices(const float* interleavedVertices, unsigned int firstVertex, unsigned int count);
+    void release();
+
+    GLuint getVao() const { return vao; }
+    GLsizei getIndexCount() const { return indexCount; }
+    GLenum getIndexType() const { return indexType; }
+    VertexFormat getVertexFormat() const { return format; }
+
+private:
+    // buffers are not shared between objects
+    GpuMesh(const GpuMesh&) = delete;
+    GpuMesh& operator=(const GpuMesh&) = delete;
+
+    GLuint vao;
+    GLuint vbo;
+    GLuint ibo;
+    GLsizei indexCount;
+    GLenum indexType;
+    VertexFormat format;
+};
+
+#endif
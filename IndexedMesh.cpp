@@ -0,0 +1,464 @@
+// Base of the generated shapes: storage, indices, dirty ranges, GPU buffers
+
+#ifdef _WIN32
+#include <windows.h>    // include windows.h to avoid thousands of compile errors even though this class is not depending on Windows
+#endif
+
+#include <GL/glew.h>
+
+#include <cstring>
+#include "IndexedMesh.h"
+#include "MeshBuilder.h"
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor
+///////////////////////////////////////////////////////////////////////////////
+IndexedMesh::IndexedMesh()
+    : indexType(GL_UNSIGNED_INT), lineIndicesBuilt(false), storage(GEOMETRY_STORAGE_ALL),
+      interleavedStride(32), dirtyVertexStart(0), dirtyVertexEnd(0), indexDataDirty(false),
+      gpuLineIndexOffset(0)
+{
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// setters
+///////////////////////////////////////////////////////////////////////////////
+void IndexedMesh::setStorage(GeometryStorage storage)
+{
+    this->storage = storage;
+    restoreArrays();
+    applyStorage();
+}
+
+void IndexedMesh::releaseCpuData()
+{
+    clearArrays();
+    std::vector<float>().swap(interleavedVertices);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// reorder triangles for the post-transform vertex cache and overdraw, then
+// renumber vertices in first-use order
+// every index part is reordered on its own, so the shape still finds its parts
+// at the same ranges (e.g. Cylinder::drawSide()/drawBase()/drawTop())
+///////////////////////////////////////////////////////////////////////////////
+MeshOptimizationReport IndexedMesh::optimize()
+{
+    restoreArrays();
+
+    unsigned int vertexCount = getVertexCount();
+    MeshOptimizationReport report;
+    report.before = analyzeVertexCache(indices.data(), indices.size(), vertexCount);
+
+    std::vector<unsigned int> parts = getIndexParts();
+    for (std::size_t i = 0; i + 1 < parts.size(); ++i)
+        optimizeTriangleOrder(indices.data() + parts[i], parts[i + 1] - parts[i], vertices.data(), 3, vertexCount);
+    remapVertices(optimizeVertexFetch(indices.data(), indices.size(), vertexCount));
+
+    report.after = analyzeVertexCache(indices.data(), indices.size(), vertexCount);
+    applyStorage();
+    return report;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// split the triangle list into meshlets, reordering it
+// every index part is split on its own, so no meshlet spans two parts
+///////////////////////////////////////////////////////////////////////////////
+void IndexedMesh::buildMeshlets(unsigned int maxVertices, unsigned int maxTriangles)
+{
+    restoreArrays();
+
+    std::vector<unsigned int> parts = getIndexParts();
+    std::vector<Meshlet> built;
+    for (std::size_t i = 0; i + 1 < parts.size(); ++i)
+    {
+        std::vector<Meshlet> part = ::buildMeshlets(indices.data() + parts[i], parts[i + 1] - parts[i],
+            vertices.data(), 3, getVertexCount(), maxVertices, maxTriangles);
+        for (std::size_t j = 0; j < part.size(); ++j)
+            part[j].firstIndex += parts[i];
+        built.insert(built.end(), part.begin(), part.end());
+    }
+    packIndices();
+    meshlets.swap(built);
+    applyStorage();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// all triangles are one part unless the shape says otherwise
+///////////////////////////////////////////////////////////////////////////////
+std::vector<unsigned int> IndexedMesh::getIndexParts() const
+{
+    std::vector<unsigned int> parts(2, 0);
+    parts[1] = (unsigned int)indices.size();
+    return parts;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// send the vertices and triangle indices to the GPU, and the line indices
+// after the triangles in the same index buffer if asked
+// GEOMETRY_STORAGE_GPU_ONLY frees the CPU copies afterwards
+///////////////////////////////////////////////////////////////////////////////
+void IndexedMesh::upload(VertexFormat format, bool lines)
+{
+    restoreArrays();
+
+    unsigned int indexCount = getIndexCount();
+    unsigned int lineIndexCount = lines ? getLineIndexCount() : 0;
+    unsigned int elementSize = getIndexElementSize();
+    std::vector<unsigned char> gpuIndices((std::size_t)(indexCount + lineIndexCount) * elementSize);
+    if (indexCount > 0)
+        std::memcpy(gpuIndices.data(), getIndices(), (std::size_t)indexCount * elementSize);
+    if (lineIndexCount > 0)
+        std::memcpy(gpuIndices.data() + (std::size_t)indexCount * elementSize, getLineIndices(), (std::size_t)lineIndexCount * elementSize);
+
+    gpuMesh.upload(interleavedVertices.data(), getVertexCount(), gpuIndices.data(), indexCount + lineIndexCount,
+        indexType, format);
+    gpuLineIndexOffset = indexCount;
+    clearDirty();
+
+    applyStorage();
+    if (storage == GEOMETRY_STORAGE_GPU_ONLY)
+        releaseCpuData();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// patch the vertex buffer with what the in-place setters moved; a rebuild may
+// change the vertex count and the indices, so it is uploaded again
+///////////////////////////////////////////////////////////////////////////////
+void IndexedMesh::updateGpu()
+{
+    if (!gpuMesh.getVao())
+        return;     // not uploaded
+
+    if (indexDataDirty)
+    {
+        upload(gpuMesh.getVertexFormat(), (unsigned int)gpuMesh.getIndexCount() > gpuLineIndexOffset);
+        return;
+    }
+    if (getDirtyVertexCount() > 0)
+    {
+        restoreArrays();
+        gpuMesh.updateVertices(interleavedVertices.data(), dirtyVertexStart, getDirtyVertexCount());
+        applyStorage();
+    }
+    clearDirty();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// draw the uploaded triangles with the bound shader program
+// OpenGL RC must be set before calling it
+///////////////////////////////////////////////////////////////////////////////
+void IndexedMesh::draw() const
+{
+    drawRange(0, gpuLineIndexOffset);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// draw a range of the uploaded triangle indices
+///////////////////////////////////////////////////////////////////////////////
+void IndexedMesh::drawRange(unsigned int firstIndex, unsigned int indexCount) const
+{
+    if (!gpuMesh.getVao() || indexCount == 0)
+        return;     // not uploaded
+
+    std::size_t offset = (std::size_t)firstIndex * (gpuMesh.getIndexType() == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint));
+    glBindVertexArray(gpuMesh.getVao());
+    glDrawElements(GL_TRIANGLES, indexCount, gpuMesh.getIndexType(), (const void*)offset);
+    glBindVertexArray(0);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// draw lines only, if they were uploaded
+// the core profile has no current colour, so lineColor becomes the constant
+// value of vertex attribute 3 (its array is never enabled) for the shader
+// the caller must set the line width before call this
+///////////////////////////////////////////////////////////////////////////////
+void IndexedMesh::drawLines(const float lineColor[4]) const
+{
+    GLsizei lineIndexCount = gpuMesh.getIndexCount() - (GLsizei)gpuLineIndexOffset;
+    if (!gpuMesh.getVao() || lineIndexCount <= 0)
+        return;     // not uploaded with lines
+
+    glVertexAttrib4fv(3, lineColor);
+    std::size_t offset = (std::size_t)gpuLineIndexOffset * (gpuMesh.getIndexType() == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint));
+    glBindVertexArray(gpuMesh.getVao());
+    glDrawElements(GL_LINES, lineIndexCount, gpuMesh.getIndexType(), (const void*)offset);
+    glBindVertexArray(0);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// draw surfaces and lines on top of it
+// the caller must set the line width before call this
+///////////////////////////////////////////////////////////////////////////////
+void IndexedMesh::drawWithLines(const float lineColor[4]) const
+{
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(1.0, 1.0f); // move polygon backward
+    this->draw();
+    glDisable(GL_POLYGON_OFFSET_FILL);
+
+    drawLines(lineColor);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// dealloc vectors
+///////////////////////////////////////////////////////////////////////////////
+void IndexedMesh::clearArrays()
+{
+    std::vector<float>().swap(vertices);
+    std::vector<float>().swap(normals);
+    std::vector<float>().swap(texCoords);
+    std::vector<unsigned int>().swap(indices);
+    std::vector<unsigned int>().swap(lineIndices);
+    std::vector<unsigned int>().swap(stripIndices);
+    std::vector<unsigned short>().swap(shortIndices);
+    std::vector<unsigned short>().swap(shortLineIndices);
+    std::vector<unsigned short>().swap(shortStripIndices);
+    std::vector<Meshlet>().swap(meshlets);
+    lineIndicesBuilt = false;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// resize all arrays to the exact element counts of the mesh to be built
+// so the builders can write every element in place without reallocation
+///////////////////////////////////////////////////////////////////////////////
+void IndexedMesh::resizeArrays(unsigned int vertexCount, unsigned int indexCount, unsigned int stripIndexCount)
+{
+    vertices.resize(vertexCount * 3);
+    normals.resize(vertexCount * 3);
+    texCoords.resize(vertexCount * 2);
+    indices.resize(indexCount);
+    stripIndices.resize(stripIndexCount);
+    interleavedVertices.resize(vertexCount * 8);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// generate interleaved vertices: V/N/T
+// stride must be 32 bytes
+///////////////////////////////////////////////////////////////////////////////
+void IndexedMesh::buildInterleavedVertices()
+{
+    std::size_t count = vertices.size() / 3;
+    interleavedVertices.resize(count * 8);
+    interleaveVertices(vertices.data(), normals.data(), texCoords.data(), count, interleavedVertices.data());
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// wireframe from the triangles, on the first request after a build
+// works in any vertex order and from either vertex layout; with grid tex
+// coords the quad diagonals are left out, so only the grid lines remain
+///////////////////////////////////////////////////////////////////////////////
+void IndexedMesh::buildLineIndices() const
+{
+    if (lineIndicesBuilt)
+        return;
+    lineIndicesBuilt = true;
+
+    unsigned int vertexCount = getVertexCount();
+    if (vertexCount == 0)
+        return;     // released
+
+    const float* positions = vertices.data();
+    const float* uv = texCoords.data();
+    int positionStride = 3, uvStride = 2;
+    if (vertices.empty())
+    {
+        positions = interleavedVertices.data();
+        uv = positions + 6;
+        positionStride = uvStride = 8;
+    }
+    if (!hasGridTexCoords())
+        uv = 0;
+
+    lineIndices = buildEdgeIndices(indices.data(), getLineSourceIndexCount(), positions, positionStride, vertexCount,
+        uv, uvStride);
+    if (indexType == GL_UNSIGNED_SHORT)
+        shortLineIndices.assign(lineIndices.begin(), lineIndices.end());
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// free the vertex layout the storage policy does not keep
+///////////////////////////////////////////////////////////////////////////////
+void IndexedMesh::applyStorage()
+{
+    if (storage == GEOMETRY_STORAGE_INTERLEAVED || storage == GEOMETRY_STORAGE_GPU_ONLY)
+    {
+        std::vector<float>().swap(vertices);
+        std::vector<float>().swap(normals);
+        std::vector<float>().swap(texCoords);
+    }
+    else if (storage == GEOMETRY_STORAGE_SOA)
+    {
+        std::vector<float>().swap(interleavedVertices);
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// bring back both vertex layouts for the functions that write them
+// after releaseCpuData() the mesh is built again, in the unoptimized order
+///////////////////////////////////////////////////////////////////////////////
+void IndexedMesh::restoreArrays()
+{
+    if (indices.empty())
+    {
+        buildVertices();
+        return;
+    }
+
+    if (interleavedVertices.empty())
+    {
+        buildInterleavedVertices();
+    }
+    else if (vertices.empty())
+    {
+        std::size_t count = interleavedVertices.size() / 8;
+        vertices.resize(count * 3);
+        normals.resize(count * 3);
+        texCoords.resize(count * 2);
+        deinterleaveVertices(interleavedVertices.data(), count, vertices.data(), normals.data(), texCoords.data());
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// make 16-bit copies of the indices if every vertex can be addressed with them
+// 0xFFFF is kept free, so it can serve as the primitive restart index
+// runs after every change of the indices, which dirties the whole mesh and
+// drops the lines (built again on the next request) and the meshlets
+///////////////////////////////////////////////////////////////////////////////
+void IndexedMesh::packIndices()
+{
+    markDirty(0, getVertexCount());
+    indexDataDirty = true;
+    std::vector<unsigned int>().swap(lineIndices);
+    std::vector<unsigned short>().swap(shortLineIndices);
+    std::vector<Meshlet>().swap(meshlets);
+    lineIndicesBuilt = false;
+
+    if (getVertexCount() > 0xFFFF)
+    {
+        std::vector<unsigned short>().swap(shortIndices);
+        std::vector<unsigned short>().swap(shortStripIndices);
+        indexType = GL_UNSIGNED_INT;
+        return;
+    }
+
+    shortIndices.assign(indices.begin(), indices.end());
+    shortStripIndices.assign(stripIndices.begin(), stripIndices.end());    // restart index becomes 0xFFFF
+    indexType = GL_UNSIGNED_SHORT;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// grow the dirty range to cover [firstVertex, lastVertex)
+///////////////////////////////////////////////////////////////////////////////
+void IndexedMesh::markDirty(unsigned int firstVertex, unsigned int lastVertex)
+{
+    if (firstVertex >= lastVertex)
+        return;
+
+    if (dirtyVertexEnd <= dirtyVertexStart)
+    {
+        dirtyVertexStart = firstVertex;
+        dirtyVertexEnd = lastVertex;
+        return;
+    }
+    if (firstVertex < dirtyVertexStart)
+        dirtyVertexStart = firstVertex;
+    if (lastVertex > dirtyVertexEnd)
+        dirtyVertexEnd = lastVertex;
+}
+
+void IndexedMesh::clearDirty()
+{
+    dirtyVertexStart = dirtyVertexEnd = 0;
+    indexDataDirty = false;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// move every vertex to remap[oldIndex] and rewrite the strip indices to match
+// (triangle indices are already renumbered by optimizeVertexFetch())
+///////////////////////////////////////////////////////////////////////////////
+void IndexedMesh::remapVertices(const std::vector<unsigned int>& remap)
+{
+    remapVertexAttribute(vertices, 3, remap);
+    remapVertexAttribute(normals, 3, remap);
+    remapVertexAttribute(texCoords, 2, remap);
+    remapVertexAttribute(interleavedVertices, 8, remap);
+    for (std::size_t i = 0; i < stripIndices.size(); ++i)
+    {
+        if (stripIndices[i] != RESTART_INDEX)
+            stripIndices[i] = remap[stripIndices[i]];
+    }
+    packIndices();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// index arrays in the width reported by getIndexType()
+///////////////////////////////////////////////////////////////////////////////
+const void* IndexedMesh::getIndices() const
+{
+    if (indexType == GL_UNSIGNED_SHORT)
+        return shortIndices.data();
+    return indices.data();
+}
+
+const void* IndexedMesh::getLineIndices() const
+{
+    buildLineIndices();
+    if (indexType == GL_UNSIGNED_SHORT)
+        return shortLineIndices.data();
+    return lineIndices.data();
+}
+
+const void* IndexedMesh::getStripIndices() const
+{
+    if (indexType == GL_UNSIGNED_SHORT)
+        return shortStripIndices.data();
+    return stripIndices.data();
+}
+
+unsigned int IndexedMesh::getIndexElementSize() const
+{
+    return indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+}
@@ -0,0 +1,183 @@
+#pragma once
+// Base of the generated shapes (Sphere, Cylinder, ParametricMesh): the vertex
+// and index arrays and everything done with them once they are built
+// - storage policies (see GeometryStorage.h) and restoring a dropped layout
+// - 16-bit index copies, lazy line indices and triangle strips
+// - dirty vertex ranges, GPU upload and in-place updates (see GpuMesh.h)
+// - optimize() and buildMeshlets() over the index parts of the shape
+// - drawing the uploaded triangles and lines
+// a shape only builds its surface: it sizes the arrays with resizeArrays(),
+// writes them with setVertex() and the index pointers, then calls packIndices()
+
+#ifndef GEOMETRY_INDEXED_MESH_H
+#define GEOMETRY_INDEXED_MESH_H
+
+#include <vector>
+#include "GeometryStorage.h"
+#include "GpuMesh.h"
+#include "MeshOptimizer.h"
+#include "Meshlet.h"
+
+class IndexedMesh
+{
+public:
+    // ctor/dtor
+    IndexedMesh();
+    virtual ~IndexedMesh() {}
+
+    // CPU copies kept after a build, see GeometryStorage.h; applied right away
+    GeometryStorage getStorage() const { return storage; }
+    void setStorage(GeometryStorage storage);
+    void releaseCpuData();                  // free all vertex and index arrays, e.g. once uploaded
+
+    // for vertex data
+    // the getters of a layout dropped by the storage policy return 0/empty
+    unsigned int getVertexCount() const { return (unsigned int)(vertices.empty() ? interleavedVertices.size() / 8 : vertices.size() / 3); }
+    unsigned int getNormalCount() const { return (unsigned int)normals.size() / 3; }
+    unsigned int getTexCoordCount() const { return (unsigned int)texCoords.size() / 2; }
+    unsigned int getIndexCount() const { return (unsigned int)indices.size(); }
+    unsigned int getLineIndexCount() const { buildLineIndices(); return (unsigned int)lineIndices.size(); }
+    unsigned int getTriangleCount() const { return getIndexCount() / 3; }
+    unsigned int getVertexSize() const { return (unsigned int)vertices.size() * sizeof(float); }
+    unsigned int getNormalSize() const { return (unsigned int)normals.size() * sizeof(float); }
+    unsigned int getTexCoordSize() const { return (unsigned int)texCoords.size() * sizeof(float); }
+    unsigned int getIndexSize() const { return (unsigned int)indices.size() * getIndexElementSize(); }
+    unsigned int getLineIndexSize() const { return getLineIndexCount() * getIndexElementSize(); }
+    const float* getVertices() const { return vertices.data(); }
+    const float* getNormals() const { return normals.data(); }
+    const float* getTexCoords() const { return texCoords.data(); }
+    const void* getIndices() const;                     // 16 or 32-bit, see getIndexType()
+    const void* getLineIndices() const;                 // built on first use
+    unsigned int getIndexType() const { return indexType; }  // GL_UNSIGNED_SHORT if # of vertices fits, else GL_UNSIGNED_INT
+
+    // same surface as triangle strips, one per band, separated by the
+    // primitive restart index (all bits set, GL_PRIMITIVE_RESTART_FIXED_INDEX)
+    // empty for the shapes and shadings that do not build them
+    unsigned int getStripIndexCount() const { return (unsigned int)stripIndices.size(); }
+    unsigned int getStripIndexSize() const { return (unsigned int)stripIndices.size() * getIndexElementSize(); }
+    const void* getStripIndices() const;
+    unsigned int getIndexElementSize() const;           // 2 or 4 bytes
+
+    // for interleaved vertices: V/N/T
+    unsigned int getInterleavedVertexCount() const { return getVertexCount(); }    // # of vertices
+    unsigned int getInterleavedVertexSize() const { return (unsigned int)interleavedVertices.size() * sizeof(float); }    // # of bytes
+    int getInterleavedStride() const { return interleavedStride; }   // should be 32 bytes
+    const float* getInterleavedVertices() const { return interleavedVertices.data(); }
+
+    // GPU buffers, see GpuMesh.h; the GL context must be current
+    // upload() sends the vertices and triangle indices once, plus the line
+    // indices if asked; after a setter, updateGpu() sends what changed
+    void upload(VertexFormat format = VERTEX_FORMAT_FLOAT, bool lines = false);
+    void updateGpu();                       // dirty vertices only, or everything after a rebuild
+    void releaseGpu() { gpuMesh.release(); }
+    GLuint getVao() const { return gpuMesh.getVao(); }     // 0 until upload()
+
+    // draw the uploaded buffers with the bound shader program
+    // vertex attributes: 0 = position, 1 = normal, 2 = tex coord
+    void draw() const;                                  // draw surface
+    void drawLines(const float lineColor[4]) const;     // draw lines only, see the .cpp for the colour
+    void drawWithLines(const float lineColor[4]) const; // draw surface and lines
+
+    // vertices changed since the last clearDirty(), to patch GPU buffers with
+    // glBufferSubData() instead of uploading everything again
+    // in-place setters mark only the vertices they move; rebuilds mark all
+    // vertices and the indices
+    unsigned int getDirtyVertexStart() const { return dirtyVertexStart; }
+    unsigned int getDirtyVertexCount() const { return dirtyVertexEnd > dirtyVertexStart ? dirtyVertexEnd - dirtyVertexStart : 0; }
+    bool isIndexDataDirty() const { return indexDataDirty; }
+    void clearDirty();
+
+    // reorder triangles and vertices for the GPU (vertex cache, overdraw, vertex fetch)
+    // the shape is unchanged; setters that rebuild the mesh discard the new order
+    MeshOptimizationReport optimize();
+
+    // split the triangles into meshlets for culling on the CPU, see Meshlet.h
+    // reorders the triangle indices, so call it after optimize(); rebuilds and
+    // optimize() drop the meshlets
+    void buildMeshlets(unsigned int maxVertices = MESHLET_MAX_VERTICES, unsigned int maxTriangles = MESHLET_MAX_TRIANGLES);
+    const std::vector<Meshlet>& getMeshlets() const { return meshlets; }
+
+    // member functions
+    virtual void buildVertices() = 0;       // build the surface for the current settings
+    virtual std::vector<unsigned int> getIndexParts() const;     // starts of the triangle ranges kept apart, then the end
+    virtual unsigned int getLineSourceIndexCount() const { return (unsigned int)indices.size(); }  // leading triangle indices the lines come from
+    virtual bool hasGridTexCoords() const { return true; }      // tex coords tell the quad diagonals apart
+    void clearArrays();
+    void resizeArrays(unsigned int vertexCount, unsigned int indexCount, unsigned int stripIndexCount);
+    void buildInterleavedVertices();
+    void buildLineIndices() const;
+    void applyStorage();
+    void restoreArrays();
+    void drawRange(unsigned int firstIndex, unsigned int indexCount) const;
+    void packIndices();
+    void markDirty(unsigned int firstVertex, unsigned int lastVertex);
+    void remapVertices(const std::vector<unsigned int>& remap);
+    void setVertex(unsigned int index, float x, float y, float z,
+        float nx, float ny, float nz, float s, float t);
+
+    // memeber vars
+    std::vector<float> vertices;
+    std::vector<float> normals;
+    std::vector<float> texCoords;
+    std::vector<unsigned int> indices;
+    mutable std::vector<unsigned int> lineIndices;  // lazy, see buildLineIndices()
+    std::vector<unsigned int> stripIndices;
+    std::vector<unsigned short> shortIndices;       // 16-bit copies for the GPU, empty if indices don't fit
+    mutable std::vector<unsigned short> shortLineIndices;
+    std::vector<unsigned short> shortStripIndices;
+    std::vector<Meshlet> meshlets;                  // triangle ranges, empty until buildMeshlets()
+    unsigned int indexType;                         // GL type of getIndices()/getLineIndices()
+    mutable bool lineIndicesBuilt;
+    GeometryStorage storage;
+
+    // interleaved
+    std::vector<float> interleavedVertices;
+    int interleavedStride;                  // # of bytes to hop to the next vertex (should be 32 bytes)
+
+    // changed since the last clearDirty()
+    unsigned int dirtyVertexStart;
+    unsigned int dirtyVertexEnd;            // one past the last dirty vertex
+    bool indexDataDirty;
+
+    // GPU buffers
+    GpuMesh gpuMesh;
+    unsigned int gpuLineIndexOffset;        // # of triangle indices uploaded, the lines follow
+
+    static const unsigned int RESTART_INDEX = 0xFFFFFFFF;   // GL_PRIMITIVE_RESTART_FIXED_INDEX, 0xFFFF once packed
+};
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// write a single vertex to the preallocated arrays (separate and interleaved)
+// inline, it runs once per vertex in the builders of every shape
+///////////////////////////////////////////////////////////////////////////////
+inline void IndexedMesh::setVertex(unsigned int index, float x, float y, float z,
+    float nx, float ny, float nz, float s, float t)
+{
+    float* v = &vertices[index * 3];
+    v[0] = x;
+    v[1] = y;
+    v[2] = z;
+
+    float* n = &normals[index * 3];
+    n[0] = nx;
+    n[1] = ny;
+    n[2] = nz;
+
+    float* tc = &texCoords[index * 2];
+    tc[0] = s;
+    tc[1] = t;
+
+    float* iv = &interleavedVertices[index * 8];
+    iv[0] = x;
+    iv[1] = y;
+    iv[2] = z;
+    iv[3] = nx;
+    iv[4] = ny;
+    iv[5] = nz;
+    iv[6] = s;
+    iv[7] = t;
+}
+
+#endif
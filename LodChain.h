@@ -0,0 +1,97 @@
+#pragma once
+// Discrete levels of detail of one primitive, finest first
+// each level is used while the primitive's projected radius in pixels stays
+// above the level's threshold; switching needs a margin (hysteresis) so an
+// object near a threshold does not flip every frame
+
+#ifndef GEOMETRY_LOD_CHAIN_H
+#define GEOMETRY_LOD_CHAIN_H
+
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include "SharedMesh.h"
+
+const int LOD_MAX_LEVEL_COUNT = 4;
+const float LOD_EDGE_PIXELS = 8.0f;         // target on-screen length of a sector edge
+const float LOD_SIMPLIFY_ERROR_PIXELS = 2.0f;   // largest on-screen error of a simplified level, see simplifyMesh()
+const float LOD_HYSTERESIS = 0.15f;         // relative margin around thresholds
+
+// radius in pixels of a bounding sphere at the model origin
+// works for perspective and orthographic projections
+inline float computeScreenRadius(const glm::mat4& modelView, const glm::mat4& projection,
+    float boundingRadius, float viewportHeight)
+{
+    // largest axis scale of the model-view transform
+    float scale = glm::length(glm::vec3(modelView[0]));
+    scale = glm::max(scale, glm::length(glm::vec3(modelView[1])));
+    scale = glm::max(scale, glm::length(glm::vec3(modelView[2])));
+
+    // clip w of the centre: -z for perspective, 1 for orthographic
+    float viewZ = modelView[3][2];
+    float w = projection[2][3] * viewZ + projection[3][3];
+    if (w <= 0.0f)
+        return 0.0f;            // centre behind the eye; use the coarsest level
+
+    return boundingRadius * scale * projection[1][1] / w * viewportHeight * 0.5f;
+}
+
+
+
+template<class Shape>
+class LodChain
+{
+public:
+    typedef std::shared_ptr<const SharedMesh<Shape>> MeshPtr;
+
+    // levels must be added finest first, with decreasing thresholds
+    void addLevel(const MeshPtr& mesh, float minScreenRadius)
+    {
+        levels.push_back(mesh);
+        minScreenRadii.push_back(minScreenRadius);
+    }
+
+    int getLevelCount() const { return (int)levels.size(); }
+    const MeshPtr& getLevel(int level) const { return levels[level]; }
+    float getMinScreenRadius(int level) const { return minScreenRadii[level]; }
+    void clear() { levels.clear(); minScreenRadii.clear(); }
+
+    // level for a projected radius in pixels, given the level used last time
+    // (-1 if none); moving finer needs the radius to pass the next finer
+    // threshold by the hysteresis margin, moving coarser needs it to drop
+    // below the current threshold by the same margin
+    int selectLevel(float screenRadius, int currentLevel, float hysteresis = LOD_HYSTERESIS) const
+    {
+        int last = (int)levels.size() - 1;
+        if (currentLevel < 0 || currentLevel > last)
+        {
+            int level = 0;
+            while (level < last && screenRadius < minScreenRadii[level])
+                ++level;
+            return level;
+        }
+
+        int level = currentLevel;
+        while (level > 0 && screenRadius >= minScreenRadii[level - 1] * (1.0f + hysteresis))
+            --level;
+        while (level < last && screenRadius < minScreenRadii[level] * (1.0f - hysteresis))
+            ++level;
+        return level;
+    }
+
+    // pick the level for a draw with these matrices and update currentLevel
+    const SharedMesh<Shape>& select(const glm::mat4& modelView, const glm::mat4& projection,
+        float viewportHeight, int& currentLevel) const
+    {
+        float boundingRadius = levels[0]->getBoundingRadius();
+        float screenRadius = computeScreenRadius(modelView, projection, boundingRadius, viewportHeight);
+        currentLevel = selectLevel(screenRadius, currentLevel);
+        return *levels[currentLevel];
+    }
+
+private:
+    std::vector<MeshPtr> levels;
+    std::vector<float> minScreenRadii;
+};
+
+#endif
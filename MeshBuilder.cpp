@@ -0,0 +1,120 @@
+// Helpers shared by the geometry builders
+
+#include <cmath>
+#include "MeshBuilder.h"
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// compute face normal of a triangle v1-v2-v3 into normal[3]
+// if a triangle has no surface (normal length = 0), then it is a zero vector
+///////////////////////////////////////////////////////////////////////////////
+void computeFaceNormal(float x1, float y1, float z1,  // v1
+    float x2, float y2, float z2,  // v2
+    float x3, float y3, float z3,  // v3
+    float normal[3])
+{
+    const float EPSILON = 0.000001f;
+
+    normal[0] = normal[1] = normal[2] = 0.0f;   // default (0,0,0)
+    float nx, ny, nz;
+
+    // find 2 edge vectors: v1-v2, v1-v3
+    float ex1 = x2 - x1;
+    float ey1 = y2 - y1;
+    float ez1 = z2 - z1;
+    float ex2 = x3 - x1;
+    float ey2 = y3 - y1;
+    float ez2 = z3 - z1;
+
+    // cross product: e1 x e2
+    nx = ey1 * ez2 - ez1 * ey2;
+    ny = ez1 * ex2 - ex1 * ez2;
+    nz = ex1 * ey2 - ey1 * ex2;
+
+    // normalize only if the length is > 0
+    float length = sqrtf(nx * nx + ny * ny + nz * nz);
+    if (length > EPSILON)
+    {
+        // normalize
+        float lengthInv = 1.0f / length;
+        normal[0] = nx * lengthInv;
+        normal[1] = ny * lengthInv;
+        normal[2] = nz * lengthInv;
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// the diagonals of a planar quad span its plane, even when one edge has
+// collapsed and the quad is a triangle
+///////////////////////////////////////////////////////////////////////////////
+void computeQuadNormal(const float v1[3], const float v2[3], const float v3[3], const float v4[3],
+    float normal[3])
+{
+    float dx1 = v4[0] - v1[0];
+    float dy1 = v4[1] - v1[1];
+    float dz1 = v4[2] - v1[2];
+    float dx2 = v3[0] - v2[0];
+    float dy2 = v3[1] - v2[1];
+    float dz2 = v3[2] - v2[2];
+
+    float nx = dy1 * dz2 - dz1 * dy2;
+    float ny = dz1 * dx2 - dx1 * dz2;
+    float nz = dx1 * dy2 - dy1 * dx2;
+
+    normal[0] = normal[1] = normal[2] = 0.0f;
+    float length = sqrtf(nx * nx + ny * ny + nz * nz);
+    if (length > 0)
+    {
+        float lengthInv = 1.0f / length;
+        normal[0] = nx * lengthInv;
+        normal[1] = ny * lengthInv;
+        normal[2] = nz * lengthInv;
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// separate arrays <=> interleaved V/N/T
+///////////////////////////////////////////////////////////////////////////////
+void interleaveVertices(const float* vertices, const float* normals, const float* texCoords,
+    std::size_t count, float* interleavedVertices)
+{
+    float* dst = interleavedVertices;
+    const float* v = vertices;
+    const float* n = normals;
+    const float* t = texCoords;
+    for (std::size_t i = 0; i < count; ++i, v += 3, n += 3, t += 2, dst += 8)
+    {
+        dst[0] = v[0];
+        dst[1] = v[1];
+        dst[2] = v[2];
+
+        dst[3] = n[0];
+        dst[4] = n[1];
+        dst[5] = n[2];
+
+        dst[6] = t[0];
+        dst[7] = t[1];
+    }
+}
+
+void deinterleaveVertices(const float* interleavedVertices, std::size_t count,
+    float* vertices, float* normals, float* texCoords)
+{
+    const float* src = interleavedVertices;
+    for (std::size_t i = 0; i < count; ++i, src += 8)
+    {
+        vertices[i * 3] = src[0];
+        vertices[i * 3 + 1] = src[1];
+        vertices[i * 3 + 2] = src[2];
+        normals[i * 3] = src[3];
+        normals[i * 3 + 1] = src[4];
+        normals[i * 3 + 2] = src[5];
+        texCoords[i * 2] = src[6];
+        texCoords[i * 2 + 1] = src[7];
+    }
+}
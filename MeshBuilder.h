@@ -0,0 +1,27 @@
+#pragma once
+// Helpers shared by the geometry builders (Sphere, Cylinder, ParametricMesh)
+// face normals, and conversion between the separate position/normal/tex coord
+// arrays and the interleaved V/N/T array (8 floats per vertex)
+
+#ifndef GEOMETRY_MESH_BUILDER_H
+#define GEOMETRY_MESH_BUILDER_H
+
+#include <cstddef>
+
+// unit normal of the triangle v1-v2-v3 (counter-clockwise), (0,0,0) if degenerate
+void computeFaceNormal(float x1, float y1, float z1,
+    float x2, float y2, float z2,
+    float x3, float y3, float z3, float normal[3]);
+
+// unit normal of the quad v1-v2-v4-v3 from its diagonals (v4-v1) x (v3-v2)
+// still valid if 2 corners meet, e.g. at a pole
+void computeQuadNormal(const float v1[3], const float v2[3], const float v3[3], const float v4[3],
+    float normal[3]);
+
+// count vertices of 3 positions, 3 normals and 2 tex coords <=> 8 floats each
+void interleaveVertices(const float* vertices, const float* normals, const float* texCoords,
+    std::size_t count, float* interleavedVertices);
+void deinterleaveVertices(const float* interleavedVertices, std::size_t count,
+    float* vertices, float* normals, float* texCoords);
+
+#endif
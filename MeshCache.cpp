@@ -0,0 +1,222 @@
+// Shared cache of generated primitives (flyweight)
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+#include <tuple>
+#include "MeshCache.h"
+
+
+
+// constants //////////////////////////////////////////////////////////////////
+const float PI = 3.14159265358979323846f;
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// strict weak ordering of keys for std::map
+///////////////////////////////////////////////////////////////////////////////
+bool MeshKey::operator<(const MeshKey& rhs) const
+{
+    return std::tie(type, baseRadius, topRadius, height, sectorCount, stackCount, smooth, lodLevel)
+        < std::tie(rhs.type, rhs.baseRadius, rhs.topRadius, rhs.height, rhs.sectorCount, rhs.stackCount, rhs.smooth, rhs.lodLevel);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// hash of every field, one by one so padding bytes never count
+///////////////////////////////////////////////////////////////////////////////
+unsigned long long MeshKey::hash(unsigned long long seed) const
+{
+    unsigned long long h = seed;
+    h = hashMeshParams(&type, sizeof(type), h);
+    h = hashMeshParams(&baseRadius, sizeof(baseRadius), h);
+    h = hashMeshParams(&topRadius, sizeof(topRadius), h);
+    h = hashMeshParams(&height, sizeof(height), h);
+    h = hashMeshParams(&sectorCount, sizeof(sectorCount), h);
+    h = hashMeshParams(&stackCount, sizeof(stackCount), h);
+    h = hashMeshParams(&smooth, sizeof(smooth), h);
+    h = hashMeshParams(&lodLevel, sizeof(lodLevel), h);
+    return h;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor
+///////////////////////////////////////////////////////////////////////////////
+MeshCache::MeshCache(const MeshBuildOptions& options) : options(options)
+{
+    if (!options.cacheDirectory.empty())
+    {
+        std::error_code error;
+        std::filesystem::create_directories(options.cacheDirectory, error);
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// build the key for the params and share or create the mesh
+///////////////////////////////////////////////////////////////////////////////
+std::shared_ptr<const SharedMesh<Sphere>> MeshCache::getSphere(float radius, int sectors,
+    int stacks, bool smooth)
+{
+    MeshKey key = { MeshKey::SPHERE, radius, 0.0f, 0.0f, sectors, stacks, smooth };
+    return findOrCreate<Sphere>(key, radius, sectors, stacks, smooth);
+}
+
+std::shared_ptr<const SharedMesh<Sphere>> MeshCache::getSphere(float radius, SphereTopology topology,
+    int subdivisions, bool smooth)
+{
+    if (topology == SPHERE_TOPOLOGY_UV)
+        return getSphere(radius, 36, 18, smooth);       // same as Sphere(radius, SPHERE_TOPOLOGY_UV, ...)
+
+    MeshKey::Type type = topology == SPHERE_TOPOLOGY_ICOSPHERE ? MeshKey::ICOSPHERE : MeshKey::CUBE_SPHERE;
+    MeshKey key = { type, radius, 0.0f, 0.0f, subdivisions, 0, smooth };
+    return findOrCreate<Sphere>(key, radius, topology, subdivisions, smooth);
+}
+
+std::shared_ptr<const SharedMesh<Cylinder>> MeshCache::getCylinder(float baseRadius, float topRadius,
+    float height, int sectors, int stacks, bool smooth)
+{
+    MeshKey key = { MeshKey::CYLINDER, baseRadius, topRadius, height, sectors, stacks, smooth };
+    return findOrCreate<Cylinder>(key, baseRadius, topRadius, height, sectors, stacks, smooth);
+}
+
+std::shared_ptr<const SharedMesh<Torus>> MeshCache::getTorus(float majorRadius, float minorRadius,
+    float sweepAngle, int sectors, int sides, bool smooth)
+{
+    MeshKey key = { MeshKey::TORUS, majorRadius, minorRadius, sweepAngle, sectors, sides, smooth };
+    return findOrCreate<Torus>(key, TorusSurface(majorRadius, minorRadius, sweepAngle), sectors, sides, smooth);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// halve the tessellation per level; a level is drawn while a sector edge
+// (2 * pi * r / sectors) stays at least LOD_EDGE_PIXELS long on screen
+// simplified levels keep the thresholds of the levels they replace; once one
+// can't be simplified, the rest of the chain is tessellated
+///////////////////////////////////////////////////////////////////////////////
+LodChain<Sphere> MeshCache::getSphereLods(float radius, int sectors, int stacks, bool smooth,
+    int levelCount)
+{
+    LodChain<Sphere> chain;
+    std::unique_ptr<Sphere> finest;         // CPU copy of level 0 to simplify, built on first use
+    bool simplify = options.simplifyLods && smooth;
+    int prevSectors = 0, prevStacks = 0;
+    for (int level = 0; level < levelCount; ++level)
+    {
+        int levelSectors = std::max(3, sectors >> level);
+        int levelStacks = std::max(2, stacks >> level);
+        if (levelSectors == prevSectors && levelStacks == prevStacks)
+            break;
+        prevSectors = levelSectors;
+        prevStacks = levelStacks;
+
+        float minScreenRadius = LOD_EDGE_PIXELS * levelSectors / (2 * PI);
+        if (level > 0 && simplify)
+        {
+            if (!finest)
+                finest.reset(new Sphere(radius, sectors, stacks, smooth));
+            MeshKey key = { MeshKey::SPHERE, radius, 0.0f, 0.0f, sectors, stacks, smooth, level };
+            std::shared_ptr<const SharedMesh<Sphere>> mesh = findOrSimplify(key, *finest, chain.getMinScreenRadius(level - 1));
+            if (mesh)
+            {
+                chain.addLevel(mesh, minScreenRadius);
+                continue;
+            }
+            simplify = false;           // tessellated from here on
+        }
+        chain.addLevel(getSphere(radius, levelSectors, levelStacks, smooth), minScreenRadius);
+    }
+    return chain;
+}
+
+LodChain<Cylinder> MeshCache::getCylinderLods(float baseRadius, float topRadius, float height,
+    int sectors, int stacks, bool smooth, int levelCount)
+{
+    LodChain<Cylinder> chain;
+    std::unique_ptr<Cylinder> finest;       // CPU copy of level 0 to simplify, built on first use
+    bool simplify = options.simplifyLods && smooth;
+    int prevSectors = 0, prevStacks = 0;
+    for (int level = 0; level < levelCount; ++level)
+    {
+        int levelSectors = std::max(3, sectors >> level);
+        int levelStacks = std::max(1, stacks >> level);
+        if (levelSectors == prevSectors && levelStacks == prevStacks)
+            break;
+        prevSectors = levelSectors;
+        prevStacks = levelStacks;
+
+        float minScreenRadius = LOD_EDGE_PIXELS * levelSectors / (2 * PI);
+        if (level > 0 && simplify)
+        {
+            if (!finest)
+                finest.reset(new Cylinder(baseRadius, topRadius, height, sectors, stacks, smooth));
+            MeshKey key = { MeshKey::CYLINDER, baseRadius, topRadius, height, sectors, stacks, smooth, level };
+            std::shared_ptr<const SharedMesh<Cylinder>> mesh = findOrSimplify(key, *finest, chain.getMinScreenRadius(level - 1));
+            if (mesh)
+            {
+                chain.addLevel(mesh, minScreenRadius);
+                continue;
+            }
+            simplify = false;           // tessellated from here on
+        }
+        chain.addLevel(getCylinder(baseRadius, topRadius, height, levelSectors, levelStacks, smooth), minScreenRadius);
+    }
+    return chain;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// the options change the uploaded data, so they are part of the hash
+// (the storage policy only affects the CPU side and is left out)
+///////////////////////////////////////////////////////////////////////////////
+unsigned long long MeshCache::getParamHash(const MeshKey& key) const
+{
+    unsigned long long h = key.hash();
+    h = hashMeshParams(&options.vertexFormat, sizeof(options.vertexFormat), h);
+    h = hashMeshParams(&options.optimize, sizeof(options.optimize), h);
+    h = hashMeshParams(&options.strips, sizeof(options.strips), h);
+    h = hashMeshParams(&options.meshlets, sizeof(options.meshlets), h);
+    return h;
+}
+
+std::string MeshCache::getMeshFilePath(unsigned long long paramHash) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "mesh_%016llx.bin", paramHash);
+    return (std::filesystem::path(options.cacheDirectory) / name).string();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// bookkeeping
+///////////////////////////////////////////////////////////////////////////////
+std::size_t MeshCache::getMeshCount() const
+{
+    std::size_t count = 0;
+    for (std::map<MeshKey, std::weak_ptr<const void>>::const_iterator it = meshes.begin(); it != meshes.end(); ++it)
+    {
+        if (!it->second.expired())
+            ++count;
+    }
+    return count;
+}
+
+void MeshCache::purge()
+{
+    for (std::map<MeshKey, std::weak_ptr<const void>>::iterator it = meshes.begin(); it != meshes.end();)
+    {
+        if (it->second.expired())
+            it = meshes.erase(it);
+        else
+            ++it;
+    }
+}
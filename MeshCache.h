@@ -0,0 +1,170 @@
+#pragma once
+// Shared cache of generated primitives (flyweight)
+// identical primitives are generated and uploaded to the GPU once; every caller
+// asking for the same parameters gets the same reference-counted, immutable
+// mesh, which is released when the last reference goes away
+// with a cache directory, every generated mesh is also written to a mesh file
+// there, and later runs upload it from the mapped file instead of building it
+
+#ifndef GEOMETRY_MESH_CACHE_H
+#define GEOMETRY_MESH_CACHE_H
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include "Cylinder.h"
+#include "ParametricSurfaces.h"
+#include "Sphere.h"
+#include "SharedMesh.h"
+#include "LodChain.h"
+
+// parameters identifying a generated primitive
+struct MeshKey
+{
+    enum Type
+    {
+        SPHERE,
+        CYLINDER,
+        ICOSPHERE,                          // sectorCount = subdivisions, stackCount unused
+        CUBE_SPHERE,
+        TORUS                               // major/minor radius, sweep angle as height
+    };
+
+    Type type;
+    float baseRadius;                       // radius of a sphere
+    float topRadius;
+    float height;
+    int sectorCount;
+    int stackCount;
+    bool smooth;
+    int lodLevel = 0;                       // > 0: simplified from level 0 for a LOD chain
+
+    bool operator<(const MeshKey& rhs) const;
+    unsigned long long hash(unsigned long long seed = MESH_HASH_SEED) const;
+};
+
+
+
+class MeshCache
+{
+public:
+    // every mesh of this cache is built with the same options
+    // the cache directory is created if needed
+    explicit MeshCache(const MeshBuildOptions& options = MeshBuildOptions());
+
+    // return the shared mesh for these params, generating and uploading it on first use
+    // the GL context must be current
+    std::shared_ptr<const SharedMesh<Sphere>> getSphere(float radius, int sectorCount,
+        int stackCount, bool smooth = true);
+    std::shared_ptr<const SharedMesh<Sphere>> getSphere(float radius, SphereTopology topology,
+        int subdivisionCount, bool smooth = true);
+    std::shared_ptr<const SharedMesh<Cylinder>> getCylinder(float baseRadius, float topRadius,
+        float height, int sectorCount, int stackCount, bool smooth = true);
+    std::shared_ptr<const SharedMesh<Torus>> getTorus(float majorRadius, float minorRadius,
+        float sweepAngle, int sectorCount, int sideCount, bool smooth = true);
+
+    // LOD chain from the given tessellation (level 0) down, halving sectors
+    // and stacks per level until levelCount levels or the minimum tessellation
+    // every level is a shared mesh of this cache
+    // with MeshBuildOptions::simplifyLods, smooth levels are simplified from
+    // level 0 to the same triangle count instead, until the simplifier can't
+    // get there within LOD_SIMPLIFY_ERROR_PIXELS; simplified levels are built
+    // on every run, they are not written to mesh files
+    LodChain<Sphere> getSphereLods(float radius, int sectorCount, int stackCount,
+        bool smooth = true, int levelCount = LOD_MAX_LEVEL_COUNT);
+    LodChain<Cylinder> getCylinderLods(float baseRadius, float topRadius, float height,
+        int sectorCount, int stackCount, bool smooth = true, int levelCount = LOD_MAX_LEVEL_COUNT);
+
+    // # of meshes still referenced by someone
+    std::size_t getMeshCount() const;
+
+    // forget entries whose meshes have been released
+    void purge();
+
+    const MeshBuildOptions& getOptions() const { return options; }
+
+private:
+    // live mesh for the key, else one loaded from its mesh file, else a new one
+    template<class Shape, class... Args>
+    std::shared_ptr<const SharedMesh<Shape>> findOrCreate(const MeshKey& key, Args&&... args);
+
+    // live simplified level for the key, else one simplified from finest
+    // null if it keeps more than twice the triangles of the tessellated level
+    template<class Shape>
+    std::shared_ptr<const SharedMesh<Shape>> findOrSimplify(const MeshKey& key, const Shape& finest,
+        float maxScreenRadius);
+
+    unsigned long long getParamHash(const MeshKey& key) const;     // key + options
+    std::string getMeshFilePath(unsigned long long paramHash) const;
+
+    MeshBuildOptions options;
+
+    // weak references, so the cache itself never keeps a mesh alive
+    std::map<MeshKey, std::weak_ptr<const void>> meshes;
+};
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// a mesh file is only trusted if its header carries the same param hash
+///////////////////////////////////////////////////////////////////////////////
+template<class Shape, class... Args>
+std::shared_ptr<const SharedMesh<Shape>> MeshCache::findOrCreate(const MeshKey& key, Args&&... args)
+{
+    std::weak_ptr<const void>& entry = meshes[key];
+    if (std::shared_ptr<const void> mesh = entry.lock())
+        return std::static_pointer_cast<const SharedMesh<Shape>>(mesh);
+
+    std::shared_ptr<SharedMesh<Shape>> mesh;
+    unsigned long long paramHash = getParamHash(key);
+    if (!options.cacheDirectory.empty())
+    {
+        MeshFile file;
+        if (file.open(getMeshFilePath(paramHash), paramHash))
+            mesh = std::make_shared<SharedMesh<Shape>>(file, options.geometryBuffer);
+    }
+
+    if (!mesh)
+    {
+        mesh = std::make_shared<SharedMesh<Shape>>(options, std::forward<Args>(args)...);
+        if (!options.cacheDirectory.empty())
+            mesh->save(getMeshFilePath(paramHash), paramHash);
+        mesh->applyStorage(options.storage);
+    }
+
+    entry = mesh;
+    return mesh;
+}
+
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// level n aims at 1/4^n of the triangles, like halving sectors and stacks
+// the error allowed is LOD_SIMPLIFY_ERROR_PIXELS at the largest screen radius
+// the level is drawn at (the threshold of the level before it)
+///////////////////////////////////////////////////////////////////////////////
+template<class Shape>
+std::shared_ptr<const SharedMesh<Shape>> MeshCache::findOrSimplify(const MeshKey& key, const Shape& finest,
+    float maxScreenRadius)
+{
+    std::weak_ptr<const void>& entry = meshes[key];
+    if (std::shared_ptr<const void> mesh = entry.lock())
+        return std::static_pointer_cast<const SharedMesh<Shape>>(mesh);
+
+    std::size_t targetTriangleCount = finest.getTriangleCount() >> (2 * key.lodLevel);
+    float maxError = finest.getBoundingRadius() * LOD_SIMPLIFY_ERROR_PIXELS / maxScreenRadius;
+    SimplifiedMesh simplified = simplifyMesh(finest.getInterleavedVertices(), finest.getInterleavedVertexCount(),
+        finest.indices.data(), finest.indices.size(), targetTriangleCount, maxError);
+    if (simplified.indices.size() / 3 > 2 * targetTriangleCount)
+        return std::shared_ptr<const SharedMesh<Shape>>();
+
+    std::shared_ptr<const SharedMesh<Shape>> mesh =
+        std::make_shared<SharedMesh<Shape>>(simplified, finest.getBoundingRadius(), options);
+    entry = mesh;
+    return mesh;
+}
+
+#endif
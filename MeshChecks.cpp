@@ -0,0 +1,378 @@
+// Self-checks of the shape builders against a reference build
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "Cylinder.h"
+#include "MeshBuilder.h"
+#include "MeshChecks.h"
+#include "SinCos.h"
+#include "Sphere.h"
+#include "ThreadPool.h"
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// same size and bytes; empty arrays match
+///////////////////////////////////////////////////////////////////////////////
+template<class T>
+static bool sameArray(const std::vector<T>& a, const std::vector<T>& b)
+{
+    return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+// largest differences allowed between a flat build and its reference; the
+// positions and tex coords differ by a few ulps of the sines and cosines, the
+// face normals by that over the shortest edge of the finest tessellation
+const float FLAT_POSITION_TOLERANCE = 1.0e-6f;
+const float FLAT_NORMAL_TOLERANCE = 1.0e-4f;
+
+// output of a reference builder
+struct ReferenceMesh
+{
+    std::vector<float> vertices;
+    std::vector<float> normals;
+    std::vector<float> texCoords;
+    std::vector<unsigned int> indices;
+};
+
+// tmp vertex of the reference builders (x,y,z,s,t)
+struct ReferenceVertex
+{
+    float x, y, z, s, t;
+};
+
+static void addVertex(ReferenceMesh& mesh, const ReferenceVertex& v, const float n[3])
+{
+    mesh.vertices.push_back(v.x);
+    mesh.vertices.push_back(v.y);
+    mesh.vertices.push_back(v.z);
+    mesh.normals.push_back(n[0]);
+    mesh.normals.push_back(n[1]);
+    mesh.normals.push_back(n[2]);
+    mesh.texCoords.push_back(v.s);
+    mesh.texCoords.push_back(v.t);
+}
+
+static void addIndices(ReferenceMesh& mesh, unsigned int i1, unsigned int i2, unsigned int i3)
+{
+    mesh.indices.push_back(i1);
+    mesh.indices.push_back(i2);
+    mesh.indices.push_back(i3);
+}
+
+// same size, and no value further than tolerance from the other
+static bool closeArray(const std::vector<float>& a, const std::vector<float>& b, float tolerance)
+{
+    if (a.size() != b.size())
+        return false;
+    for (std::size_t i = 0; i < a.size(); ++i)
+    {
+        if (!(std::fabs(a[i] - b[i]) <= tolerance))
+            return false;
+    }
+    return true;
+}
+
+// the indices must be identical, the floats only close: the builders take
+// their sines and cosines from SinCos.h, the references from cosf()/sinf()
+static bool closeMesh(const IndexedMesh& a, const ReferenceMesh& b)
+{
+    return closeArray(a.vertices, b.vertices, FLAT_POSITION_TOLERANCE) &&
+        closeArray(a.normals, b.normals, FLAT_NORMAL_TOLERANCE) &&
+        closeArray(a.texCoords, b.texCoords, FLAT_POSITION_TOLERANCE) &&
+        sameArray(a.indices, b.indices);
+}
+
+static bool sameMesh(const IndexedMesh& a, const IndexedMesh& b)
+{
+    return sameArray(a.interleavedVertices, b.interleavedVertices) &&
+        sameArray(a.indices, b.indices) &&
+        sameArray(a.stripIndices, b.stripIndices);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// the tessellations have 64K+ vertices so the pool is used, with odd counts
+// so the rows don't split evenly
+///////////////////////////////////////////////////////////////////////////////
+bool checkParallelBuild(ThreadPool& pool)
+{
+    const int SPHERE_COUNTS[][2] = { { 256, 256 }, { 511, 300 } };
+    for (int i = 0; i < 2; ++i)
+    {
+        Sphere serial(1.0f, SPHERE_COUNTS[i][0], SPHERE_COUNTS[i][1], true);
+        Sphere parallel(1.0f, SPHERE_COUNTS[i][0], SPHERE_COUNTS[i][1], true, &pool);
+        if (!sameMesh(serial, parallel))
+            return false;
+    }
+
+    const int CYLINDER_COUNTS[][2] = { { 1024, 64 }, { 333, 257 } };
+    for (int i = 0; i < 2; ++i)
+    {
+        Cylinder serial(1.0f, 0.5f, 2.0f, CYLINDER_COUNTS[i][0], CYLINDER_COUNTS[i][1], true);
+        Cylinder parallel(1.0f, 0.5f, 2.0f, CYLINDER_COUNTS[i][0], CYLINDER_COUNTS[i][1], true, &pool);
+        if (!sameMesh(serial, parallel))
+            return false;
+    }
+    return true;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// flat UV sphere as built before the in-place builder: all (x,y,z,s,t) staged
+// first with cosf()/sinf() of every vertex angle, then 1 triangle per sector
+// for the 1st/last stacks and a quad for the others, pushed one vertex at a time
+///////////////////////////////////////////////////////////////////////////////
+static ReferenceMesh buildReferenceSphereFlat(const Sphere& sphere)
+{
+    const float PI = acos(-1);
+    int sectorCount = sphere.sectorCount;
+    int stackCount = sphere.stackCount;
+    float sectorStep = 2 * PI / sectorCount;
+    float stackStep = PI / stackCount;
+    std::vector<ReferenceVertex> tmpVertices;
+    for (int i = 0; i <= stackCount; ++i)
+    {
+        float stackAngle = PI / 2 - i * stackStep;             // starting from pi/2 to -pi/2
+        float xy = sphere.radius * cosf(stackAngle);           // r * cos(u)
+        float z = sphere.radius * sinf(stackAngle);            // r * sin(u)
+        for (int j = 0; j <= sectorCount; ++j)
+        {
+            float sectorAngle = j * sectorStep;                 // starting from 0 to 2pi
+            ReferenceVertex vertex = { xy * cosf(sectorAngle), xy * sinf(sectorAngle), z,
+                (float)j / sectorCount, (float)i / stackCount };
+            tmpVertices.push_back(vertex);
+        }
+    }
+
+    ReferenceMesh mesh;
+    float n[3];
+    unsigned int index = 0;
+    for (int i = 0; i < stackCount; ++i)
+    {
+        int vi1 = i * (sectorCount + 1);
+        int vi2 = (i + 1) * (sectorCount + 1);
+        for (int j = 0; j < sectorCount; ++j, ++vi1, ++vi2)
+        {
+            //  v1--v3
+            //  |    |
+            //  v2--v4
+            const ReferenceVertex& v1 = tmpVertices[vi1];
+            const ReferenceVertex& v2 = tmpVertices[vi2];
+            const ReferenceVertex& v3 = tmpVertices[vi1 + 1];
+            const ReferenceVertex& v4 = tmpVertices[vi2 + 1];
+            if (i == 0)
+            {
+                computeFaceNormal(v1.x, v1.y, v1.z, v2.x, v2.y, v2.z, v4.x, v4.y, v4.z, n);
+                addVertex(mesh, v1, n);
+                addVertex(mesh, v2, n);
+                addVertex(mesh, v4, n);
+                addIndices(mesh, index, index + 1, index + 2);
+                index += 3;
+            }
+            else if (i == (stackCount - 1))
+            {
+                computeFaceNormal(v1.x, v1.y, v1.z, v2.x, v2.y, v2.z, v3.x, v3.y, v3.z, n);
+                addVertex(mesh, v1, n);
+                addVertex(mesh, v2, n);
+                addVertex(mesh, v3, n);
+                addIndices(mesh, index, index + 1, index + 2);
+                index += 3;
+            }
+            else
+            {
+                computeFaceNormal(v1.x, v1.y, v1.z, v2.x, v2.y, v2.z, v3.x, v3.y, v3.z, n);
+                addVertex(mesh, v1, n);
+                addVertex(mesh, v2, n);
+                addVertex(mesh, v3, n);
+                addVertex(mesh, v4, n);
+                addIndices(mesh, index, index + 1, index + 2);
+                addIndices(mesh, index + 2, index + 1, index + 3);
+                index += 4;
+            }
+        }
+    }
+    return mesh;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// flat cylinder as built before the in-place builder: side vertices staged
+// from a unit circle of cos()/sin() of every sector angle, a quad per sector
+// and stack, then the base and top as a centre and a fan of rim vertices
+///////////////////////////////////////////////////////////////////////////////
+static ReferenceMesh buildReferenceCylinderFlat(const Cylinder& cylinder)
+{
+    const float PI = acos(-1);
+    int sectorCount = cylinder.sectorCount;
+    int stackCount = cylinder.stackCount;
+    float height = cylinder.height;
+    float sectorStep = 2 * PI / sectorCount;
+    std::vector<float> unitCircle;
+    for (int i = 0; i <= sectorCount; ++i)
+    {
+        float sectorAngle = i * sectorStep;
+        unitCircle.push_back((float)cos(sectorAngle));  // x
+        unitCircle.push_back((float)sin(sectorAngle));  // y
+        unitCircle.push_back(0);                        // z
+    }
+    std::vector<ReferenceVertex> tmpVertices;
+    for (int i = 0; i <= stackCount; ++i)
+    {
+        float z = -(height * 0.5f) + (float)i / stackCount * height;
+        float radius = cylinder.baseRadius + (float)i / stackCount * (cylinder.topRadius - cylinder.baseRadius);
+        float t = 1.0f - (float)i / stackCount;
+        for (int j = 0, k = 0; j <= sectorCount; ++j, k += 3)
+        {
+            ReferenceVertex vertex = { unitCircle[k] * radius, unitCircle[k + 1] * radius, z,
+                (float)j / sectorCount, t };
+            tmpVertices.push_back(vertex);
+        }
+    }
+
+    ReferenceMesh mesh;
+    float n[3];
+    unsigned int index = 0;
+
+    // v2-v4 <== stack at i+1
+    // | \ |
+    // v1-v3 <== stack at i
+    for (int i = 0; i < stackCount; ++i)
+    {
+        int vi1 = i * (sectorCount + 1);
+        int vi2 = (i + 1) * (sectorCount + 1);
+        for (int j = 0; j < sectorCount; ++j, ++vi1, ++vi2)
+        {
+            const ReferenceVertex& v1 = tmpVertices[vi1];
+            const ReferenceVertex& v2 = tmpVertices[vi2];
+            const ReferenceVertex& v3 = tmpVertices[vi1 + 1];
+            const ReferenceVertex& v4 = tmpVertices[vi2 + 1];
+            computeFaceNormal(v1.x, v1.y, v1.z, v3.x, v3.y, v3.z, v2.x, v2.y, v2.z, n);
+            addVertex(mesh, v1, n);
+            addVertex(mesh, v2, n);
+            addVertex(mesh, v3, n);
+            addVertex(mesh, v4, n);
+            addIndices(mesh, index, index + 2, index + 1);
+            addIndices(mesh, index + 1, index + 2, index + 3);
+            index += 4;
+        }
+    }
+
+    // base, then top
+    for (int cap = 0; cap < 2; ++cap)
+    {
+        float z = cap == 0 ? -height * 0.5f : height * 0.5f;
+        float radius = cap == 0 ? cylinder.baseRadius : cylinder.topRadius;
+        float capNormal[3] = { 0, 0, cap == 0 ? -1.0f : 1.0f };
+        unsigned int centerIndex = (unsigned int)mesh.vertices.size() / 3;
+
+        ReferenceVertex center = { 0, 0, z, 0.5f, 0.5f };
+        addVertex(mesh, center, capNormal);
+        for (int i = 0, j = 0; i < sectorCount; ++i, j += 3)
+        {
+            float x = unitCircle[j];
+            float y = unitCircle[j + 1];
+            ReferenceVertex rim = { x * radius, y * radius, z,
+                (cap == 0 ? -x : x) * 0.5f + 0.5f, -y * 0.5f + 0.5f };     // base flipped horizontally
+            addVertex(mesh, rim, capNormal);
+        }
+
+        for (int i = 0, k = centerIndex + 1; i < sectorCount; ++i, ++k)
+        {
+            unsigned int next = i < sectorCount - 1 ? k + 1 : centerIndex + 1;
+            if (cap == 0)
+                addIndices(mesh, centerIndex, next, k);
+            else
+                addIndices(mesh, centerIndex, k, next);
+        }
+    }
+    return mesh;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// small, odd and large counts, including the fewest stacks each shape allows
+///////////////////////////////////////////////////////////////////////////////
+bool checkFlatBuild()
+{
+    const int SPHERE_COUNTS[][2] = { { 3, 2 }, { 4, 3 }, { 36, 18 }, { 37, 19 }, { 100, 50 } };
+    for (int i = 0; i < 5; ++i)
+    {
+        Sphere sphere(0.66f, SPHERE_COUNTS[i][0], SPHERE_COUNTS[i][1], false);
+        if (!closeMesh(sphere, buildReferenceSphereFlat(sphere)))
+            return false;
+    }
+
+    const int CYLINDER_COUNTS[][2] = { { 3, 1 }, { 8, 2 }, { 25, 8 }, { 36, 1 }, { 101, 33 } };
+    for (int i = 0; i < 5; ++i)
+    {
+        Cylinder cylinder(1.0f, 1.5f, 2.0f, CYLINDER_COUNTS[i][0], CYLINDER_COUNTS[i][1], false);
+        if (!closeMesh(cylinder, buildReferenceCylinderFlat(cylinder)))
+            return false;
+    }
+    return true;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// sin/cos of the angles with the given path, which must be supported
+///////////////////////////////////////////////////////////////////////////////
+static void computeSinCosWith(SinCosPath path, const std::vector<float>& angles,
+    std::vector<float>& sines, std::vector<float>& cosines)
+{
+    setSinCosPath(path);
+    sines.resize(angles.size());
+    cosines.resize(angles.size());
+    computeSinCos(angles.data(), sines.data(), cosines.data(), (int)angles.size());
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// the counts leave every remainder after the 4 and 8 wide blocks; the angles
+// are sector rings and a spread over the whole accurate range
+///////////////////////////////////////////////////////////////////////////////
+bool checkSinCosPaths()
+{
+    const float PI = acos(-1);
+    const int COUNTS[] = { 1, 3, 7, 8, 9, 13, 36, 101, 4099 };
+    SinCosPath activePath = getSinCosPath();
+    bool passed = true;
+
+    for (int path = SINCOS_PATH_SCALAR; path <= SINCOS_PATH_AVX2; ++path)
+    {
+        setSinCosPath((SinCosPath)path);
+        if (getSinCosPath() == (SinCosPath)path && !checkSinCosPath((SinCosPath)path))
+            passed = false;
+    }
+
+    for (int count : COUNTS)
+    {
+        for (int set = 0; set < 2; ++set)
+        {
+            std::vector<float> angles(count);
+            for (int i = 0; i < count; ++i)
+                angles[i] = set == 0 ? i * (2 * PI / count) : -8000.0f + i * (16000.0f / count);
+
+            std::vector<float> scalarSines, scalarCosines, sines, cosines;
+            computeSinCosWith(SINCOS_PATH_SCALAR, angles, scalarSines, scalarCosines);
+            for (int path = SINCOS_PATH_SSE2; path <= SINCOS_PATH_AVX2; ++path)
+            {
+                computeSinCosWith((SinCosPath)path, angles, sines, cosines);
+                if (getSinCosPath() != (SinCosPath)path)
+                    continue;       // not supported by this CPU
+                if (!sameArray(sines, scalarSines) || !sameArray(cosines, scalarCosines))
+                    passed = false;
+            }
+        }
+    }
+
+    setSinCosPath(activePath);
+    return passed;
+}
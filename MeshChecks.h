@@ -0,0 +1,29 @@
+#pragma once
+// Self-checks of the shape builders and their sin/cos kernels
+// each one builds a few tessellations both ways and compares the arrays; run
+// them after changing a builder with the MeshChecks project, which exits with
+// 1 if one fails
+
+#ifndef GEOMETRY_MESH_CHECKS_H
+#define GEOMETRY_MESH_CHECKS_H
+
+class ThreadPool;
+
+// smooth spheres and cylinders big enough to split across the pool, built
+// serially and with the pool: interleaved vertices, triangle and strip
+// indices must be identical
+bool checkParallelBuild(ThreadPool& pool);
+
+// flat shaded UV spheres and cylinders of a few sector/stack counts against
+// the flat builders they replaced (cosf()/sinf() per vertex, staged vertices,
+// arrays grown with push_back): triangle indices must be identical, vertices,
+// normals and tex coords within a small tolerance, as the builders now take
+// their sines and cosines from SinCos.h
+bool checkFlatBuild();
+
+// every sin/cos path this CPU supports within SINCOS_MAX_ERROR of sinf/cosf
+// (checkSinCosPath()), and the SSE2 and AVX2 results identical to the scalar
+// ones bit for bit
+bool checkSinCosPaths();
+
+#endif
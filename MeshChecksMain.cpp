@@ -0,0 +1,36 @@
+// Runs the shape builder checks, see MeshChecks.h
+// exit code 0 if all of them pass, 1 otherwise
+
+#include <cstdlib>
+#include <iostream>
+#include "MeshChecks.h"
+#include "ThreadPool.h"
+
+
+
+int main()
+{
+    bool passed = true;
+
+    if (!checkSinCosPaths())
+    {
+        std::cerr << "ERROR: sin/cos paths are inaccurate or differ from each other" << std::endl;
+        passed = false;
+    }
+
+    ThreadPool pool;
+    if (!checkParallelBuild(pool))
+    {
+        std::cerr << "ERROR: parallel mesh builds differ from serial ones" << std::endl;
+        passed = false;
+    }
+    if (!checkFlatBuild())
+    {
+        std::cerr << "ERROR: flat shaded meshes differ from the reference builds" << std::endl;
+        passed = false;
+    }
+
+    if (passed)
+        std::cout << "INFO: all mesh checks passed" << std::endl;
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
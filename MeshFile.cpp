@@ -0,0 +1,230 @@
+// Binary mesh cache file, ready to upload
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstdio>
+#include <fstream>
+#include <GL/glew.h>
+#include "MeshFile.h"
+
+
+
+// constants //////////////////////////////////////////////////////////////////
+const unsigned int BLOB_ALIGNMENT = 16;
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// byte counts of the blobs described by a header
+///////////////////////////////////////////////////////////////////////////////
+static std::size_t getVertexDataSize(const MeshFileHeader& header)
+{
+    return (std::size_t)header.vertexCount * getVertexFormatStride((VertexFormat)header.vertexFormat);
+}
+
+static std::size_t getIndexDataSize(const MeshFileHeader& header)
+{
+    return (std::size_t)header.indexCount * (header.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint));
+}
+
+static std::size_t getMeshletDataSize(const MeshFileHeader& header)
+{
+    return (std::size_t)header.meshletCount * sizeof(Meshlet);
+}
+
+static unsigned int alignOffset(std::size_t offset)
+{
+    return (unsigned int)((offset + BLOB_ALIGNMENT - 1) / BLOB_ALIGNMENT * BLOB_ALIGNMENT);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// FNV-1a, 64 bits
+///////////////////////////////////////////////////////////////////////////////
+unsigned long long hashMeshParams(const void* data, std::size_t size, unsigned long long hash)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// header, vertex blob, index blob and meshlets, each blob aligned to 16 bytes
+///////////////////////////////////////////////////////////////////////////////
+bool writeMeshFile(const std::string& path, MeshFileHeader header,
+    const void* vertexData, const void* indices, const Meshlet* meshlets)
+{
+    if (!meshlets)
+        header.meshletCount = 0;
+    std::size_t vertexSize = getVertexDataSize(header);
+    std::size_t indexSize = getIndexDataSize(header);
+    std::size_t meshletSize = getMeshletDataSize(header);
+    header.magic = MESH_FILE_MAGIC;
+    header.version = MESH_FILE_VERSION;
+    header.vertexOffset = alignOffset(sizeof(MeshFileHeader));
+    header.indexOffset = alignOffset(header.vertexOffset + vertexSize);
+    header.meshletOffset = alignOffset(header.indexOffset + indexSize);
+
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath.c_str(), std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+
+        const char zeros[BLOB_ALIGNMENT] = {};
+        out.write((const char*)&header, sizeof(header));
+        out.write(zeros, header.vertexOffset - sizeof(header));
+        out.write((const char*)vertexData, vertexSize);
+        out.write(zeros, header.indexOffset - (header.vertexOffset + vertexSize));
+        out.write((const char*)indices, indexSize);
+        out.write(zeros, header.meshletOffset - (header.indexOffset + indexSize));
+        out.write((const char*)meshlets, meshletSize);
+        if (!out)
+        {
+            out.close();
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+
+    // replace the file in one step, so readers see the old file or the new
+    // one, never none; std::rename() does not replace an existing file on
+    // Windows, and fails there while the old file is mapped (it stays valid)
+#ifdef _WIN32
+    bool replaced = MoveFileExA(tmpPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    bool replaced = std::rename(tmpPath.c_str(), path.c_str()) == 0;
+#endif
+    if (!replaced)
+    {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor/dtor
+///////////////////////////////////////////////////////////////////////////////
+MeshFile::MeshFile() : data(0), size(0)
+#ifdef _WIN32
+    , file(INVALID_HANDLE_VALUE), mapping(0)
+#endif
+{
+}
+
+MeshFile::~MeshFile()
+{
+    close();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// map the whole file read-only, then validate the header against its size
+///////////////////////////////////////////////////////////////////////////////
+bool MeshFile::open(const std::string& path, unsigned long long paramHash)
+{
+    close();
+
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, 0);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(MeshFileHeader))
+    {
+        close();
+        return false;
+    }
+    size = (std::size_t)fileSize.QuadPart;
+
+    mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+    if (mapping)
+        data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size < (off_t)sizeof(MeshFileHeader))
+    {
+        ::close(fd);
+        return false;
+    }
+    size = (std::size_t)status.st_size;
+
+    // the mapping stays valid after the descriptor is closed
+    void* mapped = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped != MAP_FAILED)
+        data = (const unsigned char*)mapped;
+#endif
+    if (!data)
+    {
+        close();
+        return false;
+    }
+
+    const MeshFileHeader& header = getHeader();
+    bool valid = header.magic == MESH_FILE_MAGIC
+        && header.version == MESH_FILE_VERSION
+        && header.paramHash == paramHash
+        && (header.vertexFormat == VERTEX_FORMAT_FLOAT || header.vertexFormat == VERTEX_FORMAT_PACKED)
+        && (header.indexType == GL_UNSIGNED_SHORT || header.indexType == GL_UNSIGNED_INT)
+        && header.vertexOffset >= sizeof(MeshFileHeader)
+        && header.vertexOffset + getVertexDataSize(header) <= size
+        && header.indexOffset >= header.vertexOffset + getVertexDataSize(header)
+        && header.indexOffset + getIndexDataSize(header) <= size
+        && header.meshletOffset >= header.indexOffset + getIndexDataSize(header)
+        && header.meshletOffset + getMeshletDataSize(header) <= size;
+    if (!valid)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// unmap
+///////////////////////////////////////////////////////////////////////////////
+void MeshFile::close()
+{
+#ifdef _WIN32
+    if (data)
+        UnmapViewOfFile(data);
+    if (mapping)
+        CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+    mapping = 0;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (data)
+        munmap((void*)data, size);
+#endif
+    data = 0;
+    size = 0;
+}
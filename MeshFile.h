@@ -0,0 +1,88 @@
+#pragma once
+// Binary mesh cache file, ready to upload
+// layout: MeshFileHeader, then the vertex blob in the upload vertex format,
+// the index blob and the meshlets if any, each at the offset given in the header
+// a file is only used if its magic, version and parameter hash all match, so
+// changing the generators or the build options just makes old files stale
+// files are read through a read-only memory mapping, so uploads copy straight
+// from the page cache without building anything
+
+#ifndef GEOMETRY_MESH_FILE_H
+#define GEOMETRY_MESH_FILE_H
+
+#include <cstddef>
+#include <string>
+#include "Bounds.h"
+#include "MeshOptimizer.h"
+#include "Meshlet.h"
+#include "VertexFormat.h"
+
+const unsigned int MESH_FILE_MAGIC = 0x4853454D;        // "MESH" in little endian
+const unsigned int MESH_FILE_VERSION = 3;               // bump when generated meshes change
+const unsigned long long MESH_HASH_SEED = 0xCBF29CE484222325ull;     // FNV-1a 64 offset basis
+
+// fixed-size header at the start of the file
+struct MeshFileHeader
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned long long paramHash;           // hash of the generator params and build options
+    unsigned int vertexFormat;              // VertexFormat of the vertex blob
+    unsigned int vertexCount;
+    unsigned int vertexOffset;              // # of bytes from the start of the file
+    unsigned int primitiveType;             // GL_TRIANGLES or GL_TRIANGLE_STRIP
+    unsigned int indexType;                 // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    unsigned int indexCount;
+    unsigned int indexOffset;
+    unsigned int optimized;                 // 1 if reordered by MeshOptimizer
+    MeshOptimizationReport optimizationReport;
+    float boundingRadius;
+    BoundingBox boundingBox;
+    BoundingSphere boundingSphere;
+    unsigned int meshletCount;              // 0 = not split into meshlets
+    unsigned int meshletOffset;
+};
+
+// FNV-1a over raw bytes; chain calls by passing the previous hash
+unsigned long long hashMeshParams(const void* data, std::size_t size, unsigned long long hash = MESH_HASH_SEED);
+
+// write header and blobs to a temporary file, then rename it into place so a
+// crash never leaves a half-written file behind; offsets are filled in here
+bool writeMeshFile(const std::string& path, MeshFileHeader header,
+    const void* vertexData, const void* indices, const Meshlet* meshlets = 0);
+
+
+
+// read-only memory mapping of a mesh file
+class MeshFile
+{
+public:
+    // ctor/dtor
+    MeshFile();
+    ~MeshFile();
+
+    // map the file and check it; false if it is missing, truncated or stale
+    bool open(const std::string& path, unsigned long long paramHash);
+    void close();
+
+    bool isOpen() const { return data != 0; }
+    const MeshFileHeader& getHeader() const { return *(const MeshFileHeader*)data; }
+    VertexFormat getVertexFormat() const { return (VertexFormat)getHeader().vertexFormat; }
+    const void* getVertexData() const { return data + getHeader().vertexOffset; }
+    const void* getIndices() const { return data + getHeader().indexOffset; }
+    const Meshlet* getMeshlets() const { return (const Meshlet*)(data + getHeader().meshletOffset); }
+
+private:
+    // mappings are not shared between objects
+    MeshFile(const MeshFile&) = delete;
+    MeshFile& operator=(const MeshFile&) = delete;
+
+    const unsigned char* data;
+    std::size_t size;
+#ifdef _WIN32
+    void* file;                             // HANDLEs, kept as void* to keep windows.h out of the header
+    void* mapping;
+#endif
+};
+
+#endif
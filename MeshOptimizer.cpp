@@ -0,0 +1,386 @@
+// Index/vertex reordering for indexed triangle lists
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+#include "MeshOptimizer.h"
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// FIFO cache simulation
+///////////////////////////////////////////////////////////////////////////////
+VertexCacheStats analyzeVertexCache(const unsigned int* indices, std::size_t indexCount,
+    std::size_t vertexCount, unsigned int cacheSize)
+{
+    VertexCacheStats stats = { 0.0f, 0.0f };
+    if (indexCount < 3)
+        return stats;
+
+    // a vertex is in the cache if it was transformed less than cacheSize misses ago
+    std::vector<std::size_t> cachedAt(vertexCount, 0);
+    std::vector<bool> referenced(vertexCount, false);
+    std::size_t misses = 0;
+    std::size_t referencedCount = 0;
+    for (std::size_t i = 0; i < indexCount; ++i)
+    {
+        unsigned int v = indices[i];
+        if (cachedAt[v] == 0 || misses - cachedAt[v] >= cacheSize)
+        {
+            ++misses;
+            cachedAt[v] = misses;
+        }
+        if (!referenced[v])
+        {
+            referenced[v] = true;
+            ++referencedCount;
+        }
+    }
+
+    stats.acmr = (float)misses / (indexCount / 3);
+    stats.atvr = (float)misses / referencedCount;
+    return stats;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Tipsify: fan around a vertex, then continue from the best vertex still in the
+// cache; a vertex is good if its remaining triangles still fit in the cache
+///////////////////////////////////////////////////////////////////////////////
+std::vector<std::size_t> optimizeVertexCache(unsigned int* indices, std::size_t indexCount,
+    std::size_t vertexCount, unsigned int cacheSize)
+{
+    std::vector<std::size_t> clusters;
+    std::size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0 || vertexCount == 0)
+        return clusters;
+
+    // vertex-triangle adjacency
+    std::vector<unsigned int> liveCounts(vertexCount, 0);
+    for (std::size_t i = 0; i < indexCount; ++i)
+        ++liveCounts[indices[i]];
+
+    std::vector<std::size_t> offsets(vertexCount + 1, 0);
+    for (std::size_t v = 0; v < vertexCount; ++v)
+        offsets[v + 1] = offsets[v] + liveCounts[v];
+
+    std::vector<unsigned int> adjacency(indexCount);
+    std::vector<std::size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (std::size_t i = 0; i < indexCount; ++i)
+        adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+    std::vector<std::size_t> cacheTimes(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnds;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> output;
+    output.reserve(indexCount);
+
+    std::size_t time = cacheSize + 1;
+    std::size_t cursor = 0;                         // next vertex to try after dead ends run out
+    long long fanning = indices[0];
+    bool newCluster = true;
+
+    while (fanning >= 0)
+    {
+        // emit all triangles around the fanning vertex
+        candidates.clear();
+        for (std::size_t a = offsets[fanning]; a < offsets[fanning + 1]; ++a)
+        {
+            unsigned int t = adjacency[a];
+            if (emitted[t])
+                continue;
+
+            if (newCluster)
+            {
+                clusters.push_back(output.size() / 3);
+                newCluster = false;
+            }
+
+            for (int k = 0; k < 3; ++k)
+            {
+                unsigned int v = indices[t * 3 + k];
+                output.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                --liveCounts[v];
+                if (time - cacheTimes[v] > cacheSize)
+                    cacheTimes[v] = time++;
+            }
+            emitted[t] = true;
+        }
+
+        // pick the candidate that stays longest in the cache with its remaining fan
+        fanning = -1;
+        std::size_t best = 0;
+        for (std::size_t c = 0; c < candidates.size(); ++c)
+        {
+            unsigned int v = candidates[c];
+            if (liveCounts[v] == 0)
+                continue;
+
+            std::size_t priority = 0;
+            if (time - cacheTimes[v] + 2 * liveCounts[v] <= cacheSize)
+                priority = time - cacheTimes[v];
+            if (fanning < 0 || priority > best)
+            {
+                best = priority;
+                fanning = v;
+            }
+        }
+
+        // dead end: recently used vertices first, then scan forward
+        if (fanning < 0)
+        {
+            while (!deadEnds.empty() && fanning < 0)
+            {
+                unsigned int v = deadEnds.back();
+                deadEnds.pop_back();
+                if (liveCounts[v] > 0)
+                    fanning = v;
+            }
+            while (fanning < 0 && cursor < vertexCount)
+            {
+                if (liveCounts[cursor] > 0)
+                    fanning = (long long)cursor;
+                ++cursor;
+            }
+
+            // a jump to a vertex out of the cache starts a new cluster
+            if (fanning >= 0 && time - cacheTimes[fanning] > cacheSize)
+                newCluster = true;
+        }
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+    return clusters;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// sort clusters by how far they face away from the mesh centre
+// clusters on the outside of a convex-ish mesh tend to occlude the others
+///////////////////////////////////////////////////////////////////////////////
+void optimizeOverdraw(unsigned int* indices, std::size_t indexCount, const float* positions,
+    int positionStride, std::size_t vertexCount, const std::vector<std::size_t>& clusters,
+    float threshold, unsigned int cacheSize)
+{
+    std::size_t triangleCount = indexCount / 3;
+    std::size_t clusterCount = clusters.size();
+    if (clusterCount < 2)
+        return;
+
+    // area-weighted centroids and normals of every cluster and of the whole mesh
+    std::vector<float> centroids(clusterCount * 3, 0.0f);
+    std::vector<float> normals(clusterCount * 3, 0.0f);
+    std::vector<float> areas(clusterCount, 0.0f);
+    float meshCentroid[3] = { 0, 0, 0 };
+    float meshArea = 0;
+
+    for (std::size_t c = 0; c < clusterCount; ++c)
+    {
+        std::size_t last = c + 1 < clusterCount ? clusters[c + 1] : triangleCount;
+        for (std::size_t t = clusters[c]; t < last; ++t)
+        {
+            const float* p1 = &positions[indices[t * 3] * positionStride];
+            const float* p2 = &positions[indices[t * 3 + 1] * positionStride];
+            const float* p3 = &positions[indices[t * 3 + 2] * positionStride];
+
+            float ex1 = p2[0] - p1[0], ey1 = p2[1] - p1[1], ez1 = p2[2] - p1[2];
+            float ex2 = p3[0] - p1[0], ey2 = p3[1] - p1[1], ez2 = p3[2] - p1[2];
+            float nx = ey1 * ez2 - ez1 * ey2;
+            float ny = ez1 * ex2 - ex1 * ez2;
+            float nz = ex1 * ey2 - ey1 * ex2;
+            float area = std::sqrt(nx * nx + ny * ny + nz * nz);
+
+            for (int k = 0; k < 3; ++k)
+            {
+                float centre = (p1[k] + p2[k] + p3[k]) / 3.0f;
+                centroids[c * 3 + k] += centre * area;
+                meshCentroid[k] += centre * area;
+            }
+            normals[c * 3] += nx;
+            normals[c * 3 + 1] += ny;
+            normals[c * 3 + 2] += nz;
+            areas[c] += area;
+            meshArea += area;
+        }
+    }
+    if (meshArea <= 0)
+        return;
+
+    for (int k = 0; k < 3; ++k)
+        meshCentroid[k] /= meshArea;
+
+    std::vector<float> sortKeys(clusterCount, 0.0f);
+    for (std::size_t c = 0; c < clusterCount; ++c)
+    {
+        if (areas[c] <= 0)
+            continue;
+
+        float* n = &normals[c * 3];
+        float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length <= 0)
+            continue;
+
+        float dot = 0;
+        for (int k = 0; k < 3; ++k)
+            dot += (centroids[c * 3 + k] / areas[c] - meshCentroid[k]) * n[k];
+        sortKeys[c] = dot / length;
+    }
+
+    std::vector<std::size_t> order(clusterCount);
+    for (std::size_t c = 0; c < clusterCount; ++c)
+        order[c] = c;
+    std::stable_sort(order.begin(), order.end(),
+        [&sortKeys](std::size_t a, std::size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<unsigned int> sorted;
+    sorted.reserve(indexCount);
+    for (std::size_t i = 0; i < clusterCount; ++i)
+    {
+        std::size_t c = order[i];
+        std::size_t last = c + 1 < clusterCount ? clusters[c + 1] : triangleCount;
+        sorted.insert(sorted.end(), indices + clusters[c] * 3, indices + last * 3);
+    }
+
+    // cluster seams may cost extra misses; keep the cache order if they cost too much
+    float acmr = analyzeVertexCache(indices, indexCount, vertexCount, cacheSize).acmr;
+    float sortedAcmr = analyzeVertexCache(sorted.data(), indexCount, vertexCount, cacheSize).acmr;
+    if (sortedAcmr <= acmr * threshold)
+        std::copy(sorted.begin(), sorted.end(), indices);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// vertex cache order, then overdraw order of its clusters
+///////////////////////////////////////////////////////////////////////////////
+void optimizeTriangleOrder(unsigned int* indices, std::size_t indexCount, const float* positions,
+    int positionStride, std::size_t vertexCount)
+{
+    std::vector<std::size_t> clusters = optimizeVertexCache(indices, indexCount, vertexCount);
+    optimizeOverdraw(indices, indexCount, positions, positionStride, vertexCount, clusters);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// first-use vertex order
+///////////////////////////////////////////////////////////////////////////////
+std::vector<unsigned int> optimizeVertexFetch(unsigned int* indices, std::size_t indexCount,
+    std::size_t vertexCount)
+{
+    const unsigned int UNUSED = ~0u;
+    std::vector<unsigned int> remap(vertexCount, UNUSED);
+
+    unsigned int next = 0;
+    for (std::size_t i = 0; i < indexCount; ++i)
+    {
+        unsigned int& target = remap[indices[i]];
+        if (target == UNUSED)
+            target = next++;
+        indices[i] = target;
+    }
+
+    // keep unreferenced vertices so the vertex count does not change
+    for (std::size_t v = 0; v < vertexCount; ++v)
+    {
+        if (remap[v] == UNUSED)
+            remap[v] = next++;
+    }
+    return remap;
+}
+
+void remapIndices(unsigned int* indices, std::size_t indexCount, const std::vector<unsigned int>& remap)
+{
+    for (std::size_t i = 0; i < indexCount; ++i)
+        indices[i] = remap[indices[i]];
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// snap positions to a grid of 1e-5 of the mesh extent and map every vertex to
+// the first vertex of its cell
+///////////////////////////////////////////////////////////////////////////////
+std::vector<unsigned int> weldPositions(const float* positions, int positionStride, std::size_t vertexCount)
+{
+    float extent = 0;
+    for (std::size_t v = 0; v < vertexCount; ++v)
+    {
+        for (int j = 0; j < 3; ++j)
+            extent = std::max(extent, std::fabs(positions[v * positionStride + j]));
+    }
+    float cellSize = extent > 0 ? extent * 1e-5f : 1.0f;
+
+    std::vector<long long> cells(vertexCount * 3);
+    std::vector<unsigned int> order(vertexCount);
+    for (std::size_t v = 0; v < vertexCount; ++v)
+    {
+        for (int j = 0; j < 3; ++j)
+            cells[v * 3 + j] = std::llround(positions[v * positionStride + j] / cellSize);
+        order[v] = (unsigned int)v;
+    }
+    std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b)
+    {
+        return std::lexicographical_compare(&cells[a * 3], &cells[a * 3 + 3], &cells[b * 3], &cells[b * 3 + 3]);
+    });
+
+    std::vector<unsigned int> welded(vertexCount);
+    for (std::size_t i = 0; i < vertexCount; ++i)
+    {
+        if (i > 0 && std::equal(&cells[order[i] * 3], &cells[order[i] * 3 + 3], &cells[order[i - 1] * 3]))
+            welded[order[i]] = welded[order[i - 1]];
+        else
+            welded[order[i]] = order[i];
+    }
+    return welded;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// weld vertices on a grid of 1e-5 of the mesh extent (generated seam and pole
+// copies differ by rounding only), then keep the first copy of every welded edge
+///////////////////////////////////////////////////////////////////////////////
+std::vector<unsigned int> buildEdgeIndices(const unsigned int* indices, std::size_t indexCount,
+    const float* positions, int positionStride, std::size_t vertexCount,
+    const float* texCoords, int texCoordStride)
+{
+    std::vector<unsigned int> welded = weldPositions(positions, positionStride, vertexCount);
+
+    std::vector<unsigned int> lines;
+    std::unordered_set<unsigned long long> edges;
+    edges.reserve(indexCount);
+    for (std::size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            unsigned int v1 = indices[i + k];
+            unsigned int v2 = indices[i + (k + 1) % 3];
+            unsigned int w1 = welded[v1];
+            unsigned int w2 = welded[v2];
+            if (w1 == w2)
+                continue;               // degenerate edge, e.g. at a pole
+
+            if (texCoords)
+            {
+                const float* t1 = &texCoords[v1 * texCoordStride];
+                const float* t2 = &texCoords[v2 * texCoordStride];
+                if (t1[0] != t2[0] && t1[1] != t2[1])
+                    continue;
+            }
+
+            unsigned long long key = w1 < w2 ? ((unsigned long long)w1 << 32 | w2) : ((unsigned long long)w2 << 32 | w1);
+            if (edges.insert(key).second)
+            {
+                lines.push_back(v1);
+                lines.push_back(v2);
+            }
+        }
+    }
+    return lines;
+}
@@ -0,0 +1,87 @@
+#pragma once
+// Index/vertex reordering for indexed triangle lists
+// 1. triangle order for the post-transform vertex cache (Tipsify,
+//    Sander, Nehab and Barczak 2007), which also yields clusters
+// 2. cluster order for less overdraw: outward-facing clusters first, kept only
+//    if it costs little vertex cache efficiency
+// 3. vertex order for fetch locality: vertices renumbered in first-use order
+// plus wireframe line indices derived from the triangles
+// all functions work on any mesh given as 32-bit triangle indices
+
+#ifndef GEOMETRY_MESH_OPTIMIZER_H
+#define GEOMETRY_MESH_OPTIMIZER_H
+
+#include <cstddef>
+#include <vector>
+
+const unsigned int MESH_OPTIMIZER_CACHE_SIZE = 16;  // FIFO entries assumed for the GPU
+
+// vertex cache efficiency of an index buffer, simulated with a FIFO cache
+struct VertexCacheStats
+{
+    float acmr;     // average cache miss ratio: transformed vertices per triangle (0.5 is ideal for big grids, 3 is worst)
+    float atvr;     // average transform to vertex ratio: transformed vertices per referenced vertex (1 is ideal)
+};
+
+// statistics before/after MeshOptimizer passes
+struct MeshOptimizationReport
+{
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+VertexCacheStats analyzeVertexCache(const unsigned int* indices, std::size_t indexCount,
+    std::size_t vertexCount, unsigned int cacheSize = MESH_OPTIMIZER_CACHE_SIZE);
+
+// reorder triangles in place for the vertex cache (Tipsify)
+// returns the first triangle of every cluster, starting with 0
+std::vector<std::size_t> optimizeVertexCache(unsigned int* indices, std::size_t indexCount,
+    std::size_t vertexCount, unsigned int cacheSize = MESH_OPTIMIZER_CACHE_SIZE);
+
+// reorder the clusters from optimizeVertexCache() to draw outward-facing ones
+// first; rejected if ACMR grows by more than the threshold factor
+// positions: 3 floats per vertex with the given stride in floats
+void optimizeOverdraw(unsigned int* indices, std::size_t indexCount, const float* positions,
+    int positionStride, std::size_t vertexCount, const std::vector<std::size_t>& clusters,
+    float threshold = 1.05f, unsigned int cacheSize = MESH_OPTIMIZER_CACHE_SIZE);
+
+// both of the above
+void optimizeTriangleOrder(unsigned int* indices, std::size_t indexCount, const float* positions,
+    int positionStride, std::size_t vertexCount);
+
+// renumber vertices in the order the indices first use them, and rewrite the indices
+// returns remap[oldIndex] = newIndex; unused vertices go to the end in their old order
+std::vector<unsigned int> optimizeVertexFetch(unsigned int* indices, std::size_t indexCount,
+    std::size_t vertexCount);
+
+// apply a remap from optimizeVertexFetch() to another index array, e.g. line indices
+void remapIndices(unsigned int* indices, std::size_t indexCount, const std::vector<unsigned int>& remap);
+
+// welded[v] = the first vertex at the same position as v (within rounding), so
+// seam, pole and flat shading copies of a point can be treated as one
+// positions: 3 floats per vertex with the given stride in floats
+std::vector<unsigned int> weldPositions(const float* positions, int positionStride, std::size_t vertexCount);
+
+// unique triangle edges as GL_LINES indices, in triangle order
+// vertices at the same position (within rounding) count as one, so seams and flat shading
+// don't double the lines; with texCoords, edges whose ends differ in both s
+// and t (quad diagonals of a grid) are skipped
+// positions: 3 floats, texCoords: 2 floats per vertex, strides in floats
+std::vector<unsigned int> buildEdgeIndices(const unsigned int* indices, std::size_t indexCount,
+    const float* positions, int positionStride, std::size_t vertexCount,
+    const float* texCoords = 0, int texCoordStride = 2);
+
+// move per-vertex data (components values per vertex) to the remapped positions
+template<class T>
+void remapVertexAttribute(std::vector<T>& data, int components, const std::vector<unsigned int>& remap)
+{
+    std::vector<T> remapped(data.size());
+    for (std::size_t i = 0; i < remap.size(); ++i)
+    {
+        for (int j = 0; j < components; ++j)
+            remapped[remap[i] * components + j] = data[i * components + j];
+    }
+    data.swap(remapped);
+}
+
+#endif
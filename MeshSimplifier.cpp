@@ -0,0 +1,547 @@
+// Quadric error mesh simplification
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+
+
+// constants //////////////////////////////////////////////////////////////////
+namespace
+{
+    const unsigned int NO_HALF_EDGE = 0xFFFFFFFF;
+    const double BORDER_PLANE_WEIGHT = 10.0;    // of the planes holding borders and seams in place
+    const float MIN_NORMAL_COS = 0.5f;          // cos of the most a triangle may turn in one collapse
+
+    enum VertexKind
+    {
+        VERTEX_MANIFOLD = 0,                    // one vertex, surrounded by triangles: moves anywhere
+        VERTEX_BORDER,                          // one vertex on an open border: moves along it
+        VERTEX_SEAM,                            // two vertices along a seam: both move along it
+        VERTEX_LOCKED                           // corners, poles, flat shading, non-manifold: stays
+    };
+
+    // sum of squared distances to planes, the upper half of a symmetric 4x4
+    // matrix, and the sum of the plane weights to average it
+    struct Quadric
+    {
+        double a2, b2, c2, ab, ac, bc, ad, bd, cd, d2;
+        double weight;
+    };
+
+    // half-edge h runs from corner h % 3 of triangle h / 3 to the next corner
+    // between welded positions, so a seam has twins and an open border has none
+    struct HalfEdgeMesh
+    {
+        std::vector<unsigned int> twins;        // half-edge between the same positions the other way
+        std::vector<unsigned int> offsets;      // half-edges leaving position p: outgoing[offsets[p]] to outgoing[offsets[p + 1]]
+        std::vector<unsigned int> outgoing;
+        std::vector<bool> nonManifold;          // per position, one of its edges has more than 2 triangles
+    };
+
+    // edge collapse candidate, between positions
+    struct Collapse
+    {
+        unsigned int from;
+        unsigned int to;
+        double cost;
+    };
+
+    // data kept across the passes
+    struct SimplifierState
+    {
+        const float* vertices;
+        std::vector<unsigned int> welded;       // position of every vertex, from weldPositions()
+        std::vector<unsigned int> indices;      // triangles left
+        std::vector<Quadric> quadrics;          // per position
+        std::vector<unsigned char> kinds;       // VertexKind per position
+        std::vector<unsigned int> remap;        // per vertex, the collapses of the current pass
+        HalfEdgeMesh mesh;
+        std::vector<unsigned int> fromNeighbours;   // scratch for the link test
+        std::vector<unsigned int> toNeighbours;
+    };
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// quadric helpers
+///////////////////////////////////////////////////////////////////////////////
+static void addPlane(Quadric& q, double a, double b, double c, double d, double weight)
+{
+    q.a2 += weight * a * a;
+    q.b2 += weight * b * b;
+    q.c2 += weight * c * c;
+    q.ab += weight * a * b;
+    q.ac += weight * a * c;
+    q.bc += weight * b * c;
+    q.ad += weight * a * d;
+    q.bd += weight * b * d;
+    q.cd += weight * c * d;
+    q.d2 += weight * d * d;
+    q.weight += weight;
+}
+
+static void addQuadric(Quadric& q, const Quadric& other)
+{
+    q.a2 += other.a2;
+    q.b2 += other.b2;
+    q.c2 += other.c2;
+    q.ab += other.ab;
+    q.ac += other.ac;
+    q.bc += other.bc;
+    q.ad += other.ad;
+    q.bd += other.bd;
+    q.cd += other.cd;
+    q.d2 += other.d2;
+    q.weight += other.weight;
+}
+
+// mean squared distance to the planes
+static double evaluateQuadric(const Quadric& q, const float* p)
+{
+    double x = p[0], y = p[1], z = p[2];
+    double error = q.a2 * x * x + q.b2 * y * y + q.c2 * z * z
+        + 2.0 * (q.ab * x * y + q.ac * x * z + q.bc * y * z)
+        + 2.0 * (q.ad * x + q.bd * y + q.cd * z) + q.d2;
+    return q.weight > 0.0 ? std::max(error, 0.0) / q.weight : 0.0;       // max: rounding
+}
+
+static void crossProduct(const float* p1, const float* p2, const float* p3, float n[3])
+{
+    float e1[3] = { p2[0] - p1[0], p2[1] - p1[1], p2[2] - p1[2] };
+    float e2[3] = { p3[0] - p1[0], p3[1] - p1[1], p3[2] - p1[2] };
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+static inline unsigned int nextHalfEdge(unsigned int h)
+{
+    return h % 3 == 2 ? h - 2 : h + 1;
+}
+
+static inline const float* getPosition(const SimplifierState& state, unsigned int vertex)
+{
+    return state.vertices + (std::size_t)vertex * SIMPLIFIER_VERTEX_FLOATS;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// twins are found by hashing (from, to) positions; an edge seen twice in the
+// same direction means more than 2 triangles or a flipped one, so its ends
+// are marked non-manifold
+///////////////////////////////////////////////////////////////////////////////
+static void buildHalfEdgeMesh(SimplifierState& state)
+{
+    const std::vector<unsigned int>& indices = state.indices;
+    const std::vector<unsigned int>& welded = state.welded;
+    HalfEdgeMesh& mesh = state.mesh;
+    std::size_t vertexCount = welded.size();
+    unsigned int halfEdgeCount = (unsigned int)indices.size();
+
+    mesh.twins.assign(halfEdgeCount, NO_HALF_EDGE);
+    mesh.nonManifold.assign(vertexCount, false);
+    mesh.offsets.assign(vertexCount + 1, 0);
+    mesh.outgoing.resize(halfEdgeCount);
+    for (unsigned int h = 0; h < halfEdgeCount; ++h)
+        ++mesh.offsets[welded[indices[h]] + 1];
+    for (std::size_t p = 0; p < vertexCount; ++p)
+        mesh.offsets[p + 1] += mesh.offsets[p];
+    std::vector<unsigned int> fill(mesh.offsets.begin(), mesh.offsets.end() - 1);
+    for (unsigned int h = 0; h < halfEdgeCount; ++h)
+        mesh.outgoing[fill[welded[indices[h]]]++] = h;
+
+    std::unordered_map<unsigned long long, unsigned int> edges;
+    edges.reserve(halfEdgeCount);
+    for (unsigned int h = 0; h < halfEdgeCount; ++h)
+    {
+        unsigned int from = welded[indices[h]], to = welded[indices[nextHalfEdge(h)]];
+        if (!edges.insert(std::make_pair((unsigned long long)from << 32 | to, h)).second)
+            mesh.nonManifold[from] = mesh.nonManifold[to] = true;
+    }
+    for (unsigned int h = 0; h < halfEdgeCount; ++h)
+    {
+        unsigned int from = welded[indices[h]], to = welded[indices[nextHalfEdge(h)]];
+        std::unordered_map<unsigned long long, unsigned int>::const_iterator twin
+            = edges.find((unsigned long long)to << 32 | from);
+        if (twin != edges.end())
+            mesh.twins[h] = twin->second;
+    }
+}
+
+
+
+// the triangles on both sides use different vertices at one end or both
+static bool isSeamEdge(const SimplifierState& state, unsigned int h)
+{
+    unsigned int twin = state.mesh.twins[h];
+    return twin != NO_HALF_EDGE && (state.indices[twin] != state.indices[nextHalfEdge(h)]
+        || state.indices[nextHalfEdge(twin)] != state.indices[h]);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// count the open edges (border or seam) leaving and entering every vertex: a
+// vertex in the middle of one border or one seam has exactly one of each
+///////////////////////////////////////////////////////////////////////////////
+static void classifyVertices(SimplifierState& state)
+{
+    std::size_t vertexCount = state.welded.size();
+    std::vector<unsigned int> openOut(vertexCount, 0), openIn(vertexCount, 0);      // per vertex
+    std::vector<unsigned int> borderOut(vertexCount, 0), borderIn(vertexCount, 0);  // per position
+    for (unsigned int h = 0; h < (unsigned int)state.indices.size(); ++h)
+    {
+        unsigned int a = state.indices[h], b = state.indices[nextHalfEdge(h)];
+        if (state.mesh.twins[h] == NO_HALF_EDGE)
+        {
+            ++borderOut[state.welded[a]];
+            ++borderIn[state.welded[b]];
+        }
+        else if (!isSeamEdge(state, h))
+        {
+            continue;
+        }
+        ++openOut[a];
+        ++openIn[b];
+    }
+
+    // vertices per position, and whether each sits on exactly one open path
+    std::vector<unsigned int> vertexCounts(vertexCount, 0);
+    std::vector<bool> onePath(vertexCount, true), noPath(vertexCount, true);
+    std::vector<bool> used(vertexCount, false);
+    for (std::size_t i = 0; i < state.indices.size(); ++i)
+    {
+        unsigned int v = state.indices[i];
+        if (used[v])
+            continue;
+        used[v] = true;
+        unsigned int p = state.welded[v];
+        ++vertexCounts[p];
+        onePath[p] = onePath[p] && openOut[v] == 1 && openIn[v] == 1;
+        noPath[p] = noPath[p] && openOut[v] == 0 && openIn[v] == 0;
+    }
+
+    state.kinds.assign(vertexCount, VERTEX_LOCKED);
+    for (std::size_t p = 0; p < vertexCount; ++p)
+    {
+        if (vertexCounts[p] == 0 || state.mesh.nonManifold[p])
+            continue;
+        bool border = borderOut[p] > 0 || borderIn[p] > 0;
+        if (vertexCounts[p] == 1 && noPath[p])
+            state.kinds[p] = VERTEX_MANIFOLD;
+        else if (vertexCounts[p] == 1 && onePath[p] && border)
+            state.kinds[p] = VERTEX_BORDER;
+        else if (vertexCounts[p] == 2 && onePath[p] && !border)
+            state.kinds[p] = VERTEX_SEAM;
+    }
+}
+
+
+
+// borders and seams only shrink along themselves
+static bool canCollapse(unsigned char fromKind, unsigned char toKind, bool borderEdge, bool seamEdge)
+{
+    switch (fromKind)
+    {
+    case VERTEX_MANIFOLD:
+        return true;
+    case VERTEX_BORDER:
+        return borderEdge && (toKind == VERTEX_BORDER || toKind == VERTEX_LOCKED);
+    case VERTEX_SEAM:
+        return seamEdge && (toKind == VERTEX_SEAM || toKind == VERTEX_LOCKED);
+    default:
+        return false;
+    }
+}
+
+
+
+// other positions of the triangles around a position, as they are now
+static void gatherNeighbours(const SimplifierState& state, unsigned int position, std::vector<unsigned int>& neighbours)
+{
+    neighbours.clear();
+    for (unsigned int j = state.mesh.offsets[position]; j < state.mesh.offsets[position + 1]; ++j)
+    {
+        unsigned int t = state.mesh.outgoing[j] / 3;
+        for (int k = 0; k < 3; ++k)
+        {
+            unsigned int p = state.welded[state.remap[state.indices[t * 3 + k]]];
+            if (p != position)
+                neighbours.push_back(p);
+        }
+    }
+    std::sort(neighbours.begin(), neighbours.end());
+    neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// move every vertex of the from position onto the vertex of the to position
+// it shares a triangle of the edge with, if
+// - each vertex of from gets exactly one target (seams: one per side)
+// - no other triangle around from turns too far or collapses
+// - from and to have no common neighbour besides the edge triangles (link
+//   condition), so the surface stays manifold
+// triangles are read through the remap of this pass, so earlier collapses
+// of the pass are seen; returns the # of edge triangles removed, 0 = rejected
+///////////////////////////////////////////////////////////////////////////////
+static unsigned int collapseEdge(SimplifierState& state, const Collapse& collapse)
+{
+    const float* target = getPosition(state, collapse.to);
+    unsigned int sources[2], targets[2];
+    unsigned int mappingCount = 0;
+    unsigned int edgeTriangles = 0;
+
+    for (unsigned int j = state.mesh.offsets[collapse.from]; j < state.mesh.offsets[collapse.from + 1]; ++j)
+    {
+        unsigned int h = state.mesh.outgoing[j];
+        unsigned int t = h / 3, corner = h % 3;
+        unsigned int v[3], p[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            v[k] = state.remap[state.indices[t * 3 + k]];
+            p[k] = state.welded[v[k]];
+        }
+        if (p[0] == p[1] || p[1] == p[2] || p[2] == p[0])
+            continue;           // removed earlier in this pass
+
+        int toCorner = p[0] == collapse.to ? 0 : p[1] == collapse.to ? 1 : p[2] == collapse.to ? 2 : -1;
+        if (toCorner >= 0)
+        {
+            ++edgeTriangles;
+            unsigned int m = 0;
+            while (m < mappingCount && sources[m] != v[corner])
+                ++m;
+            if (m == mappingCount)
+            {
+                if (mappingCount == 2)
+                    return 0;
+                sources[m] = v[corner];
+                targets[m] = v[toCorner];
+                ++mappingCount;
+            }
+            else if (targets[m] != v[toCorner])
+            {
+                return 0;       // the edge is a seam at the other end only
+            }
+            continue;
+        }
+
+        const float* corners[3] = { getPosition(state, v[0]), getPosition(state, v[1]), getPosition(state, v[2]) };
+        float before[3], after[3];
+        crossProduct(corners[0], corners[1], corners[2], before);
+        corners[corner] = target;
+        crossProduct(corners[0], corners[1], corners[2], after);
+        float lengthBefore = sqrtf(before[0] * before[0] + before[1] * before[1] + before[2] * before[2]);
+        float lengthAfter = sqrtf(after[0] * after[0] + after[1] * after[1] + after[2] * after[2]);
+        if (lengthBefore == 0.0f)
+            continue;
+        if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= MIN_NORMAL_COS * lengthBefore * lengthAfter)
+            return 0;
+    }
+    if (edgeTriangles == 0)
+        return 0;
+
+    // every vertex of from needs a target
+    for (unsigned int j = state.mesh.offsets[collapse.from]; j < state.mesh.offsets[collapse.from + 1]; ++j)
+    {
+        unsigned int v = state.indices[state.mesh.outgoing[j]];
+        if (v != sources[0] && (mappingCount < 2 || v != sources[1]))
+            return 0;
+    }
+
+    gatherNeighbours(state, collapse.from, state.fromNeighbours);
+    gatherNeighbours(state, collapse.to, state.toNeighbours);
+    std::size_t common = 0;
+    for (std::size_t i = 0, j = 0; i < state.fromNeighbours.size() && j < state.toNeighbours.size(); )
+    {
+        if (state.fromNeighbours[i] < state.toNeighbours[j])
+            ++i;
+        else if (state.fromNeighbours[i] > state.toNeighbours[j])
+            ++j;
+        else
+        {
+            common += state.fromNeighbours[i] != collapse.to && state.fromNeighbours[i] != collapse.from;
+            ++i;
+            ++j;
+        }
+    }
+    if (common != edgeTriangles)
+        return 0;
+
+    for (unsigned int m = 0; m < mappingCount; ++m)
+        state.remap[sources[m]] = targets[m];
+    addQuadric(state.quadrics[collapse.to], state.quadrics[collapse.from]);
+    return edgeTriangles;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// quadrics: the planes of the original triangles around every position, plus
+// planes through the border and seam edges, perpendicular to their triangle,
+// that keep those edges from drifting sideways
+// then passes of: half-edges + vertex kinds, every edge as a candidate in its
+// cheaper allowed direction, collapses cheapest first with both ends locked
+// for the rest of the pass, and removal of the collapsed triangles
+///////////////////////////////////////////////////////////////////////////////
+SimplifiedMesh simplifyMesh(const float* interleavedVertices, std::size_t vertexCount,
+    const unsigned int* indices, std::size_t indexCount,
+    std::size_t targetTriangleCount, float maxError)
+{
+    SimplifiedMesh result;
+    result.error = 0.0f;
+
+    SimplifierState state;
+    state.vertices = interleavedVertices;
+    state.welded = weldPositions(interleavedVertices, SIMPLIFIER_VERTEX_FLOATS, vertexCount);
+    state.indices.reserve(indexCount);
+    for (std::size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        unsigned int p0 = state.welded[indices[i]], p1 = state.welded[indices[i + 1]], p2 = state.welded[indices[i + 2]];
+        if (p0 != p1 && p1 != p2 && p2 != p0)
+            state.indices.insert(state.indices.end(), indices + i, indices + i + 3);
+    }
+
+    Quadric zero = {};
+    state.quadrics.assign(vertexCount, zero);
+    buildHalfEdgeMesh(state);
+    for (unsigned int h = 0; h < (unsigned int)state.indices.size(); ++h)
+    {
+        unsigned int t = h / 3;
+        const float* p1 = getPosition(state, state.indices[t * 3]);
+        const float* p2 = getPosition(state, state.indices[t * 3 + 1]);
+        const float* p3 = getPosition(state, state.indices[t * 3 + 2]);
+        float n[3];
+        crossProduct(p1, p2, p3, n);
+        float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length == 0.0f)
+            continue;
+        n[0] /= length;
+        n[1] /= length;
+        n[2] /= length;
+
+        // the triangle plane, once per corner
+        unsigned int a = state.indices[h], b = state.indices[nextHalfEdge(h)];
+        addPlane(state.quadrics[state.welded[a]], n[0], n[1], n[2], -(n[0] * p1[0] + n[1] * p1[1] + n[2] * p1[2]), 1.0);
+
+        if (state.mesh.twins[h] != NO_HALF_EDGE && !isSeamEdge(state, h))
+            continue;
+        const float* pa = getPosition(state, a);
+        const float* pb = getPosition(state, b);
+        float e[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+        float m[3] = { e[1] * n[2] - e[2] * n[1], e[2] * n[0] - e[0] * n[2], e[0] * n[1] - e[1] * n[0] };
+        float mLength = sqrtf(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+        if (mLength == 0.0f)
+            continue;
+        double d = -(m[0] * pa[0] + m[1] * pa[1] + m[2] * pa[2]) / mLength;
+        addPlane(state.quadrics[state.welded[a]], m[0] / mLength, m[1] / mLength, m[2] / mLength, d, BORDER_PLANE_WEIGHT);
+        addPlane(state.quadrics[state.welded[b]], m[0] / mLength, m[1] / mLength, m[2] / mLength, d, BORDER_PLANE_WEIGHT);
+    }
+
+    double maxCost = maxError < FLT_MAX ? (double)maxError * maxError : HUGE_VAL;
+    double costMade = 0.0;
+    std::vector<Collapse> collapses;
+    std::vector<bool> locked(vertexCount);
+    state.remap.resize(vertexCount);
+    std::size_t triangleCount = state.indices.size() / 3;
+    bool firstPass = true;
+    while (triangleCount > targetTriangleCount)
+    {
+        if (!firstPass)         // the first pass uses the half-edges built for the quadrics
+            buildHalfEdgeMesh(state);
+        firstPass = false;
+        classifyVertices(state);
+
+        // every edge once
+        collapses.clear();
+        for (unsigned int h = 0; h < (unsigned int)state.indices.size(); ++h)
+        {
+            unsigned int twin = state.mesh.twins[h];
+            if (twin != NO_HALF_EDGE && twin < h)
+                continue;
+
+            unsigned int a = state.welded[state.indices[h]], b = state.welded[state.indices[nextHalfEdge(h)]];
+            bool borderEdge = twin == NO_HALF_EDGE;
+            bool seamEdge = !borderEdge && isSeamEdge(state, h);
+            double costAB = canCollapse(state.kinds[a], state.kinds[b], borderEdge, seamEdge)
+                ? evaluateQuadric(state.quadrics[a], getPosition(state, b)) : HUGE_VAL;
+            double costBA = canCollapse(state.kinds[b], state.kinds[a], borderEdge, seamEdge)
+                ? evaluateQuadric(state.quadrics[b], getPosition(state, a)) : HUGE_VAL;
+
+            Collapse collapse = { a, b, costAB };
+            if (costBA < costAB)
+            {
+                collapse.from = b;
+                collapse.to = a;
+                collapse.cost = costBA;
+            }
+            if (collapse.cost != HUGE_VAL && collapse.cost <= maxCost)
+                collapses.push_back(collapse);
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b)
+        {
+            if (a.cost != b.cost)
+                return a.cost < b.cost;
+            return a.from != b.from ? a.from < b.from : a.to < b.to;
+        });
+
+        for (std::size_t v = 0; v < vertexCount; ++v)
+            state.remap[v] = (unsigned int)v;
+        std::fill(locked.begin(), locked.end(), false);
+        std::size_t goal = triangleCount - targetTriangleCount;
+        std::size_t removed = 0;
+        for (std::size_t i = 0; i < collapses.size() && removed < goal; ++i)
+        {
+            const Collapse& collapse = collapses[i];
+            if (locked[collapse.from] || locked[collapse.to])
+                continue;
+            unsigned int edgeTriangles = collapseEdge(state, collapse);
+            if (edgeTriangles == 0)
+                continue;
+            locked[collapse.from] = locked[collapse.to] = true;
+            removed += edgeTriangles;
+            costMade = std::max(costMade, collapse.cost);
+        }
+        if (removed == 0)
+            break;
+
+        // drop the triangles that lost an edge
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < state.indices.size(); i += 3)
+        {
+            unsigned int v0 = state.remap[state.indices[i]], v1 = state.remap[state.indices[i + 1]], v2 = state.remap[state.indices[i + 2]];
+            unsigned int p0 = state.welded[v0], p1 = state.welded[v1], p2 = state.welded[v2];
+            if (p0 == p1 || p1 == p2 || p2 == p0)
+                continue;
+            state.indices[count++] = v0;
+            state.indices[count++] = v1;
+            state.indices[count++] = v2;
+        }
+        state.indices.resize(count);
+        triangleCount = count / 3;
+    }
+
+    // keep the vertices still used, in first-use order
+    std::vector<unsigned int> newIndices(vertexCount, NO_HALF_EDGE);
+    result.indices.resize(state.indices.size());
+    for (std::size_t i = 0; i < state.indices.size(); ++i)
+    {
+        unsigned int v = state.indices[i];
+        if (newIndices[v] == NO_HALF_EDGE)
+        {
+            newIndices[v] = (unsigned int)(result.interleavedVertices.size() / SIMPLIFIER_VERTEX_FLOATS);
+            const float* vertex = getPosition(state, v);
+            result.interleavedVertices.insert(result.interleavedVertices.end(), vertex, vertex + SIMPLIFIER_VERTEX_FLOATS);
+        }
+        result.indices[i] = newIndices[v];
+    }
+    result.error = (float)sqrt(costMade);
+    return result;
+}
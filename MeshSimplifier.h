@@ -0,0 +1,38 @@
+#pragma once
+// Quadric error mesh simplification (Garland and Heckbert 1997) for indexed
+// triangle meshes in the interleaved layout of getInterleavedVertices():
+// position, normal, tex coords, 8 floats per vertex
+// edges are collapsed onto one of their vertices (half-edge collapses), so the
+// vertices left keep their exact normals and tex coords; vertices split by a
+// seam (tex coords or hard normals) only move along the seam, border vertices
+// along the border, and anything more tangled is kept
+// flat shaded meshes split every vertex and can't be reduced; simplify the
+// smooth mesh instead
+
+#ifndef GEOMETRY_MESH_SIMPLIFIER_H
+#define GEOMETRY_MESH_SIMPLIFIER_H
+
+#include <cfloat>
+#include <cstddef>
+#include <vector>
+
+const int SIMPLIFIER_VERTEX_FLOATS = 8;     // x, y, z, nx, ny, nz, s, t
+
+// output of simplifyMesh(), ready for a shape or a mesh file
+struct SimplifiedMesh
+{
+    std::vector<float> interleavedVertices;     // the vertices still used, in first-use order
+    std::vector<unsigned int> indices;          // triangle list
+    float error;                                // largest collapse error made, in model units
+};
+
+// collapse edges, cheapest first, until at most targetTriangleCount triangles
+// are left or the next collapse would cost more than maxError
+// the error of a collapse is the RMS distance of the moved vertex to the
+// planes of the original triangles merged into it, in model units
+// collapses that would turn a triangle by more than 60 degrees are skipped
+SimplifiedMesh simplifyMesh(const float* interleavedVertices, std::size_t vertexCount,
+    const unsigned int* indices, std::size_t indexCount,
+    std::size_t targetTriangleCount, float maxError = FLT_MAX);
+
+#endif
@@ -0,0 +1,279 @@
+// Meshlets: small clusters of triangles of an indexed mesh
+
+#include <algorithm>
+#include <cmath>
+#include "Frustum.h"
+#include "MeshOptimizer.h"
+#include "Meshlet.h"
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// greedy growth: start from the first triangle left, then keep adding the
+// adjacent triangle that needs the fewest new vertices, the one closest to
+// the meshlet's centroid among those, until a limit is hit or nothing
+// adjacent is left
+// adjacency goes by welded positions, so flat shaded meshes grow too
+///////////////////////////////////////////////////////////////////////////////
+std::vector<Meshlet> buildMeshlets(unsigned int* indices, std::size_t indexCount,
+    const float* positions, int positionStride, std::size_t vertexCount,
+    unsigned int maxVertices, unsigned int maxTriangles)
+{
+    std::vector<Meshlet> meshlets;
+    std::size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0 || vertexCount == 0)
+        return meshlets;
+    if (maxVertices < 3)
+        maxVertices = 3;
+    if (maxTriangles < 1)
+        maxTriangles = 1;
+
+    // position-triangle adjacency
+    std::vector<unsigned int> welded = weldPositions(positions, positionStride, vertexCount);
+    std::vector<std::size_t> offsets(vertexCount + 1, 0);
+    for (std::size_t i = 0; i < indexCount; ++i)
+        ++offsets[welded[indices[i]] + 1];
+    for (std::size_t v = 0; v < vertexCount; ++v)
+        offsets[v + 1] += offsets[v];
+
+    std::vector<unsigned int> adjacency(indexCount);
+    std::vector<std::size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (std::size_t i = 0; i < indexCount; ++i)
+        adjacency[fill[welded[indices[i]]]++] = (unsigned int)(i / 3);
+
+    // meshlet + 1 that last took each vertex, 0 = none
+    std::vector<unsigned int> vertexMeshlet(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> meshletVertices;
+    std::vector<unsigned int> output;
+    output.reserve(indexCount);
+    meshletVertices.reserve(maxVertices);
+
+    std::size_t seed = 0;
+    std::size_t emittedCount = 0;
+    while (emittedCount < triangleCount)
+    {
+        while (emitted[seed])
+            ++seed;
+
+        unsigned int tag = (unsigned int)meshlets.size() + 1;
+        Meshlet meshlet = {};
+        meshlet.firstIndex = (unsigned int)output.size();
+        meshletVertices.clear();
+        float centroid[3] = { 0.0f, 0.0f, 0.0f };     // sum of the meshlet's vertex positions
+
+        std::size_t triangle = seed;
+        unsigned int meshletTriangles = 0;
+        while (true)
+        {
+            // take the triangle
+            emitted[triangle] = true;
+            ++emittedCount;
+            ++meshletTriangles;
+            for (int k = 0; k < 3; ++k)
+            {
+                unsigned int v = indices[triangle * 3 + k];
+                output.push_back(v);
+                if (vertexMeshlet[v] != tag)
+                {
+                    vertexMeshlet[v] = tag;
+                    meshletVertices.push_back(v);
+                    const float* p = positions + (std::size_t)v * positionStride;
+                    centroid[0] += p[0];
+                    centroid[1] += p[1];
+                    centroid[2] += p[2];
+                }
+            }
+            if (meshletTriangles >= maxTriangles)
+                break;
+
+            // best neighbour that still fits
+            float scale = 1.0f / meshletVertices.size();
+            float cx = centroid[0] * scale, cy = centroid[1] * scale, cz = centroid[2] * scale;
+            std::size_t best = triangleCount;
+            unsigned int bestNewVertices = 4;
+            float bestDistance = 0.0f;
+            for (std::size_t i = 0; i < meshletVertices.size(); ++i)
+            {
+                unsigned int v = welded[meshletVertices[i]];
+                for (std::size_t j = offsets[v]; j < offsets[v + 1]; ++j)
+                {
+                    unsigned int candidate = adjacency[j];
+                    if (emitted[candidate])
+                        continue;
+
+                    const unsigned int* corners = indices + candidate * 3;
+                    unsigned int newVertices = (vertexMeshlet[corners[0]] != tag) + (vertexMeshlet[corners[1]] != tag)
+                        + (vertexMeshlet[corners[2]] != tag);
+                    if (meshletVertices.size() + newVertices > maxVertices || newVertices > bestNewVertices)
+                        continue;
+
+                    float distance = 0.0f;
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        const float* p = positions + (std::size_t)corners[k] * positionStride;
+                        float dx = p[0] - cx, dy = p[1] - cy, dz = p[2] - cz;
+                        distance += dx * dx + dy * dy + dz * dz;
+                    }
+                    if (newVertices < bestNewVertices || distance < bestDistance
+                        || (distance == bestDistance && candidate < best))
+                    {
+                        best = candidate;
+                        bestNewVertices = newVertices;
+                        bestDistance = distance;
+                    }
+                }
+            }
+            if (best == triangleCount)
+                break;
+            triangle = best;
+        }
+
+        meshlet.indexCount = (unsigned int)output.size() - meshlet.firstIndex;
+        meshlets.push_back(meshlet);
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+    for (std::size_t i = 0; i < meshlets.size(); ++i)
+        computeMeshletBounds(meshlets[i], indices, positions, positionStride);
+    return meshlets;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// sphere around the centre of the bounding box of the corners
+// cone around the normalized sum of the face normals; if the spread reaches
+// 90 degrees some triangle always faces the camera, so the cone is disabled
+///////////////////////////////////////////////////////////////////////////////
+void computeMeshletBounds(Meshlet& meshlet, const unsigned int* indices, const float* positions,
+    int positionStride)
+{
+    const unsigned int* first = indices + meshlet.firstIndex;
+    const unsigned int* last = first + meshlet.indexCount;
+
+    float minCorner[3] = { 0.0f, 0.0f, 0.0f }, maxCorner[3] = { 0.0f, 0.0f, 0.0f };
+    for (const unsigned int* index = first; index != last; ++index)
+    {
+        const float* p = positions + (std::size_t)*index * positionStride;
+        for (int k = 0; k < 3; ++k)
+        {
+            if (index == first || p[k] < minCorner[k])
+                minCorner[k] = p[k];
+            if (index == first || p[k] > maxCorner[k])
+                maxCorner[k] = p[k];
+        }
+    }
+
+    float radius2 = 0.0f;
+    for (int k = 0; k < 3; ++k)
+        meshlet.center[k] = (minCorner[k] + maxCorner[k]) * 0.5f;
+    for (const unsigned int* index = first; index != last; ++index)
+    {
+        const float* p = positions + (std::size_t)*index * positionStride;
+        float dx = p[0] - meshlet.center[0], dy = p[1] - meshlet.center[1], dz = p[2] - meshlet.center[2];
+        radius2 = std::max(radius2, dx * dx + dy * dy + dz * dz);
+    }
+    meshlet.radius = sqrtf(radius2);
+
+    // unit face normals, summed for the axis
+    std::vector<float> faceNormals;
+    faceNormals.reserve(meshlet.indexCount);
+    float axis[3] = { 0.0f, 0.0f, 0.0f };
+    for (const unsigned int* index = first; index + 2 < last; index += 3)
+    {
+        const float* p1 = positions + (std::size_t)index[0] * positionStride;
+        const float* p2 = positions + (std::size_t)index[1] * positionStride;
+        const float* p3 = positions + (std::size_t)index[2] * positionStride;
+        float e1[3] = { p2[0] - p1[0], p2[1] - p1[1], p2[2] - p1[2] };
+        float e2[3] = { p3[0] - p1[0], p3[1] - p1[1], p3[2] - p1[2] };
+        float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+        float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length == 0.0f)
+            continue;   // no surface, faces nowhere
+        for (int k = 0; k < 3; ++k)
+        {
+            faceNormals.push_back(n[k] / length);
+            axis[k] += n[k] / length;
+        }
+    }
+
+    meshlet.coneAxis[0] = meshlet.coneAxis[1] = meshlet.coneAxis[2] = 0.0f;
+    meshlet.coneCutoff = 1.0f;
+    float axisLength = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    if (axisLength == 0.0f)
+        return;
+
+    float minDot = 1.0f;
+    for (int k = 0; k < 3; ++k)
+        meshlet.coneAxis[k] = axis[k] / axisLength;
+    for (std::size_t i = 0; i < faceNormals.size(); i += 3)
+    {
+        float d = faceNormals[i] * meshlet.coneAxis[0] + faceNormals[i + 1] * meshlet.coneAxis[1]
+            + faceNormals[i + 2] * meshlet.coneAxis[2];
+        minDot = std::min(minDot, d);
+    }
+    if (minDot > 0.0f)
+        meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// test in model space: the frustum planes come from projection * modelView,
+// the camera from the inverse of modelView
+// a meshlet faces away if the view direction to every point of its sphere is
+// within 90 degrees minus the cone half angle of the cone axis
+///////////////////////////////////////////////////////////////////////////////
+std::size_t cullMeshlets(const std::vector<Meshlet>& meshlets, const glm::mat4& modelView,
+    const glm::mat4& projection, unsigned int indexElementSize, MeshletDrawList& drawList)
+{
+    drawList.clear();
+    Frustum frustum(projection * modelView);
+
+    // camera position, or the view direction for an orthographic projection
+    glm::mat4 viewToModel = glm::inverse(modelView);
+    bool orthographic = projection[2][3] == 0.0f;
+    glm::vec3 eye = orthographic ? glm::normalize(glm::vec3(viewToModel * glm::vec4(0.0f, 0.0f, -1.0f, 0.0f)))
+        : glm::vec3(viewToModel[3]);
+
+    std::size_t visibleCount = 0;
+    for (std::size_t i = 0; i < meshlets.size(); ++i)
+    {
+        const Meshlet& meshlet = meshlets[i];
+        glm::vec3 center(meshlet.center[0], meshlet.center[1], meshlet.center[2]);
+        if (!frustum.intersectsSphere(center, meshlet.radius))
+            continue;
+
+        if (meshlet.coneCutoff < 1.0f)
+        {
+            glm::vec3 axis(meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2]);
+            if (orthographic)
+            {
+                if (glm::dot(eye, axis) >= meshlet.coneCutoff)
+                    continue;
+            }
+            else
+            {
+                glm::vec3 toCenter = center - eye;
+                if (glm::dot(toCenter, axis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius)
+                    continue;
+            }
+        }
+
+        // continue the previous range if this one starts where it ends
+        ++visibleCount;
+        std::size_t offset = (std::size_t)meshlet.firstIndex * indexElementSize;
+        if (!drawList.counts.empty()
+            && (std::size_t)drawList.offsets.back() + (std::size_t)drawList.counts.back() * indexElementSize == offset)
+        {
+            drawList.counts.back() += meshlet.indexCount;
+        }
+        else
+        {
+            drawList.counts.push_back(meshlet.indexCount);
+            drawList.offsets.push_back((const void*)offset);
+        }
+    }
+    return visibleCount;
+}
@@ -0,0 +1,65 @@
+#pragma once
+// Meshlets: small clusters of triangles of an indexed mesh
+// the triangles of every meshlet are made contiguous in the index array, so a
+// meshlet is just a range of it; each one has a bounding sphere and a normal
+// cone, so the clusters that are off-screen or face away from the camera can
+// be skipped on the CPU and the rest drawn with one glMultiDrawElements()
+// the size limits follow what mesh shader hardware likes (64 vertices, 124
+// triangles); here they keep clusters compact enough to cull well
+// all functions work on any mesh given as 32-bit triangle indices
+
+#ifndef GEOMETRY_MESHLET_H
+#define GEOMETRY_MESHLET_H
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+const unsigned int MESHLET_MAX_VERTICES = 64;
+const unsigned int MESHLET_MAX_TRIANGLES = 124;
+
+// a range of triangles and its bounds, in model space
+// plain data, stored as is in mesh files
+struct Meshlet
+{
+    unsigned int firstIndex;                // first triangle index of the range
+    unsigned int indexCount;                // 3 per triangle
+    float center[3];                        // bounding sphere
+    float radius;
+    float coneAxis[3];                      // average facing of the triangles
+    float coneCutoff;                       // sin of the cone half angle; 1 = can't be back-facing as a whole
+};
+
+// index ranges of the meshlets to draw, merged where they touch
+struct MeshletDrawList
+{
+    std::vector<int> counts;                // GLsizei, # of indices per range
+    std::vector<const void*> offsets;       // byte offsets into the bound index buffer
+
+    void clear() { counts.clear(); offsets.clear(); }
+    int getDrawCount() const { return (int)counts.size(); }
+};
+
+// split the triangles into meshlets of at most maxVertices distinct vertices
+// and maxTriangles triangles, and reorder the indices in place to match
+// meshlets grow over shared vertices, so they stay connected and compact;
+// a vertex cache optimized order is mostly kept within a meshlet
+// positions: 3 floats per vertex with the given stride in floats
+std::vector<Meshlet> buildMeshlets(unsigned int* indices, std::size_t indexCount,
+    const float* positions, int positionStride, std::size_t vertexCount,
+    unsigned int maxVertices = MESHLET_MAX_VERTICES, unsigned int maxTriangles = MESHLET_MAX_TRIANGLES);
+
+// recompute the bounding sphere and normal cone of a meshlet, e.g. after its vertices moved
+void computeMeshletBounds(Meshlet& meshlet, const unsigned int* indices, const float* positions,
+    int positionStride);
+
+// fill drawList with the meshlets that may be visible, and return how many
+// a meshlet is skipped if its sphere is outside the frustum, or if every
+// triangle of it faces away from the camera; the cone test assumes the model
+// matrix has a uniform scale
+// works for perspective and orthographic projections, like computeScreenRadius()
+// indexElementSize: 2 or 4 bytes, for the offsets
+std::size_t cullMeshlets(const std::vector<Meshlet>& meshlets, const glm::mat4& modelView,
+    const glm::mat4& projection, unsigned int indexElementSize, MeshletDrawList& drawList);
+
+#endif
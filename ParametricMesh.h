@@ -0,0 +1,348 @@
+#pragma once
+// Indexed mesh of a parametric surface (u, v) -> position, normal
+// the surface is sampled on a grid of uSegmentCount x vSegmentCount quads and
+// built the same way as Sphere and Cylinder: arrays sized once and written in
+// place, rows split over a thread pool for large meshes, triangle strips for
+// smooth shading; storage, indices, dirty ranges, GPU buffers and drawing come
+// from IndexedMesh
+// s = u and t = 1 - v, so t runs from the top down like on Sphere/Cylinder
+// Surface needs:
+//   void evaluate(float u, float v, float position[3], float normal[3]) const;
+//   float getBoundingRadius() const;      // about the origin
+// see ParametricSurfaces.h for the ones shipped here
+
+#ifndef GEOMETRY_PARAMETRIC_MESH_H
+#define GEOMETRY_PARAMETRIC_MESH_H
+
+#include <iostream>
+#include <vector>
+#include "IndexedMesh.h"
+#include "MeshBuilder.h"
+#include "ThreadPool.h"
+
+template<class Surface>
+class ParametricMesh : public IndexedMesh
+{
+public:
+    // ctor/dtor
+    ParametricMesh(const Surface& surface = Surface(), int uSegmentCount = 36, int vSegmentCount = 18,
+        bool smooth = true, ThreadPool* threadPool = nullptr);
+    ~ParametricMesh() {}
+
+    // getters/setters
+    const Surface& getSurface() const { return surface; }
+    int getUSegmentCount() const { return uSegmentCount; }
+    int getVSegmentCount() const { return vSegmentCount; }
+    float getBoundingRadius() const { return surface.getBoundingRadius(); }
+    void set(const Surface& surface, int uSegmentCount, int vSegmentCount, bool smooth = true);
+    void setSurface(const Surface& surface);
+    void setUSegmentCount(int count);
+    void setVSegmentCount(int count);
+    void setSmooth(bool smooth);
+    ThreadPool* getThreadPool() const { return threadPool; }
+    void setThreadPool(ThreadPool* pool) { threadPool = pool; }    // used from the next build on, nullptr = serial
+
+    // debug
+    void printSelf() const;
+
+    // member functions
+    void buildVertices() override;
+    void buildVerticesSmooth();
+    void buildRowsSmooth(int firstRow, int lastRow);
+    void buildVerticesFlat();
+    void buildRowsFlat(int firstRow, int lastRow);
+    void removeDegenerateTriangles();
+
+    // memeber vars
+    Surface surface;
+    int uSegmentCount;                      // # of quads along u
+    int vSegmentCount;                      // # of quads along v
+    bool smooth;
+    ThreadPool* threadPool;                 // not owned; splits large builds by rows
+
+    static const int MIN_SEGMENT_COUNT = 1;
+    static const unsigned int MIN_PARALLEL_VERTEX_COUNT = 64 * 1024;   // smaller meshes build faster serially
+};
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor
+///////////////////////////////////////////////////////////////////////////////
+template<class Surface>
+ParametricMesh<Surface>::ParametricMesh(const Surface& surface, int uSegments, int vSegments, bool smooth,
+    ThreadPool* threadPool)
+    : threadPool(threadPool)
+{
+    set(surface, uSegments, vSegments, smooth);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// setters
+///////////////////////////////////////////////////////////////////////////////
+template<class Surface>
+void ParametricMesh<Surface>::set(const Surface& surface, int uSegments, int vSegments, bool smooth)
+{
+    this->surface = surface;
+    this->uSegmentCount = uSegments < MIN_SEGMENT_COUNT ? MIN_SEGMENT_COUNT : uSegments;
+    this->vSegmentCount = vSegments < MIN_SEGMENT_COUNT ? MIN_SEGMENT_COUNT : vSegments;
+    this->smooth = smooth;
+
+    buildVertices();
+    applyStorage();
+}
+
+template<class Surface>
+void ParametricMesh<Surface>::setSurface(const Surface& surface)
+{
+    set(surface, uSegmentCount, vSegmentCount, smooth);
+}
+
+template<class Surface>
+void ParametricMesh<Surface>::setUSegmentCount(int count)
+{
+    if (count != uSegmentCount)
+        set(surface, count, vSegmentCount, smooth);
+}
+
+template<class Surface>
+void ParametricMesh<Surface>::setVSegmentCount(int count)
+{
+    if (count != vSegmentCount)
+        set(surface, uSegmentCount, count, smooth);
+}
+
+template<class Surface>
+void ParametricMesh<Surface>::setSmooth(bool smooth)
+{
+    if (this->smooth == smooth)
+        return;
+
+    this->smooth = smooth;
+    buildVertices();
+    applyStorage();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// print itself
+///////////////////////////////////////////////////////////////////////////////
+template<class Surface>
+void ParametricMesh<Surface>::printSelf() const
+{
+    std::cout << "===== ParametricMesh =====\n"
+        << "Bounding Radius: " << getBoundingRadius() << "\n"
+        << "  U Segment Count: " << uSegmentCount << "\n"
+        << "  V Segment Count: " << vSegmentCount << "\n"
+        << "   Smooth Shading: " << (smooth ? "true" : "false") << "\n"
+        << "   Triangle Count: " << getTriangleCount() << "\n"
+        << "      Index Count: " << getIndexCount() << "\n"
+        << "     Vertex Count: " << getVertexCount() << std::endl;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// build the mesh for the current shading
+// triangles collapsed by the surface (poles, apexes, creases) are dropped
+// from the triangle list; the strips keep them, they are not rasterized
+///////////////////////////////////////////////////////////////////////////////
+template<class Surface>
+void ParametricMesh<Surface>::buildVertices()
+{
+    if (smooth)
+        buildVerticesSmooth();
+    else
+        buildVerticesFlat();
+    removeDegenerateTriangles();
+    packIndices();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// smooth shading: (uSegmentCount+1) x (vSegmentCount+1) shared vertices with
+// the normals of the surface; the first and last columns are the same points
+// of a closed surface, with s = 0 and s = 1
+///////////////////////////////////////////////////////////////////////////////
+template<class Surface>
+void ParametricMesh<Surface>::buildVerticesSmooth()
+{
+    // 2 triangles per quad; a strip of 2 indices per column per row, plus restarts in between
+    unsigned int vertexCount = (vSegmentCount + 1) * (uSegmentCount + 1);
+    unsigned int indexCount = 6 * uSegmentCount * vSegmentCount;
+    unsigned int stripIndexCount = vSegmentCount * (2 * uSegmentCount + 3) - 1;
+    resizeArrays(vertexCount, indexCount, stripIndexCount);
+
+    if (threadPool && vertexCount >= MIN_PARALLEL_VERTEX_COUNT)
+        threadPool->parallelFor(0, vSegmentCount + 1, [this](int first, int last) { buildRowsSmooth(first, last); });
+    else
+        buildRowsSmooth(0, vSegmentCount + 1);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// write the vertex rows [firstRow, lastRow) and the triangles/strips of the
+// quad rows starting on them; offsets depend only on the row, so disjoint
+// ranges can be built in any order or at the same time
+///////////////////////////////////////////////////////////////////////////////
+template<class Surface>
+void ParametricMesh<Surface>::buildRowsSmooth(int firstRow, int lastRow)
+{
+    float position[3], normal[3];
+    unsigned int index = firstRow * (uSegmentCount + 1);
+    for (int j = firstRow; j < lastRow; ++j)
+    {
+        float v = (float)j / vSegmentCount;
+        for (int i = 0; i <= uSegmentCount; ++i, ++index)
+        {
+            float u = (float)i / uSegmentCount;
+            surface.evaluate(u, v, position, normal);
+            setVertex(index, position[0], position[1], position[2], normal[0], normal[1], normal[2], u, 1.0f - v);
+        }
+    }
+
+    // the last row only closes the quads below it
+    if (lastRow > vSegmentCount)
+        lastRow = vSegmentCount;
+
+    //  k2--k2+1  <== row j+1
+    //  |  / |
+    //  | /  |
+    //  k1--k1+1  <== row j
+    unsigned int* triangle = indices.data() + 6 * uSegmentCount * firstRow;
+    unsigned int* strip = stripIndices.data() + (2 * uSegmentCount + 3) * firstRow;
+    unsigned int k1, k2;
+    for (int j = firstRow; j < lastRow; ++j)
+    {
+        k1 = j * (uSegmentCount + 1);
+        k2 = k1 + uSegmentCount + 1;
+        for (int i = 0; i < uSegmentCount; ++i, ++k1, ++k2)
+        {
+            *triangle++ = k1;
+            *triangle++ = k1 + 1;
+            *triangle++ = k2;
+            *triangle++ = k2;
+            *triangle++ = k1 + 1;
+            *triangle++ = k2 + 1;
+        }
+
+        // strip k2, k1, k2+1, k1+1, ... splits the quads along the other diagonal
+        k1 = j * (uSegmentCount + 1);
+        k2 = k1 + uSegmentCount + 1;
+        for (int i = 0; i <= uSegmentCount; ++i)
+        {
+            *strip++ = k2 + i;
+            *strip++ = k1 + i;
+        }
+        if (j < vSegmentCount - 1)
+            *strip++ = RESTART_INDEX;
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// flat shading: 4 vertices per quad with the normal of the quad
+///////////////////////////////////////////////////////////////////////////////
+template<class Surface>
+void ParametricMesh<Surface>::buildVerticesFlat()
+{
+    unsigned int vertexCount = 4 * uSegmentCount * vSegmentCount;
+    unsigned int indexCount = 6 * uSegmentCount * vSegmentCount;
+    resizeArrays(vertexCount, indexCount, 0);
+
+    if (threadPool && vertexCount >= MIN_PARALLEL_VERTEX_COUNT)
+        threadPool->parallelFor(0, vSegmentCount, [this](int first, int last) { buildRowsFlat(first, last); });
+    else
+        buildRowsFlat(0, vSegmentCount);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// write the quad rows [firstRow, lastRow)
+// the 2 grid rows of a quad row are sampled once into a small buffer
+//  v3--v4  <== row j+1
+//  |  / |
+//  | /  |
+//  v1--v2  <== row j
+///////////////////////////////////////////////////////////////////////////////
+template<class Surface>
+void ParametricMesh<Surface>::buildRowsFlat(int firstRow, int lastRow)
+{
+    std::vector<float> rows(2 * (uSegmentCount + 1) * 3);   // positions of rows j and j+1
+    float* lower = rows.data();
+    float* upper = lower + (uSegmentCount + 1) * 3;
+    float normal[3];
+
+    unsigned int index = 4 * uSegmentCount * firstRow;
+    unsigned int* triangle = indices.data() + 6 * uSegmentCount * firstRow;
+    for (int j = firstRow; j < lastRow; ++j)
+    {
+        float v1 = (float)j / vSegmentCount;
+        float v2 = (float)(j + 1) / vSegmentCount;
+        for (int i = 0; i <= uSegmentCount; ++i)
+        {
+            float u = (float)i / uSegmentCount;
+            surface.evaluate(u, v1, &lower[i * 3], normal);
+            surface.evaluate(u, v2, &upper[i * 3], normal);
+        }
+
+        for (int i = 0; i < uSegmentCount; ++i, index += 4)
+        {
+            const float* p1 = &lower[i * 3];
+            const float* p2 = &lower[i * 3 + 3];
+            const float* p3 = &upper[i * 3];
+            const float* p4 = &upper[i * 3 + 3];
+            float s1 = (float)i / uSegmentCount;
+            float s2 = (float)(i + 1) / uSegmentCount;
+
+            computeQuadNormal(p1, p2, p3, p4, normal);
+            setVertex(index, p1[0], p1[1], p1[2], normal[0], normal[1], normal[2], s1, 1.0f - v1);
+            setVertex(index + 1, p2[0], p2[1], p2[2], normal[0], normal[1], normal[2], s2, 1.0f - v1);
+            setVertex(index + 2, p3[0], p3[1], p3[2], normal[0], normal[1], normal[2], s1, 1.0f - v2);
+            setVertex(index + 3, p4[0], p4[1], p4[2], normal[0], normal[1], normal[2], s2, 1.0f - v2);
+
+            *triangle++ = index;            // v1-v2-v3
+            *triangle++ = index + 1;
+            *triangle++ = index + 2;
+            *triangle++ = index + 2;        // v3-v2-v4
+            *triangle++ = index + 1;
+            *triangle++ = index + 3;
+        }
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// drop triangles with 2 corners at the same position, keeping the order
+///////////////////////////////////////////////////////////////////////////////
+template<class Surface>
+void ParametricMesh<Surface>::removeDegenerateTriangles()
+{
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < indices.size(); i += 3)
+    {
+        const float* p1 = &vertices[indices[i] * 3];
+        const float* p2 = &vertices[indices[i + 1] * 3];
+        const float* p3 = &vertices[indices[i + 2] * 3];
+        bool same12 = p1[0] == p2[0] && p1[1] == p2[1] && p1[2] == p2[2];
+        bool same23 = p2[0] == p3[0] && p2[1] == p3[1] && p2[2] == p3[2];
+        bool same31 = p3[0] == p1[0] && p3[1] == p1[1] && p3[2] == p1[2];
+        if (same12 || same23 || same31)
+            continue;
+
+        indices[count++] = indices[i];
+        indices[count++] = indices[i + 1];
+        indices[count++] = indices[i + 2];
+    }
+    indices.resize(count);
+}
+
+#endif
@@ -0,0 +1,203 @@
+// Surfaces for ParametricMesh
+
+#include <algorithm>
+#include <cmath>
+#include "ParametricSurfaces.h"
+
+static const float TWO_PI = 6.28318531f;
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// torus: u sweeps around z, v goes around the tube from the outer equator up
+///////////////////////////////////////////////////////////////////////////////
+TorusSurface::TorusSurface(float majorRadius, float minorRadius, float sweepAngle)
+    : majorRadius(majorRadius), minorRadius(minorRadius), sweepAngle(sweepAngle)
+{
+}
+
+void TorusSurface::evaluate(float u, float v, float position[3], float normal[3]) const
+{
+    float sectorAngle = sweepAngle * u;     // around z
+    float sideAngle = TWO_PI * v;           // around the tube
+    float cosSector = cosf(sectorAngle), sinSector = sinf(sectorAngle);
+    float cosSide = cosf(sideAngle), sinSide = sinf(sideAngle);
+
+    float ringRadius = majorRadius + minorRadius * cosSide;
+    position[0] = ringRadius * cosSector;
+    position[1] = ringRadius * sinSector;
+    position[2] = minorRadius * sinSide;
+    normal[0] = cosSide * cosSector;
+    normal[1] = cosSide * sinSector;
+    normal[2] = sinSide;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// lathe: take the profile points and compute a unit normal per point
+// a segment (dr, dz) has the outward normal (dz, -dr); a point averages the
+// normals of its segments with a length, so repeated points keep the normal
+// of their own side
+///////////////////////////////////////////////////////////////////////////////
+LatheSurface::LatheSurface(const std::vector<float>& profile, const std::vector<float>& profileNormals)
+    : points(profile), boundingRadius(0)
+{
+    int count = (int)points.size() / 2;
+    points.resize(count * 2);
+    pointNormals.assign(count * 2, 0.0f);
+
+    for (int i = 0; i < count; ++i)
+    {
+        float r = points[i * 2];
+        float z = points[i * 2 + 1];
+        boundingRadius = std::max(boundingRadius, sqrtf(r * r + z * z));
+    }
+
+    if ((int)profileNormals.size() >= count * 2)
+    {
+        pointNormals.assign(profileNormals.begin(), profileNormals.begin() + count * 2);
+    }
+    else
+    {
+        for (int i = 0; i < count - 1; ++i)
+        {
+            float dr = points[i * 2 + 2] - points[i * 2];
+            float dz = points[i * 2 + 3] - points[i * 2 + 1];
+            float length = sqrtf(dr * dr + dz * dz);
+            if (length == 0.0f)
+                continue;   // repeated point, a crease
+
+            // add to both ends of the segment
+            pointNormals[i * 2] += dz / length;
+            pointNormals[i * 2 + 1] -= dr / length;
+            pointNormals[i * 2 + 2] += dz / length;
+            pointNormals[i * 2 + 3] -= dr / length;
+        }
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        float nr = pointNormals[i * 2];
+        float nz = pointNormals[i * 2 + 1];
+        float length = sqrtf(nr * nr + nz * nz);
+        if (length > 0.0f)
+        {
+            pointNormals[i * 2] = nr / length;
+            pointNormals[i * 2 + 1] = nz / length;
+        }
+    }
+}
+
+void LatheSurface::evaluate(float u, float v, float position[3], float normal[3]) const
+{
+    int segmentCount = getProfileSegmentCount();
+    if (segmentCount < 1)
+    {
+        position[0] = position[1] = position[2] = 0.0f;
+        normal[0] = normal[1] = 0.0f;
+        normal[2] = 1.0f;
+        return;
+    }
+
+    // segment and fraction along it; a v on a profile point (within float
+    // error) takes that point exactly, so the rings of creases and poles match
+    const float EPSILON = 0.0001f;
+    float t = v * segmentCount;
+    int i = (int)t;
+    if (i > segmentCount - 1)
+        i = segmentCount - 1;
+    else if (i < 0)
+        i = 0;
+    float f = t - i;
+    if (f < EPSILON)
+    {
+        f = 0.0f;
+    }
+    else if (f > 1.0f - EPSILON)
+    {
+        f = 0.0f;
+        ++i;
+    }
+
+    float r = points[i * 2];
+    float z = points[i * 2 + 1];
+    float nr = pointNormals[i * 2];
+    float nz = pointNormals[i * 2 + 1];
+    if (f > 0.0f)
+    {
+        r += (points[i * 2 + 2] - r) * f;
+        z += (points[i * 2 + 3] - z) * f;
+        nr += (pointNormals[i * 2 + 2] - nr) * f;
+        nz += (pointNormals[i * 2 + 3] - nz) * f;
+        float length = sqrtf(nr * nr + nz * nz);
+        if (length > 0.0f)
+        {
+            nr /= length;
+            nz /= length;
+        }
+    }
+
+    float sectorAngle = TWO_PI * u;
+    float cosSector = cosf(sectorAngle), sinSector = sinf(sectorAngle);
+    position[0] = r * cosSector;
+    position[1] = r * sinSector;
+    position[2] = z;
+    normal[0] = nr * cosSector;
+    normal[1] = nr * sinSector;
+    normal[2] = nz;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// cone: base centre, base rim twice (crease), apex
+///////////////////////////////////////////////////////////////////////////////
+LatheSurface makeConeSurface(float radius, float height)
+{
+    float halfHeight = height * 0.5f;
+    std::vector<float> profile = {
+        0.0f,   -halfHeight,
+        radius, -halfHeight,
+        radius, -halfHeight,
+        0.0f,    halfHeight
+    };
+    return LatheSurface(profile);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// capsule: 2 hemispheres with the exact sphere normals; the straight part is
+// the segment between their equators
+///////////////////////////////////////////////////////////////////////////////
+LatheSurface makeCapsuleSurface(float radius, float length, int hemisphereStacks)
+{
+    if (hemisphereStacks < 1)
+        hemisphereStacks = 1;
+
+    float halfLength = length * 0.5f;
+    float stackStep = TWO_PI / 4 / hemisphereStacks;
+    std::vector<float> profile, normals;
+    profile.reserve((hemisphereStacks + 1) * 4);
+    normals.reserve((hemisphereStacks + 1) * 4);
+
+    // bottom hemisphere from the pole (-pi/2) to the equator, then the top one
+    for (int half = 0; half < 2; ++half)
+    {
+        float centreZ = half == 0 ? -halfLength : halfLength;
+        for (int i = 0; i <= hemisphereStacks; ++i)
+        {
+            float stackAngle = (half == 0 ? -TWO_PI / 4 : 0.0f) + i * stackStep;
+            float nr = cosf(stackAngle);
+            float nz = sinf(stackAngle);
+            if ((half == 0 && i == 0) || (half == 1 && i == hemisphereStacks))
+                nr = 0.0f;  // poles exactly on the axis
+            profile.push_back(radius * nr);
+            profile.push_back(centreZ + radius * nz);
+            normals.push_back(nr);
+            normals.push_back(nz);
+        }
+    }
+    return LatheSurface(profile, normals);
+}
@@ -0,0 +1,65 @@
+#pragma once
+// Surfaces for ParametricMesh
+// a surface maps (u, v) in [0, 1] x [0, 1] to a position and a unit normal;
+// the normal must point to the side of du x dv, which is the front face
+// every surface here revolves around the z axis with u, counter-clockwise
+// seen from +z, and v runs from the bottom up (or around the tube of a torus)
+
+#ifndef GEOMETRY_PARAMETRIC_SURFACES_H
+#define GEOMETRY_PARAMETRIC_SURFACES_H
+
+#include <vector>
+#include "ParametricMesh.h"
+
+// torus around the z axis, centred at the origin
+// sweepAngle < 2pi gives an open arc starting at +x, e.g. for a handle
+struct TorusSurface
+{
+    explicit TorusSurface(float majorRadius = 1.0f, float minorRadius = 0.25f,
+        float sweepAngle = 6.28318531f);
+
+    void evaluate(float u, float v, float position[3], float normal[3]) const;
+    float getBoundingRadius() const { return majorRadius + minorRadius; }
+
+    float majorRadius;                      // centre of the tube to the z axis
+    float minorRadius;                      // radius of the tube
+    float sweepAngle;                       // radians around z, 2pi = closed ring
+};
+
+
+
+// surface of revolution of a profile around the z axis (lathe)
+// the profile is a polyline of (radius, z) points from the bottom up; v moves
+// along it with the same step per segment, so with getProfileSegmentCount()
+// v segments every profile point gets a ring of vertices
+// normals come from the adjacent segments, or are given per point; a point
+// listed twice makes a crease, e.g. the rim of a flat base
+class LatheSurface
+{
+public:
+    LatheSurface() : boundingRadius(0) {}
+    explicit LatheSurface(const std::vector<float>& profile,
+        const std::vector<float>& profileNormals = std::vector<float>());
+
+    void evaluate(float u, float v, float position[3], float normal[3]) const;
+    float getBoundingRadius() const { return boundingRadius; }     // about the origin
+    int getProfileSegmentCount() const { return points.empty() ? 0 : (int)points.size() / 2 - 1; }
+    const std::vector<float>& getProfile() const { return points; }
+
+private:
+    std::vector<float> points;              // (radius, z) per profile point
+    std::vector<float> pointNormals;        // (radial, z) unit normal per profile point
+    float boundingRadius;
+};
+
+// closed cone along z, centred at the origin: flat base and a side up to the apex
+LatheSurface makeConeSurface(float radius, float height);
+
+// cylinder of the given length between the centres of 2 hemispheres, along z
+// and centred at the origin; hemisphereStacks rings per hemisphere
+LatheSurface makeCapsuleSurface(float radius, float length, int hemisphereStacks = 8);
+
+typedef ParametricMesh<TorusSurface> Torus;
+typedef ParametricMesh<LatheSurface> Lathe;
+
+#endif
@@ -0,0 +1,370 @@
+// Render queue: draw packets sorted by a 64-bit key and executed in order
+// as multi draw indirect batches, repeated draws merged into instances
+
+#include <algorithm>
+#include <cstring>
+#include "RenderQueue.h"
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// replace the content of a buffer written once per frame; the storage is
+// orphaned first so the draws of the previous frame can still read the old one
+///////////////////////////////////////////////////////////////////////////////
+static void uploadStreamBuffer(GLenum target, GLuint buffer, GLsizeiptr& allocatedSize,
+    const void* data, GLsizeiptr size)
+{
+    if (size > allocatedSize)
+        allocatedSize = size;
+
+    glBindBuffer(target, buffer);
+    glBufferData(target, allocatedSize, NULL, GL_STREAM_DRAW);
+    glBufferSubData(target, 0, size, data);
+    glBindBuffer(target, 0);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// pack the fields; the depth goes in as the bits of a non-negative float,
+// which sort like the float itself
+///////////////////////////////////////////////////////////////////////////////
+std::uint64_t makeRenderKey(RenderPass pass, unsigned int program, GLuint texture, GLuint vao, float viewDepth)
+{
+    if (!(viewDepth > 0.0f))
+        viewDepth = 0.0f;       // also NaN
+    std::uint32_t depthBits;
+    std::memcpy(&depthBits, &viewDepth, sizeof(depthBits));
+    if (pass == RENDER_PASS_TRANSPARENT)
+        depthBits = ~depthBits;
+
+    return ((std::uint64_t)(pass & 0x3) << 62) |
+        ((std::uint64_t)(program & 0x3f) << 56) |
+        ((std::uint64_t)(texture & 0xfff) << 44) |
+        ((std::uint64_t)(vao & 0xfff) << 32) |
+        depthBits;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor/dtor
+///////////////////////////////////////////////////////////////////////////////
+RenderQueue::RenderQueue() : instanceBuffer(0), instanceBufferSize(0), commandBuffer(0), commandBufferSize(0),
+    instanceIndexBuffer(0), instanceIndexCount(0)
+{
+    std::memset(&stats, 0, sizeof(stats));
+}
+
+RenderQueue::~RenderQueue()
+{
+    release();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// keep the capacity for the next frame
+///////////////////////////////////////////////////////////////////////////////
+void RenderQueue::clear()
+{
+    packets.clear();
+    entries.clear();
+    rangeCounts.clear();
+    rangeOffsets.clear();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// add a packet
+///////////////////////////////////////////////////////////////////////////////
+void RenderQueue::submit(std::uint64_t key, const RenderPacket& packet)
+{
+    SortEntry entry = { key, (unsigned int)packets.size() };
+    entries.push_back(entry);
+    packets.push_back(packet);
+    packets.back().firstRange = 0;
+    packets.back().rangeCount = 0;
+}
+
+void RenderQueue::submitRanges(std::uint64_t key, const RenderPacket& packet, const GLsizei* counts,
+    const void* const* offsets, unsigned int rangeCount)
+{
+    if (rangeCount == 0)
+        return;
+
+    submit(key, packet);
+    packets.back().firstRange = (unsigned int)rangeCounts.size();
+    packets.back().rangeCount = rangeCount;
+    rangeCounts.insert(rangeCounts.end(), counts, counts + rangeCount);
+    rangeOffsets.insert(rangeOffsets.end(), offsets, offsets + rangeCount);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// LSD radix sort, 8 bits per pass; a pass is skipped when all keys have the
+// same byte there, which is common for the upper fields of small scenes
+///////////////////////////////////////////////////////////////////////////////
+void RenderQueue::sort()
+{
+    std::size_t count = entries.size();
+    if (count < 2)
+        return;
+
+    sortBuffer.resize(count);
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        std::size_t offsets[256] = {};
+        for (std::size_t i = 0; i < count; ++i)
+            ++offsets[(entries[i].key >> shift) & 0xff];
+        if (offsets[(entries[0].key >> shift) & 0xff] == count)
+            continue;   // one bucket only
+
+        std::size_t sum = 0;
+        for (int b = 0; b < 256; ++b)
+        {
+            std::size_t bucketSize = offsets[b];
+            offsets[b] = sum;
+            sum += bucketSize;
+        }
+        for (std::size_t i = 0; i < count; ++i)
+            sortBuffer[offsets[(entries[i].key >> shift) & 0xff]++] = entries[i];
+        entries.swap(sortBuffer);
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// the attribute keeps pointing at the identity buffer when it grows, since
+// the buffer object stays the same
+///////////////////////////////////////////////////////////////////////////////
+void RenderQueue::attachInstanceIndices(GLuint vao)
+{
+    reserveInstanceIndices(1);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceIndexBuffer);
+    glVertexAttribIPointer(RENDER_INSTANCE_ATTRIBUTE, 1, GL_UNSIGNED_INT, sizeof(GLuint), 0);
+    glVertexAttribDivisor(RENDER_INSTANCE_ATTRIBUTE, 1);
+    glEnableVertexAttribArray(RENDER_INSTANCE_ATTRIBUTE);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// grow the identity buffer to at least count indices, doubling
+///////////////////////////////////////////////////////////////////////////////
+void RenderQueue::reserveInstanceIndices(unsigned int count)
+{
+    if (instanceIndexBuffer && count <= instanceIndexCount)
+        return;
+
+    if (!instanceIndexBuffer)
+        glGenBuffers(1, &instanceIndexBuffer);
+    instanceIndexCount = std::max(std::max(count, instanceIndexCount * 2), 256u);
+
+    std::vector<GLuint> indices(instanceIndexCount);
+    for (unsigned int i = 0; i < instanceIndexCount; ++i)
+        indices[i] = i;
+    glBindBuffer(GL_ARRAY_BUFFER, instanceIndexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, instanceIndexCount * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// packets whose commands can go into one multi draw: everything the draw
+// call binds or takes as a parameter is the same
+///////////////////////////////////////////////////////////////////////////////
+bool RenderQueue::canBatch(const RenderPacket& a, const RenderPacket& b) const
+{
+    for (unsigned int unit = 0; unit < RENDER_TEXTURE_UNITS; ++unit)
+    {
+        if (a.textures[unit] != b.textures[unit])
+            return false;
+    }
+    return a.vao == b.vao && a.primitiveType == b.primitiveType && a.indexType == b.indexType;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// one instance per packet, in sorted order, so the instance index of a packet
+// is its sorted position
+///////////////////////////////////////////////////////////////////////////////
+void RenderQueue::uploadInstances()
+{
+    instances.resize(entries.size());
+    for (std::size_t i = 0; i < entries.size(); ++i)
+    {
+        const RenderPacket& packet = packets[entries[i].packet];
+        RenderInstance& instance = instances[i];
+        instance.model = packet.model;
+        instance.material = packet.material;
+        instance.padding[0] = instance.padding[1] = instance.padding[2] = 0;
+    }
+
+    if (!instanceBuffer)
+    {
+        glGenBuffers(1, &instanceBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, RENDER_INSTANCE_BINDING, instanceBuffer);
+    }
+    uploadStreamBuffer(GL_SHADER_STORAGE_BUFFER, instanceBuffer, instanceBufferSize, instances.data(),
+        (GLsizeiptr)(instances.size() * sizeof(RenderInstance)));
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// a packet that draws the same indices as the one before it adds an instance
+// to its command; ranges always get commands of their own
+///////////////////////////////////////////////////////////////////////////////
+void RenderQueue::buildCommands()
+{
+    commands.clear();
+    batches.clear();
+
+    bool instanceable = false;      // the last command is of a single draw
+    for (std::size_t i = 0; i < entries.size(); ++i)
+    {
+        const RenderPacket& packet = packets[entries[i].packet];
+        if (batches.empty() || !canBatch(packets[batches.back().packet], packet))
+        {
+            RenderBatch batch = { entries[i].packet, (unsigned int)commands.size(), 0 };
+            batches.push_back(batch);
+            instanceable = false;
+        }
+        RenderBatch& batch = batches.back();
+
+        if (packet.rangeCount > 0)
+        {
+            std::size_t indexSize = packet.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+            for (unsigned int r = packet.firstRange; r < packet.firstRange + packet.rangeCount; ++r)
+            {
+                RenderDrawCommand command = { (GLuint)rangeCounts[r], 1,
+                    packet.firstIndex + (GLuint)((std::size_t)rangeOffsets[r] / indexSize), packet.baseVertex, (GLuint)i };
+                commands.push_back(command);
+            }
+            batch.commandCount += packet.rangeCount;
+            instanceable = false;
+            continue;
+        }
+
+        if (instanceable)
+        {
+            RenderDrawCommand& last = commands.back();
+            if (last.count == (GLuint)packet.indexCount && last.firstIndex == packet.firstIndex &&
+                last.baseVertex == packet.baseVertex)
+            {
+                ++last.instanceCount;
+                continue;
+            }
+        }
+        RenderDrawCommand command = { (GLuint)packet.indexCount, 1, packet.firstIndex, packet.baseVertex, (GLuint)i };
+        commands.push_back(command);
+        ++batch.commandCount;
+        instanceable = true;
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// all commands of the frame in one upload
+///////////////////////////////////////////////////////////////////////////////
+void RenderQueue::uploadCommands()
+{
+    if (!commandBuffer)
+        glGenBuffers(1, &commandBuffer);
+    uploadStreamBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer, commandBufferSize, commands.data(),
+        (GLsizeiptr)(commands.size() * sizeof(RenderDrawCommand)));
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// the bound state is unknown at the start, so the first batch binds all of its
+// state; the VAO and the indirect buffer are unbound at the end
+///////////////////////////////////////////////////////////////////////////////
+void RenderQueue::execute()
+{
+    std::memset(&stats, 0, sizeof(stats));
+    if (entries.empty())
+        return;
+
+    reserveInstanceIndices((unsigned int)entries.size());
+    uploadInstances();
+    buildCommands();
+    uploadCommands();
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    bool first = true;
+    GLuint vao = 0;
+    GLuint textures[RENDER_TEXTURE_UNITS] = {};
+    int activeUnit = -1;
+    for (std::size_t i = 0; i < batches.size(); ++i)
+    {
+        const RenderBatch& batch = batches[i];
+        const RenderPacket& packet = packets[batch.packet];
+
+        if (first || packet.vao != vao)
+        {
+            vao = packet.vao;
+            glBindVertexArray(vao);
+            ++stats.vaoBinds;
+        }
+        for (unsigned int unit = 0; unit < RENDER_TEXTURE_UNITS; ++unit)
+        {
+            if (packet.textures[unit] == 0 || packet.textures[unit] == textures[unit])
+                continue;   // unused by this draw, or already bound
+
+            if (activeUnit != (int)unit)
+            {
+                glActiveTexture(GL_TEXTURE0 + unit);
+                activeUnit = (int)unit;
+            }
+            textures[unit] = packet.textures[unit];
+            glBindTexture(GL_TEXTURE_2D, textures[unit]);
+            ++stats.textureBinds;
+        }
+        first = false;
+
+        glMultiDrawElementsIndirect(packet.primitiveType, packet.indexType,
+            (const void*)(batch.firstCommand * sizeof(RenderDrawCommand)), (GLsizei)batch.commandCount, 0);
+        ++stats.draws;
+    }
+    stats.instances = (unsigned int)entries.size();
+    stats.commands = (unsigned int)commands.size();
+    for (std::size_t i = 0; i < commands.size(); ++i)
+    {
+        if (commands[i].instanceCount > 1)
+            ++stats.instancedCommands;
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// delete the buffers
+///////////////////////////////////////////////////////////////////////////////
+void RenderQueue::release()
+{
+    if (instanceBuffer)
+        glDeleteBuffers(1, &instanceBuffer);
+    if (commandBuffer)
+        glDeleteBuffers(1, &commandBuffer);
+    if (instanceIndexBuffer)
+        glDeleteBuffers(1, &instanceIndexBuffer);
+    instanceBuffer = commandBuffer = instanceIndexBuffer = 0;
+    instanceBufferSize = commandBufferSize = 0;
+    instanceIndexCount = 0;
+}
@@ -0,0 +1,169 @@
+#pragma once
+// Render queue: draws are submitted as packets with a 64-bit sort key, sorted
+// once per frame with a radix sort and executed in key order, binding only
+// the state that differs from the previous batch
+// key, most significant bits first:
+//   pass 2 | program 6 | texture 12 | VAO 12 | depth 32
+// so draws are grouped by pass, program, texture and VAO, and the draws
+// sharing all of those go front to back (opaque) for early-Z, or back to front
+// (transparent); GL names are keyed by their low bits, which only groups them,
+// the state itself is compared in full
+// the model matrix and material of every packet go to an instance buffer
+// (shader storage, one upload per frame), and every packet becomes a command
+// of an indirect draw buffer (also one upload per frame): consecutive packets
+// drawing the same index range are one instanced command, and the commands of
+// consecutive packets with the same VAO, textures and primitive type are one
+// glMultiDrawElementsIndirect(); with all meshes in one GeometryBuffer, the
+// number of GL draw calls grows with the textures only
+// the vertex shader finds the instance of a vertex through an instanced
+// integer attribute reading an identity buffer: with a divisor of 1 it is
+// fetched at baseInstance + gl_InstanceID, which is the instance index
+// (gl_DrawID and gl_BaseInstance need GLSL 4.60 or ARB_shader_draw_parameters)
+
+#ifndef GEOMETRY_RENDER_QUEUE_H
+#define GEOMETRY_RENDER_QUEUE_H
+
+#include <cstdint>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+const unsigned int RENDER_TEXTURE_UNITS = 2;
+const GLuint RENDER_INSTANCE_BINDING = 0;   // shader storage binding of the instance buffer
+const GLuint RENDER_INSTANCE_ATTRIBUTE = 4; // vertex attribute of the instance index, see attachInstanceIndices()
+
+enum RenderPass
+{
+    RENDER_PASS_OPAQUE = 0,     // front to back
+    RENDER_PASS_TRANSPARENT     // back to front, after the opaque pass
+};
+
+// viewDepth: distance along the view direction, e.g. of the bounding sphere centre
+std::uint64_t makeRenderKey(RenderPass pass, unsigned int program, GLuint texture, GLuint vao, float viewDepth);
+
+// one element of the instance buffer, std430 layout; the vertex shader reads
+// element instanceIndex of
+//   layout(std430, binding = 0) readonly buffer InstanceData { Instance instances[]; };
+// with struct Instance { mat4 model; uint material; };
+// and layout(location = 4) in uint instanceIndex;
+struct RenderInstance
+{
+    glm::mat4 model;
+    GLuint material;
+    GLuint padding[3];      // std430 rounds the struct to the mat4 alignment
+};
+static_assert(sizeof(RenderInstance) == 80, "RenderInstance must match the std430 Instance struct");
+
+// command of glMultiDrawElementsIndirect(), as laid out in the indirect buffer
+struct RenderDrawCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;                    // first instance index
+};
+static_assert(sizeof(RenderDrawCommand) == 20, "RenderDrawCommand must match DrawElementsIndirectCommand");
+
+// everything needed to issue one draw; VAO and textures are bound by the
+// queue, the model matrix and material index go to the instance buffer
+struct RenderPacket
+{
+    GLuint vao;                             // with attachInstanceIndices() called on it
+    GLuint textures[RENDER_TEXTURE_UNITS];  // 0: the unit is not used
+    unsigned int material;
+    glm::mat4 model;
+    GLenum primitiveType;                   // GL_TRIANGLES, GL_TRIANGLE_STRIP, ...
+    GLenum indexType;
+    GLsizei indexCount;                     // single draw
+    GLuint firstIndex;                      // of the mesh in the index buffer
+    GLint baseVertex;                       // of the mesh in the vertex buffer
+    unsigned int firstRange;                // index ranges of a multi draw, set by submitRanges()
+    unsigned int rangeCount;                // 0 for a single draw
+};
+
+// work of the last execute()
+struct RenderQueueStats
+{
+    unsigned int instances;     // packets drawn
+    unsigned int commands;      // indirect draw commands
+    unsigned int instancedCommands;     // commands drawing more than one packet
+    unsigned int draws;         // GL draw calls
+    unsigned int vaoBinds;
+    unsigned int textureBinds;
+};
+
+class RenderQueue
+{
+public:
+    // ctor/dtor
+    RenderQueue();
+    ~RenderQueue();
+
+    void clear();                           // once per frame, before the submits
+
+    // one command with the count and first index of the packet, merged into
+    // an instanced one with the packets next to it if they draw the same
+    void submit(std::uint64_t key, const RenderPacket& packet);
+    // one command per index range, copied into the queue, e.g. the visible
+    // meshlets from cullMeshlets(); offsets are bytes from the first index of
+    // the packet
+    void submitRanges(std::uint64_t key, const RenderPacket& packet, const GLsizei* counts,
+        const void* const* offsets, unsigned int rangeCount);
+
+    void sort();                            // by key, stable
+
+    // feed the instance index attribute of a VAO from the identity buffer of
+    // the queue; once per VAO, before its first packet is executed
+    void attachInstanceIndices(GLuint vao);
+
+    // upload the instances and the commands in sorted order and draw them
+    void execute();
+    void release();                         // delete the buffers
+
+    std::size_t getPacketCount() const { return packets.size(); }
+    const RenderQueueStats& getStats() const { return stats; }
+
+private:
+    // buffers are not shared between objects
+    RenderQueue(const RenderQueue&) = delete;
+    RenderQueue& operator=(const RenderQueue&) = delete;
+
+    struct SortEntry
+    {
+        std::uint64_t key;
+        unsigned int packet;
+    };
+
+    // consecutive commands of one glMultiDrawElementsIndirect()
+    struct RenderBatch
+    {
+        unsigned int packet;                // state of the batch
+        unsigned int firstCommand;
+        unsigned int commandCount;
+    };
+
+    bool canBatch(const RenderPacket& a, const RenderPacket& b) const;
+    void buildCommands();
+    void uploadInstances();
+    void uploadCommands();
+    void reserveInstanceIndices(unsigned int count);
+
+    std::vector<RenderPacket> packets;      // in submit order
+    std::vector<SortEntry> entries;         // keys, sorted by sort()
+    std::vector<SortEntry> sortBuffer;      // other buffer of the radix sort
+    std::vector<GLsizei> rangeCounts;       // index ranges of multi draws
+    std::vector<const void*> rangeOffsets;
+    std::vector<RenderInstance> instances;  // in sorted order
+    std::vector<RenderDrawCommand> commands;
+    std::vector<RenderBatch> batches;
+    GLuint instanceBuffer;
+    GLsizeiptr instanceBufferSize;          // bytes allocated
+    GLuint commandBuffer;
+    GLsizeiptr commandBufferSize;
+    GLuint instanceIndexBuffer;             // 0, 1, 2, ...
+    unsigned int instanceIndexCount;
+    RenderQueueStats stats;
+};
+
+#endif
@@ -0,0 +1,237 @@
+// Linked GLSL program with its active uniforms reflected once after linking
+
+#include <iostream>
+#include "ShaderProgram.h"
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// bytes of one value of a uniform type, 0 if set() does not handle it
+///////////////////////////////////////////////////////////////////////////////
+static unsigned int getUniformValueSize(GLenum type)
+{
+    switch (type)
+    {
+    case GL_INT:
+    case GL_BOOL:
+    case GL_SAMPLER_1D:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_3D:
+    case GL_SAMPLER_CUBE:
+    case GL_SAMPLER_2D_SHADOW:
+    case GL_SAMPLER_2D_ARRAY:
+    case GL_SAMPLER_BUFFER:
+    case GL_FLOAT:          return 4;
+    case GL_FLOAT_VEC2:     return 8;
+    case GL_FLOAT_VEC3:     return 12;
+    case GL_FLOAT_VEC4:     return 16;
+    case GL_FLOAT_MAT3:     return 36;
+    case GL_FLOAT_MAT4:     return 64;
+    default:                return 0;
+    }
+}
+
+// set with glProgramUniform1i
+static bool isIntUniform(GLenum type)
+{
+    return type != GL_FLOAT && type != GL_FLOAT_VEC2 && type != GL_FLOAT_VEC3 && type != GL_FLOAT_VEC4 &&
+        type != GL_FLOAT_MAT3 && type != GL_FLOAT_MAT4;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// compile one stage, printing the log if it fails; 0 if failed
+///////////////////////////////////////////////////////////////////////////////
+static GLuint compileShader(GLenum stage, const char* source, const char* stageName)
+{
+    GLuint shaderId = glCreateShader(stage);
+    glShaderSource(shaderId, 1, &source, NULL);
+    glCompileShader(shaderId);
+
+    GLint success = 0;
+    glGetShaderiv(shaderId, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        char infoLog[512];
+        glGetShaderInfoLog(shaderId, sizeof(infoLog), NULL, infoLog);
+        std::cout << "ERROR::SHADER::" << stageName << "::COMPILATION_FAILED\n" << infoLog << std::endl;
+        glDeleteShader(shaderId);
+        return 0;
+    }
+    return shaderId;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor/dtor
+///////////////////////////////////////////////////////////////////////////////
+ShaderProgram::ShaderProgram() : id(0), writeCount(0), skipCount(0)
+{
+}
+
+ShaderProgram::~ShaderProgram()
+{
+    release();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// build the program; the shader objects are only needed until it is linked
+///////////////////////////////////////////////////////////////////////////////
+bool ShaderProgram::create(const char* vertexSource, const char* fragmentSource)
+{
+    release();
+
+    GLuint vertexShaderId = compileShader(GL_VERTEX_SHADER, vertexSource, "VERTEX");
+    GLuint fragmentShaderId = compileShader(GL_FRAGMENT_SHADER, fragmentSource, "FRAGMENT");
+    if (!vertexShaderId || !fragmentShaderId)
+    {
+        glDeleteShader(vertexShaderId);
+        glDeleteShader(fragmentShaderId);
+        return false;
+    }
+
+    id = glCreateProgram();
+    glAttachShader(id, vertexShaderId);
+    glAttachShader(id, fragmentShaderId);
+    glLinkProgram(id);
+    glDetachShader(id, vertexShaderId);
+    glDetachShader(id, fragmentShaderId);
+    glDeleteShader(vertexShaderId);
+    glDeleteShader(fragmentShaderId);
+
+    GLint success = 0;
+    glGetProgramiv(id, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        char infoLog[512];
+        glGetProgramInfoLog(id, sizeof(infoLog), NULL, infoLog);
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        release();
+        return false;
+    }
+
+    reflectUniforms();
+    return true;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// delete the program object
+///////////////////////////////////////////////////////////////////////////////
+void ShaderProgram::release()
+{
+    if (id)
+        glDeleteProgram(id);
+    id = 0;
+    uniforms.clear();
+    values.clear();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// list the active uniforms outside uniform blocks with the program interface
+// query, and read their values after linking into the shadow copies
+///////////////////////////////////////////////////////////////////////////////
+void ShaderProgram::reflectUniforms()
+{
+    GLint count = 0, maxNameLength = 0;
+    glGetProgramInterfaceiv(id, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+    glGetProgramInterfaceiv(id, GL_UNIFORM, GL_MAX_NAME_LENGTH, &maxNameLength);
+
+    std::vector<char> name(maxNameLength + 1);
+    const GLenum props[] = { GL_BLOCK_INDEX, GL_TYPE, GL_LOCATION };
+    for (GLint i = 0; i < count; ++i)
+    {
+        GLint params[3];
+        glGetProgramResourceiv(id, GL_UNIFORM, i, 3, props, 3, NULL, params);
+        if (params[0] != -1 || params[2] < 0)
+            continue;   // member of a uniform block
+
+        glGetProgramResourceName(id, GL_UNIFORM, i, (GLsizei)name.size(), NULL, name.data());
+        Uniform uniform;
+        uniform.name = name.data();
+        if (uniform.name.size() > 3 && uniform.name.compare(uniform.name.size() - 3, 3, "[0]") == 0)
+            uniform.name.resize(uniform.name.size() - 3);
+        uniform.location = params[2];
+        uniform.type = (GLenum)params[1];
+        uniform.valueOffset = (unsigned int)values.size();
+        uniform.valueSize = getUniformValueSize(uniform.type);
+
+        values.resize(values.size() + uniform.valueSize);
+        if (uniform.valueSize > 0 && isIntUniform(uniform.type))
+            glGetUniformiv(id, uniform.location, (GLint*)&values[uniform.valueOffset]);
+        else if (uniform.valueSize > 0)
+            glGetUniformfv(id, uniform.location, (GLfloat*)&values[uniform.valueOffset]);
+        uniforms.push_back(uniform);
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// index of an active uniform, -1 if there is none or its type does not match
+///////////////////////////////////////////////////////////////////////////////
+int ShaderProgram::findUniform(const char* name, GLenum type) const
+{
+    for (std::size_t i = 0; i < uniforms.size(); ++i)
+    {
+        const Uniform& uniform = uniforms[i];
+        if (uniform.name != name)
+            continue;
+
+        bool match = uniform.valueSize > 0 &&
+            (uniform.type == type || (type == GL_INT && isIntUniform(uniform.type)));
+        if (!match)
+        {
+            std::cout << "WARNING: uniform " << name << " has GL type 0x" << std::hex << uniform.type
+                << std::dec << ", not the type of its handle" << std::endl;
+            return -1;
+        }
+        return (int)i;
+    }
+    return -1;      // not active
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// size of a uniform block from the program interface query
+///////////////////////////////////////////////////////////////////////////////
+GLint ShaderProgram::getUniformBlockSize(const char* name) const
+{
+    GLuint blockIndex = glGetProgramResourceIndex(id, GL_UNIFORM_BLOCK, name);
+    if (blockIndex == GL_INVALID_INDEX)
+        return -1;
+
+    const GLenum prop = GL_BUFFER_DATA_SIZE;
+    GLint size = -1;
+    glGetProgramResourceiv(id, GL_UNIFORM_BLOCK, blockIndex, 1, &prop, 1, NULL, &size);
+    return size;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// the GL call for the type of the uniform
+///////////////////////////////////////////////////////////////////////////////
+void ShaderProgram::writeUniform(const Uniform& uniform, const void* value)
+{
+    const GLfloat* floats = (const GLfloat*)value;
+    switch (uniform.type)
+    {
+    case GL_FLOAT:      glProgramUniform1fv(id, uniform.location, 1, floats); break;
+    case GL_FLOAT_VEC2: glProgramUniform2fv(id, uniform.location, 1, floats); break;
+    case GL_FLOAT_VEC3: glProgramUniform3fv(id, uniform.location, 1, floats); break;
+    case GL_FLOAT_VEC4: glProgramUniform4fv(id, uniform.location, 1, floats); break;
+    case GL_FLOAT_MAT3: glProgramUniformMatrix3fv(id, uniform.location, 1, GL_FALSE, floats); break;
+    case GL_FLOAT_MAT4: glProgramUniformMatrix4fv(id, uniform.location, 1, GL_FALSE, floats); break;
+    default:            glProgramUniform1iv(id, uniform.location, 1, (const GLint*)value); break;
+    }
+    ++writeCount;
+}
@@ -0,0 +1,127 @@
+#pragma once
+// Linked GLSL program with its active uniforms reflected once after linking
+// the uniforms are looked up by name once, into typed handles; set() keeps a
+// CPU copy of every value and skips the GL call when the value is unchanged
+// owns the program object and deletes it on destruction; the GL context must
+// be current for both
+
+#ifndef GEOMETRY_SHADER_PROGRAM_H
+#define GEOMETRY_SHADER_PROGRAM_H
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// handle of an active uniform of type T, from ShaderProgram::getUniform()
+// invalid (index -1) if the uniform is not active; setting it does nothing,
+// like location -1 in glUniform*()
+template<class T>
+struct UniformHandle
+{
+    int index;
+
+    UniformHandle() : index(-1) {}
+    bool isValid() const { return index >= 0; }
+};
+
+class ShaderProgram
+{
+public:
+    // ctor/dtor
+    ShaderProgram();
+    ~ShaderProgram();
+
+    // compile and link, then reflect the active uniforms
+    // returns false and prints the log if a stage fails
+    bool create(const char* vertexSource, const char* fragmentSource);
+    void release();
+
+    void use() const { glUseProgram(id); }
+    GLuint getId() const { return id; }
+
+    // handle of the active uniform with this name, resolved once
+    // T: int (int, bool and sampler uniforms), float, glm::vec2, glm::vec3,
+    // glm::vec4, glm::mat3 or glm::mat4; a type that does not match the
+    // shader gives an invalid handle and a warning
+    template<class T>
+    UniformHandle<T> getUniform(const char* name) const;
+
+    // write the value unless it is the one the program already has
+    // glProgramUniform*() is used, so the program needs not be bound
+    template<class T>
+    void set(UniformHandle<T> handle, const T& value);
+
+    // bytes of a uniform block as the program lays it out, -1 if not active;
+    // compare with the size of the C++ struct written to its UniformBuffer
+    GLint getUniformBlockSize(const char* name) const;
+
+    unsigned int getUniformCount() const { return (unsigned int)uniforms.size(); }
+    unsigned int getUniformWriteCount() const { return writeCount; }    // GL calls made by set()
+    unsigned int getUniformSkipCount() const { return skipCount; }      // set() calls with an unchanged value
+
+private:
+    // programs are not shared between objects
+    ShaderProgram(const ShaderProgram&) = delete;
+    ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+    struct Uniform
+    {
+        std::string name;           // without "[0]" for arrays
+        GLint location;
+        GLenum type;                // GL_FLOAT_VEC3, GL_SAMPLER_2D, ...
+        unsigned int valueOffset;   // in values, in bytes
+        unsigned int valueSize;     // first element only, in bytes
+    };
+
+    void reflectUniforms();
+    int findUniform(const char* name, GLenum type) const;
+    void writeUniform(const Uniform& uniform, const void* value);
+
+    GLuint id;
+    std::vector<Uniform> uniforms;
+    std::vector<unsigned char> values;      // shadowed values of the uniforms, as GL has them
+    unsigned int writeCount;
+    unsigned int skipCount;
+};
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// GL type of each handle type; int handles also take bools and samplers
+///////////////////////////////////////////////////////////////////////////////
+template<class T> struct UniformTypeOf;
+template<> struct UniformTypeOf<int> { static const GLenum type = GL_INT; };
+template<> struct UniformTypeOf<float> { static const GLenum type = GL_FLOAT; };
+template<> struct UniformTypeOf<glm::vec2> { static const GLenum type = GL_FLOAT_VEC2; };
+template<> struct UniformTypeOf<glm::vec3> { static const GLenum type = GL_FLOAT_VEC3; };
+template<> struct UniformTypeOf<glm::vec4> { static const GLenum type = GL_FLOAT_VEC4; };
+template<> struct UniformTypeOf<glm::mat3> { static const GLenum type = GL_FLOAT_MAT3; };
+template<> struct UniformTypeOf<glm::mat4> { static const GLenum type = GL_FLOAT_MAT4; };
+
+template<class T>
+UniformHandle<T> ShaderProgram::getUniform(const char* name) const
+{
+    UniformHandle<T> handle;
+    handle.index = findUniform(name, UniformTypeOf<T>::type);
+    return handle;
+}
+
+template<class T>
+void ShaderProgram::set(UniformHandle<T> handle, const T& value)
+{
+    if (!handle.isValid())
+        return;
+
+    Uniform& uniform = uniforms[handle.index];
+    if (std::memcmp(&values[uniform.valueOffset], &value, sizeof(T)) == 0)
+    {
+        ++skipCount;
+        return;
+    }
+    std::memcpy(&values[uniform.valueOffset], &value, sizeof(T));
+    writeUniform(uniform, &value);
+}
+
+#endif
@@ -0,0 +1,228 @@
+#pragma once
+// Immutable generated geometry plus its GPU buffers
+// built once with MeshBuildOptions and shared through MeshCache, or uploaded
+// straight from a mesh file written by an earlier build
+// the GPU data is either in buffers of its own or in a range of a shared
+// GeometryBuffer; draws then add getFirstIndex() and getBaseVertex()
+// coarse LOD levels may also come from simplifyMesh() instead of a shape
+
+#ifndef GEOMETRY_SHARED_MESH_H
+#define GEOMETRY_SHARED_MESH_H
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Bounds.h"
+#include "GeometryBuffer.h"
+#include "GeometryStorage.h"
+#include "GpuMesh.h"
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+#include "Meshlet.h"
+#include "MeshSimplifier.h"
+
+// how the cache builds and uploads its meshes
+struct MeshBuildOptions
+{
+    VertexFormat vertexFormat = VERTEX_FORMAT_FLOAT;
+    bool optimize = false;                  // reorder for vertex cache/overdraw/fetch before upload
+    bool strips = false;                    // upload triangle strips with primitive restart if the shape has them
+    std::string cacheDirectory;             // where MeshCache keeps mesh files, empty = none
+    GeometryStorage storage = GEOMETRY_STORAGE_ALL;     // CPU copies kept once uploaded (and saved)
+    bool meshlets = false;                  // split meshes of more than one meshlet for culling on the CPU; no strips then
+    std::shared_ptr<GeometryBuffer> geometryBuffer;     // upload into ranges of it, null = buffers per mesh
+    bool simplifyLods = false;              // bake coarser smooth LOD levels from the finest mesh, see MeshCache
+};
+
+
+
+// immutable geometry plus its GPU buffers
+template<class Shape>
+class SharedMesh
+{
+public:
+    // build the shape with the given ctor params, optimize it if asked, and upload it
+    template<class... Args>
+    explicit SharedMesh(const MeshBuildOptions& options, Args&&... args) : shape(new Shape(std::forward<Args>(args)...)),
+        optimized(options.optimize), optimizationReport(), vertexFormat(options.vertexFormat), geometryRange()
+    {
+        if (optimized)
+            optimizationReport = shape->optimize();
+        if (options.meshlets && shape->getTriangleCount() > MESHLET_MAX_TRIANGLES)
+        {
+            shape->buildMeshlets();
+            meshlets = shape->getMeshlets();
+        }
+        boundingRadius = shape->getBoundingRadius();
+        computeBounds(shape->getInterleavedVertices(), shape->getInterleavedStride() / sizeof(float),
+            shape->getInterleavedVertexCount(), boundingBox, boundingSphere);
+
+        // flat shaded shapes have no strips; meshlets are ranges of the triangle list
+        const void* indices = shape->getIndices();
+        unsigned int indexCount = shape->getIndexCount();
+        primitiveType = GL_TRIANGLES;
+        if (options.strips && meshlets.empty() && shape->getStripIndexCount() > 0)
+        {
+            indices = shape->getStripIndices();
+            indexCount = shape->getStripIndexCount();
+            primitiveType = GL_TRIANGLE_STRIP;
+        }
+
+        if (options.geometryBuffer && options.geometryBuffer->getVertexFormat() == vertexFormat &&
+            options.geometryBuffer->append(shape->getInterleavedVertices(), shape->getInterleavedVertexCount(),
+                indices, indexCount, shape->getIndexType(), geometryRange))
+        {
+            geometryBuffer = options.geometryBuffer;
+        }
+        else
+        {
+            gpuMesh.upload(shape->getInterleavedVertices(), shape->getInterleavedVertexCount(),
+                indices, indexCount, shape->getIndexType(), vertexFormat);
+        }
+    }
+
+    // upload from a mapped mesh file; there is no shape on the CPU then
+    // geometryBuffer: upload into a range of it if not null
+    SharedMesh(const MeshFile& file, const std::shared_ptr<GeometryBuffer>& geometryBuffer) :
+        optimized(file.getHeader().optimized != 0), optimizationReport(file.getHeader().optimizationReport),
+        vertexFormat(file.getVertexFormat()), boundingRadius(file.getHeader().boundingRadius),
+        boundingBox(file.getHeader().boundingBox), boundingSphere(file.getHeader().boundingSphere),
+        primitiveType(file.getHeader().primitiveType), geometryRange()
+    {
+        const MeshFileHeader& header = file.getHeader();
+        if (geometryBuffer && geometryBuffer->appendFormatted(file.getVertexData(), vertexFormat, header.vertexCount,
+            file.getIndices(), header.indexCount, header.indexType, geometryRange))
+        {
+            this->geometryBuffer = geometryBuffer;
+        }
+        else
+        {
+            gpuMesh.uploadFormatted(file.getVertexData(), header.vertexCount, file.getIndices(),
+                header.indexCount, header.indexType, vertexFormat);
+        }
+        meshlets.assign(file.getMeshlets(), file.getMeshlets() + header.meshletCount);
+    }
+
+    // upload a simplified mesh; there is no shape on the CPU then, and no strips
+    // boundingRadius: of the mesh it was simplified from, so all levels agree
+    SharedMesh(const SimplifiedMesh& mesh, float boundingRadius, const MeshBuildOptions& options) :
+        optimized(options.optimize), optimizationReport(), vertexFormat(options.vertexFormat),
+        boundingRadius(boundingRadius), primitiveType(GL_TRIANGLES), geometryRange()
+    {
+        std::vector<float> vertices(mesh.interleavedVertices);
+        std::vector<unsigned int> indices(mesh.indices);
+        unsigned int vertexCount = (unsigned int)(vertices.size() / SIMPLIFIER_VERTEX_FLOATS);
+        if (optimized)
+        {
+            optimizationReport.before = analyzeVertexCache(indices.data(), indices.size(), vertexCount);
+            optimizeTriangleOrder(indices.data(), indices.size(), vertices.data(), SIMPLIFIER_VERTEX_FLOATS, vertexCount);
+            remapVertexAttribute(vertices, SIMPLIFIER_VERTEX_FLOATS, optimizeVertexFetch(indices.data(), indices.size(), vertexCount));
+            optimizationReport.after = analyzeVertexCache(indices.data(), indices.size(), vertexCount);
+        }
+        if (options.meshlets && indices.size() / 3 > MESHLET_MAX_TRIANGLES)
+            meshlets = ::buildMeshlets(indices.data(), indices.size(), vertices.data(), SIMPLIFIER_VERTEX_FLOATS, vertexCount);
+        computeBounds(vertices.data(), SIMPLIFIER_VERTEX_FLOATS, vertexCount, boundingBox, boundingSphere);
+
+        // 16-bit indices if the vertices fit, like the shapes
+        std::vector<unsigned short> shortIndices;
+        const void* indexData = indices.data();
+        GLenum indexType = GL_UNSIGNED_INT;
+        if (vertexCount <= 0xFFFF)
+        {
+            shortIndices.assign(indices.begin(), indices.end());
+            indexData = shortIndices.data();
+            indexType = GL_UNSIGNED_SHORT;
+        }
+
+        if (options.geometryBuffer && options.geometryBuffer->getVertexFormat() == vertexFormat &&
+            options.geometryBuffer->append(vertices.data(), vertexCount, indexData,
+                (unsigned int)indices.size(), indexType, geometryRange))
+        {
+            geometryBuffer = options.geometryBuffer;
+        }
+        else
+        {
+            gpuMesh.upload(vertices.data(), vertexCount, indexData, (unsigned int)indices.size(), indexType, vertexFormat);
+        }
+    }
+
+    // give the range of the shared buffer back
+    ~SharedMesh()
+    {
+        if (geometryBuffer)
+            geometryBuffer->remove(geometryRange);
+    }
+
+    // write what was uploaded to a mesh file; only for built meshes, not simplified ones
+    bool save(const std::string& path, unsigned long long paramHash) const
+    {
+        if (!shape)
+            return false;
+
+        MeshFileHeader header = {};
+        header.paramHash = paramHash;
+        header.vertexFormat = vertexFormat;
+        header.vertexCount = shape->getInterleavedVertexCount();
+        header.primitiveType = primitiveType;
+        header.indexType = shape->getIndexType();     // the buffer may have widened them
+        header.indexCount = primitiveType == GL_TRIANGLE_STRIP ? shape->getStripIndexCount() : shape->getIndexCount();
+        header.optimized = optimized ? 1 : 0;
+        header.optimizationReport = optimizationReport;
+        header.boundingRadius = boundingRadius;
+        header.boundingBox = boundingBox;
+        header.boundingSphere = boundingSphere;
+        header.meshletCount = (unsigned int)meshlets.size();
+
+        const void* indices = primitiveType == GL_TRIANGLE_STRIP ? shape->getStripIndices() : shape->getIndices();
+        if (vertexFormat == VERTEX_FORMAT_PACKED)
+        {
+            std::vector<PackedVertex> packedVertices(header.vertexCount);
+            packVertices(shape->getInterleavedVertices(), header.vertexCount, packedVertices.data());
+            return writeMeshFile(path, header, packedVertices.data(), indices, meshlets.data());
+        }
+        return writeMeshFile(path, header, shape->getInterleavedVertices(), indices, meshlets.data());
+    }
+
+    // drop the CPU copies the policy does not keep; GPU-only drops the shape,
+    // so call it after save()
+    void applyStorage(GeometryStorage storage)
+    {
+        if (!shape)
+            return;
+        if (storage == GEOMETRY_STORAGE_GPU_ONLY)
+            shape.reset();
+        else
+            shape->setStorage(storage);
+    }
+
+    const Shape* getShape() const { return shape.get(); }      // null if uploaded from a mesh file, simplified or GPU-only
+    bool isOptimized() const { return optimized; }
+    const MeshOptimizationReport& getOptimizationReport() const { return optimizationReport; }
+    float getBoundingRadius() const { return boundingRadius; }
+    const BoundingBox& getBoundingBox() const { return boundingBox; }
+    const BoundingSphere& getBoundingSphere() const { return boundingSphere; }  // model space, see DrawBoundsList
+    const std::vector<Meshlet>& getMeshlets() const { return meshlets; }    // empty if drawn whole, see cullMeshlets()
+    GLuint getVao() const { return geometryBuffer ? geometryBuffer->getVao() : gpuMesh.getVao(); }
+    GLenum getPrimitiveType() const { return primitiveType; }   // GL_TRIANGLES or GL_TRIANGLE_STRIP (needs GL_PRIMITIVE_RESTART_FIXED_INDEX)
+    GLsizei getIndexCount() const { return geometryBuffer ? (GLsizei)geometryRange.indexCount : gpuMesh.getIndexCount(); }
+    GLenum getIndexType() const { return geometryBuffer ? geometryBuffer->getIndexType() : gpuMesh.getIndexType(); }
+    GLuint getFirstIndex() const { return geometryRange.firstIndex; }           // 0 in buffers of its own
+    GLint getBaseVertex() const { return (GLint)geometryRange.firstVertex; }   // 0 in buffers of its own
+
+private:
+    std::unique_ptr<Shape> shape;           // not modified once shared
+    bool optimized;
+    MeshOptimizationReport optimizationReport;
+    VertexFormat vertexFormat;
+    float boundingRadius;                   // about the model origin
+    BoundingBox boundingBox;                // of the vertices, in model space
+    BoundingSphere boundingSphere;          // about the box centre
+    std::vector<Meshlet> meshlets;          // ranges of the index buffer, from the first index of the mesh
+    GLenum primitiveType;
+    GpuMesh gpuMesh;                        // unused in a shared buffer
+    std::shared_ptr<GeometryBuffer> geometryBuffer;
+    GeometryRange geometryRange;
+};
+
+#endif
@@ -0,0 +1,444 @@
+// Batched sine/cosine for parametric vertex generation
+// polynomials and range reduction from Cephes sinf/cosf (S. L. Moshier),
+// SIMD layout after Julien Pommier's sse_mathfun
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "SinCos.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SINCOS_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SINCOS_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define SINCOS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+
+
+// constants //////////////////////////////////////////////////////////////////
+namespace
+{
+    const float FOPI = 1.27323954473516f;               // 4 / PI
+    const float MINUS_DP1 = -0.78515625f;               // PI/4 split in 3 parts
+    const float MINUS_DP2 = -2.4187564849853515625e-4f;
+    const float MINUS_DP3 = -3.77489497744594108e-8f;
+    const float SINCOF_P0 = -1.9515295891e-4f;
+    const float SINCOF_P1 = 8.3321608736e-3f;
+    const float SINCOF_P2 = -1.6666654611e-1f;
+    const float COSCOF_P0 = 2.443315711809948e-5f;
+    const float COSCOF_P1 = -1.388731625493765e-3f;
+    const float COSCOF_P2 = 4.166664568298827e-2f;
+
+    typedef void (*SinCosKernel)(const float*, float*, float*, int);
+
+    // SinCosPath, -1 until the first call picks the best one; atomic since the
+    // first call may come from several ThreadPool workers at once
+    std::atomic<int> activePath(-1);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// scalar kernel
+// mirrors the SIMD kernels operation by operation (no fused multiply-add)
+///////////////////////////////////////////////////////////////////////////////
+static inline unsigned int floatBits(float f)
+{
+    unsigned int u;
+    std::memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static inline float bitsFloat(unsigned int u)
+{
+    float f;
+    std::memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+static void sinCosScalar(const float* angles, float* sines, float* cosines, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        // take the absolute value and keep the sign for sine
+        unsigned int bits = floatBits(angles[i]);
+        unsigned int signSin = bits & 0x80000000u;
+        float x = bitsFloat(bits & 0x7fffffffu);
+
+        // octant j = (int)(x * 4/PI), rounded up to even
+        int j = (int)(x * FOPI);
+        j = (j + 1) & ~1;
+        float y = (float)j;
+
+        unsigned int swapSignSin = (unsigned int)(j & 4) << 29;
+        bool polyMask = (j & 2) == 0;
+        unsigned int signCos = (unsigned int)(~(j - 2) & 4) << 29;
+        signSin ^= swapSignSin;
+
+        // extended precision modular arithmetic: x = ((x - y*DP1) - y*DP2) - y*DP3
+        x = x + y * MINUS_DP1;
+        x = x + y * MINUS_DP2;
+        x = x + y * MINUS_DP3;
+        float z = x * x;
+
+        // cosine polynomial (0 <= x <= PI/4)
+        float yc = COSCOF_P0;
+        yc = yc * z;
+        yc = yc + COSCOF_P1;
+        yc = yc * z;
+        yc = yc + COSCOF_P2;
+        yc = yc * z;
+        yc = yc * z;
+        yc = yc - z * 0.5f;
+        yc = yc + 1.0f;
+
+        // sine polynomial (0 <= x <= PI/4)
+        float ys = SINCOF_P0;
+        ys = ys * z;
+        ys = ys + SINCOF_P1;
+        ys = ys * z;
+        ys = ys + SINCOF_P2;
+        ys = ys * z;
+        ys = ys * x;
+        ys = ys + x;
+
+        float s = polyMask ? ys : yc;
+        float c = polyMask ? yc : ys;
+        sines[i] = bitsFloat(floatBits(s) ^ signSin);
+        cosines[i] = bitsFloat(floatBits(c) ^ signCos);
+    }
+}
+
+
+
+#ifdef SINCOS_X86
+///////////////////////////////////////////////////////////////////////////////
+// SSE2 kernel: 4 angles per iteration
+///////////////////////////////////////////////////////////////////////////////
+static void sinCosSse2(const float* angles, float* sines, float* cosines, int count)
+{
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i invOne = _mm_set1_epi32(~1);
+    const __m128i two = _mm_set1_epi32(2);
+    const __m128i four = _mm_set1_epi32(4);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(angles + i);
+        __m128 signSin = _mm_and_ps(x, signMask);
+        x = _mm_andnot_ps(signMask, x);
+
+        __m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(FOPI)));
+        j = _mm_and_si128(_mm_add_epi32(j, one), invOne);
+        __m128 y = _mm_cvtepi32_ps(j);
+
+        __m128 swapSignSin = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, four), 29));
+        __m128 polyMask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, two), _mm_setzero_si128()));
+        __m128 signCos = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(j, two), four), 29));
+        signSin = _mm_xor_ps(signSin, swapSignSin);
+
+        x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(MINUS_DP1)));
+        x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(MINUS_DP2)));
+        x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(MINUS_DP3)));
+        __m128 z = _mm_mul_ps(x, x);
+
+        __m128 yc = _mm_set1_ps(COSCOF_P0);
+        yc = _mm_mul_ps(yc, z);
+        yc = _mm_add_ps(yc, _mm_set1_ps(COSCOF_P1));
+        yc = _mm_mul_ps(yc, z);
+        yc = _mm_add_ps(yc, _mm_set1_ps(COSCOF_P2));
+        yc = _mm_mul_ps(yc, z);
+        yc = _mm_mul_ps(yc, z);
+        yc = _mm_sub_ps(yc, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+        yc = _mm_add_ps(yc, _mm_set1_ps(1.0f));
+
+        __m128 ys = _mm_set1_ps(SINCOF_P0);
+        ys = _mm_mul_ps(ys, z);
+        ys = _mm_add_ps(ys, _mm_set1_ps(SINCOF_P1));
+        ys = _mm_mul_ps(ys, z);
+        ys = _mm_add_ps(ys, _mm_set1_ps(SINCOF_P2));
+        ys = _mm_mul_ps(ys, z);
+        ys = _mm_mul_ps(ys, x);
+        ys = _mm_add_ps(ys, x);
+
+        __m128 s = _mm_or_ps(_mm_and_ps(polyMask, ys), _mm_andnot_ps(polyMask, yc));
+        __m128 c = _mm_or_ps(_mm_and_ps(polyMask, yc), _mm_andnot_ps(polyMask, ys));
+        _mm_storeu_ps(sines + i, _mm_xor_ps(s, signSin));
+        _mm_storeu_ps(cosines + i, _mm_xor_ps(c, signCos));
+    }
+
+    // remainder
+    sinCosScalar(angles + i, sines + i, cosines + i, count - i);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// AVX2 kernel: 8 angles per iteration
+///////////////////////////////////////////////////////////////////////////////
+SINCOS_TARGET_AVX2
+static void sinCosAvx2(const float* angles, float* sines, float* cosines, int count)
+{
+    const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32((int)0x80000000));
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i invOne = _mm256_set1_epi32(~1);
+    const __m256i two = _mm256_set1_epi32(2);
+    const __m256i four = _mm256_set1_epi32(4);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(angles + i);
+        __m256 signSin = _mm256_and_ps(x, signMask);
+        x = _mm256_andnot_ps(signMask, x);
+
+        __m256i j = _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(FOPI)));
+        j = _mm256_and_si256(_mm256_add_epi32(j, one), invOne);
+        __m256 y = _mm256_cvtepi32_ps(j);
+
+        __m256 swapSignSin = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(j, four), 29));
+        __m256 polyMask = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(j, two), _mm256_setzero_si256()));
+        __m256 signCos = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_andnot_si256(_mm256_sub_epi32(j, two), four), 29));
+        signSin = _mm256_xor_ps(signSin, swapSignSin);
+
+        x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(MINUS_DP1)));
+        x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(MINUS_DP2)));
+        x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(MINUS_DP3)));
+        __m256 z = _mm256_mul_ps(x, x);
+
+        __m256 yc = _mm256_set1_ps(COSCOF_P0);
+        yc = _mm256_mul_ps(yc, z);
+        yc = _mm256_add_ps(yc, _mm256_set1_ps(COSCOF_P1));
+        yc = _mm256_mul_ps(yc, z);
+        yc = _mm256_add_ps(yc, _mm256_set1_ps(COSCOF_P2));
+        yc = _mm256_mul_ps(yc, z);
+        yc = _mm256_mul_ps(yc, z);
+        yc = _mm256_sub_ps(yc, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+        yc = _mm256_add_ps(yc, _mm256_set1_ps(1.0f));
+
+        __m256 ys = _mm256_set1_ps(SINCOF_P0);
+        ys = _mm256_mul_ps(ys, z);
+        ys = _mm256_add_ps(ys, _mm256_set1_ps(SINCOF_P1));
+        ys = _mm256_mul_ps(ys, z);
+        ys = _mm256_add_ps(ys, _mm256_set1_ps(SINCOF_P2));
+        ys = _mm256_mul_ps(ys, z);
+        ys = _mm256_mul_ps(ys, x);
+        ys = _mm256_add_ps(ys, x);
+
+        __m256 s = _mm256_blendv_ps(yc, ys, polyMask);
+        __m256 c = _mm256_blendv_ps(ys, yc, polyMask);
+        _mm256_storeu_ps(sines + i, _mm256_xor_ps(s, signSin));
+        _mm256_storeu_ps(cosines + i, _mm256_xor_ps(c, signCos));
+    }
+
+    // remainder
+    sinCosScalar(angles + i, sines + i, cosines + i, count - i);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// CPU feature detection
+///////////////////////////////////////////////////////////////////////////////
+static void cpuid(int leaf, int subLeaf, unsigned int regs[4])
+{
+#ifdef _MSC_VER
+    int r[4];
+    __cpuidex(r, leaf, subLeaf);
+    for (int i = 0; i < 4; ++i)
+        regs[i] = (unsigned int)r[i];
+#else
+    __cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static unsigned long long xgetbv0()
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned int lo, hi;
+    __asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((unsigned long long)hi << 32) | lo;
+#endif
+}
+
+static bool isPathSupported(SinCosPath path)
+{
+    unsigned int regs[4];
+    cpuid(0, 0, regs);
+    unsigned int maxLeaf = regs[0];
+    if (maxLeaf < 1)
+        return path == SINCOS_PATH_SCALAR;
+
+    cpuid(1, 0, regs);
+    bool sse2 = (regs[3] & (1u << 26)) != 0;
+    bool osxsave = (regs[2] & (1u << 27)) != 0;
+    bool avx = (regs[2] & (1u << 28)) != 0;
+
+    switch (path)
+    {
+    case SINCOS_PATH_SSE2:
+        return sse2;
+    case SINCOS_PATH_AVX2:
+        // the OS must also save the YMM registers on context switch
+        if (maxLeaf < 7 || !osxsave || !avx || (xgetbv0() & 6) != 6)
+            return false;
+        cpuid(7, 0, regs);
+        return (regs[1] & (1u << 5)) != 0;
+    default:
+        return true;
+    }
+}
+#else
+static bool isPathSupported(SinCosPath path)
+{
+    return path == SINCOS_PATH_SCALAR;
+}
+#endif
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// runtime dispatch
+///////////////////////////////////////////////////////////////////////////////
+static SinCosKernel getKernel(SinCosPath path)
+{
+#ifdef SINCOS_X86
+    if (path == SINCOS_PATH_AVX2)
+        return sinCosAvx2;
+    if (path == SINCOS_PATH_SSE2)
+        return sinCosSse2;
+#endif
+    return sinCosScalar;
+}
+
+static SinCosPath selectBestPath()
+{
+    SinCosPath path = SINCOS_PATH_SCALAR;
+    if (isPathSupported(SINCOS_PATH_AVX2))
+        path = SINCOS_PATH_AVX2;
+    else if (isPathSupported(SINCOS_PATH_SSE2))
+        path = SINCOS_PATH_SSE2;
+    return path;
+}
+
+// the function-local static runs the detection exactly once, even when the
+// first calls come from several threads
+static SinCosPath getBestPath()
+{
+    static const SinCosPath bestPath = selectBestPath();
+    return bestPath;
+}
+
+SinCosPath getSinCosPath()
+{
+    int path = activePath.load(std::memory_order_relaxed);
+    if (path < 0)
+    {
+        // keep a path set by setSinCosPath() in the meantime
+        SinCosPath bestPath = getBestPath();
+        if (activePath.compare_exchange_strong(path, bestPath, std::memory_order_relaxed))
+            path = bestPath;
+    }
+    return (SinCosPath)path;
+}
+
+void setSinCosPath(SinCosPath path)
+{
+    getBestPath();
+    while (path != SINCOS_PATH_SCALAR && !isPathSupported(path))
+        path = (SinCosPath)(path - 1);
+
+    activePath.store(path, std::memory_order_relaxed);
+}
+
+const char* getSinCosPathName(SinCosPath path)
+{
+    switch (path)
+    {
+    case SINCOS_PATH_AVX2:
+        return "AVX2";
+    case SINCOS_PATH_SSE2:
+        return "SSE2";
+    default:
+        return "scalar";
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// batched sin/cos
+///////////////////////////////////////////////////////////////////////////////
+void computeSinCos(const float* angles, float* sines, float* cosines, int count)
+{
+    getKernel(getSinCosPath())(angles, sines, cosines, count);
+}
+
+void computeSinCosRing(float start, float step, int count, float* sines, float* cosines)
+{
+    // angle = start + i * step, the same float operations as the scalar loops
+    for (int i = 0; i < count; ++i)
+        cosines[i] = start + i * step;
+
+    computeSinCos(cosines, sines, cosines, count);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// compare a kernel with sinf/cosf on full sector and stack rings, from a few
+// segments (scalar remainders only) to many (mostly SIMD); the ring angles are
+// the ones computeSinCosRing() makes, so the same floats go to both
+///////////////////////////////////////////////////////////////////////////////
+bool checkSinCosPath(SinCosPath path, float* maxError)
+{
+    if (maxError)
+        *maxError = 0;
+    if (!isPathSupported(path))
+        return false;
+
+    const float PI = acos(-1);
+    const int SEGMENT_COUNTS[] = { 3, 18, 36, 100, 1000, 4096 };
+    SinCosKernel kernel = getKernel(path);
+    float error = 0;
+    bool passed = true;
+    for (int segmentCount : SEGMENT_COUNTS)
+    {
+        for (int ring = 0; ring < 2; ++ring)
+        {
+            // sectors: 0 to 2pi, stacks: pi/2 to -pi/2, both ends included
+            float start = ring == 0 ? 0 : PI / 2;
+            float step = ring == 0 ? 2 * PI / segmentCount : -PI / segmentCount;
+            int count = segmentCount + 1;
+            std::vector<float> angles(count), sines(count), cosines(count);
+            for (int i = 0; i < count; ++i)
+                angles[i] = start + i * step;
+
+            kernel(angles.data(), sines.data(), cosines.data(), count);
+            for (int i = 0; i < count; ++i)
+            {
+                float sineError = fabsf(sines[i] - sinf(angles[i]));
+                float cosineError = fabsf(cosines[i] - cosf(angles[i]));
+                if (!(sineError <= SINCOS_MAX_ERROR && cosineError <= SINCOS_MAX_ERROR))
+                    passed = false;                 // NaN fails too
+                error = fmaxf(error, fmaxf(sineError, cosineError));
+            }
+        }
+    }
+
+    if (maxError)
+        *maxError = error;
+    return passed;
+}
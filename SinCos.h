@@ -0,0 +1,41 @@
+#pragma once
+// Batched sine/cosine for parametric vertex generation
+// Cephes single precision polynomials evaluated 8 (AVX2), 4 (SSE2) or 1 (scalar)
+// angles at a time. The path is picked at runtime from the CPU features; all
+// paths perform the same float operations so they return identical results.
+
+#ifndef GEOMETRY_SINCOS_H
+#define GEOMETRY_SINCOS_H
+
+enum SinCosPath
+{
+    SINCOS_PATH_SCALAR = 0,
+    SINCOS_PATH_SSE2,
+    SINCOS_PATH_AVX2
+};
+
+// sin/cos of count angles, accurate for |angle| < 8192
+// angles may alias cosines (computed in place)
+void computeSinCos(const float* angles, float* sines, float* cosines, int count);
+
+// sin/cos of the angles start + i * step for i = [0, count)
+// used to build a sector/stack ring once and reuse it for every row
+void computeSinCosRing(float start, float step, int count, float* sines, float* cosines);
+
+// absolute error bound of every path against sinf/cosf, 2 * FLT_EPSILON;
+// the kernels stay within half of FLT_EPSILON on the rings of checkSinCosPath()
+const float SINCOS_MAX_ERROR = 2.3841858e-7f;
+
+// active path; setSinCosPath() falls back to the best supported path if the
+// requested one is not available on this CPU
+SinCosPath getSinCosPath();
+void setSinCosPath(SinCosPath path);
+const char* getSinCosPathName(SinCosPath path);
+
+// run a path on full sector and stack rings and compare with sinf/cosf
+// true if every result is within SINCOS_MAX_ERROR; false for a path this CPU
+// does not support; maxError (optional) gets the largest error found
+// the MeshChecks project runs it on every path, see checkSinCosPaths()
+bool checkSinCosPath(SinCosPath path, float* maxError = 0);
+
+#endif
@@ -15,6 +15,12 @@
 #include "learnOpengl/camera.h"
 #include "Cylinder.h"         // Files from www.songho.ca for the algorithms for creating a cylinder
 #include "Sphere.h"           // Files from www.songho.ca for the algorithms for creating a sphere
+#include "MeshCache.h"        // Shared, uploaded-once meshes for the cylinders and the sphere
+#include "GeometryBuffer.h"   // One vertex and index buffer for all meshes
+#include "Bounds.h"           // World bounding spheres of the draws, for frustum culling
+#include "ShaderProgram.h"    // Linked program with its uniforms looked up once
+#include "UniformBuffer.h"    // Per-frame camera and light data for all draws
+#include "RenderQueue.h"      // Draws sorted by state and depth, repeated meshes instanced
 
 /*
     Author:      Tiffany Gomez
@@ -47,6 +53,9 @@ namespace
     const char* const WINDOW_TITLE = "Tiffany Gomez::Mother's Tea Time"; // Macro for window title
     const int WINDOW_WIDTH = 800;
     const int WINDOW_HEIGHT = 600;
+    // framebuffer height in pixels, kept up to date by UResizeWindow; the
+    // levels of detail are picked from the projected size on it
+    int gViewportHeight = WINDOW_HEIGHT;
 
     // camera
     // Add position, direction, yaw and pitch to capture scene
@@ -60,45 +69,98 @@ namespace
     float deltaTime = 0.0f;
     float lastFrame = 0.0f;
 
-    // Stores the GL data relative to a given mesh
-    struct GLMesh
-    {
-        GLuint vao[6];         // There are 5 (0-6) vertex array objects
-        GLuint vbos[10];        // There are 10 (0-9) vertex buffer objects
-        GLuint nIndices;       // Number of indices of the mesh
-    };
-
     // Structure for plane
     struct plane {
         vector<float> verts;
-        vector<int> indices;
+        vector<unsigned short> indices;
     };
 
     // Structure for cube object
     struct cube {
         vector<float> verts;
-        vector<int> indices;
+        vector<unsigned short> indices;
     };
 
     // Main GLFW window
     GLFWwindow* gWindow = nullptr;
-    // Triangle mesh data
-    GLMesh gMesh;
+    // Vertex and index buffers of all meshes, behind one VAO, in the packed
+    // vertex format and with 16-bit indices (relative to the base vertex of
+    // each mesh); the mesh cache puts the cylinders and sphere in it,
+    // UInitialize the plane and the cube; meshes of more than 0xFFFF vertices don't fit
+    // and get 32-bit buffers of their own
+    std::shared_ptr<GeometryBuffer> gGeometry = std::make_shared<GeometryBuffer>(VERTEX_FORMAT_PACKED, GL_UNSIGNED_SHORT);
+    GeometryRange gPlaneRange;
+    GeometryRange gCubeRange;
     // Texture
     GLuint textPlaceMat, textMug, textTea, textLemon, textHandle, textPlate, textNapkin, textTomato;
     glm::vec2 gUVScale(1.0f, 1.0f);
 
     // Shader program
-    GLuint gProgramId;
+    ShaderProgram gProgram;
 
+    // Handles of the uniforms of the shader program, looked up once in main
+    // (the camera and light positions are in the FrameData block, the model
+    // matrices in the instance buffer and the lighting in the MaterialData block)
+    struct SceneUniforms
+    {
+        UniformHandle<glm::vec2> uvScale;
+        UniformHandle<int> texture, textureExtra;
+    };
+    SceneUniforms gUniforms;
 
-    // Cylinders: (float baseRadius, float topRadius, float height, int sectors, int stacks, bool smooth)
-    Cylinder cylinder1(1.0f, 1.5f, 2.0f, 25, 8, true);      // Mug
-    Cylinder cylinder2(1.35f, 1.35f, 0.1f, 25, 8, true);    // Tea
-    Cylinder cylinder3(1.4f, 2.3, 0.5f, 25, 8, true);      // Plate
+    // Data of the FrameData uniform block of the shaders, in std140 layout:
+    // a vec3 takes 16 bytes unless a float follows it
+    struct FrameUniformData
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec3 viewPosition;
+        float padding0;
+        glm::vec3 lightPos1;
+        float lightStrength1;
+        glm::vec3 lightPos2;
+        float lightStrength2;
+    };
+    static_assert(sizeof(FrameUniformData) == 176, "FrameUniformData must match the std140 FrameData block");
 
-    //Sphere: (float radius, int sectors, int stacks, bool smooth)
-    Sphere sphere1(0.66, 36, 18, true);                     // Tomato
+    // Buffer of the FrameData block, written once per frame
+    const GLuint FRAME_UNIFORM_BINDING = 0;
+    UniformBuffer gFrameUniforms;
+
+
+    // Shared meshes: identical primitives are generated and uploaded once,
+    // optimized for the vertex cache, in the 16-byte packed vertex format and
+    // drawn as triangle strips, or split into meshlets culled on the CPU if
+    // they are big enough; only on the GPU after upload, in ranges of
+    // gGeometry; the coarser LOD levels are simplified from the finest mesh
+    // where that stays close to it
+    MeshBuildOptions meshBuildOptions()
+    {
+        MeshBuildOptions options;
+        options.vertexFormat = VERTEX_FORMAT_PACKED;
+        options.optimize = true;
+        options.strips = true;
+        options.storage = GEOMETRY_STORAGE_GPU_ONLY;
+        options.meshlets = true;
+        options.geometryBuffer = gGeometry;
+        options.simplifyLods = true;
+        // options.cacheDirectory stays empty: no mesh files are written; set
+        // it to keep the meshes for the next run
+        return options;
+    }
+    MeshCache gMeshCache(meshBuildOptions());
+
+    // Index ranges of the visible meshlets, reused for every draw
+    MeshletDrawList gMeshletDrawList;
+
+    // Cylinders: Mug, Tea, Plate (LOD chains, created in UInitialize)
+    LodChain<Cylinder> cylinder1, cylinder2, cylinder3;
+
+    //Sphere: Tomato (LOD chain, created in UInitialize)
+    LodChain<Sphere> sphere1;
+
+    // Level of detail drawn last frame per object, for hysteresis (-1 = none yet)
+    int cylinder1Lod = -1, cylinder2Lod = -1, cylinder3Lod = -1, sphere1Lod = -1;
 
     // Plane
     plane plane1 = {};                                     // Place Mat and Napkin
@@ -106,6 +168,46 @@ namespace
     // Cube
     cube cube1 = {};                                       // Mug Handles
 
+    // Draws of the scene
+    enum SceneDraw { DRAW_MUG, DRAW_HANDLE1, DRAW_HANDLE2, DRAW_TEA, DRAW_PLACEMAT, DRAW_NAPKIN, DRAW_TOMATO, DRAW_PLATE, DRAW_COUNT };
+
+    // Model matrices and world bounding spheres of the draws (the scene does not
+    // move, so both are set up once in UInitialize), and the draws that passed
+    // the frustum test this frame
+    glm::mat4 gModels[DRAW_COUNT];
+    DrawBoundsList gDrawBounds;
+    std::vector<unsigned char> gDrawVisible;
+    size_t gReportedVisibleCount = DRAW_COUNT + 1;        // last visible count printed
+
+    // Lighting of the objects, indexed by the material of each instance; the
+    // array is the MaterialData uniform block of the fragment shader, in std140
+    // layout, written once in main
+    enum SceneMaterial { MATERIAL_DEFAULT, MATERIAL_TEA, MATERIAL_PLACEMAT, MATERIAL_NAPKIN, MATERIAL_TOMATO, MATERIAL_PLATE, MATERIAL_COUNT };
+    const int MAX_MATERIALS = 16;                          // size of the array in the shader
+    static_assert(MATERIAL_COUNT <= MAX_MATERIALS, "MaterialData has room for MAX_MATERIALS materials");
+    struct MaterialLighting
+    {
+        glm::vec3 lightColor1;
+        float specularIntensity;
+        glm::vec3 lightColor2;
+        int multipleTextures;
+        glm::vec3 ambientStrength;
+        float padding0;
+    };
+    static_assert(sizeof(MaterialLighting) == 48, "MaterialLighting must match the std140 Material struct");
+    MaterialLighting gMaterials[MAX_MATERIALS];
+
+    // Buffer of the MaterialData block
+    const GLuint MATERIAL_UNIFORM_BINDING = 1;
+    UniformBuffer gMaterialUniforms;
+
+    // Visible draws of the frame, sorted before drawing; draws of the same
+    // mesh with the same textures are instanced (the two handle cubes are one
+    // command), and the draws with the same textures are one multi draw
+    RenderQueue gRenderQueue;
+    unsigned int gReportedDrawCount = DRAW_COUNT + 1;     // last queue stats printed
+    unsigned int gReportedStateChanges = 0;
+
     // Perspective and Orthrographic global variable
     glm::mat4 projection;
     bool orthoView = false;
@@ -116,7 +218,6 @@ namespace
     glm::vec3 gLightColor1(1.0f, 1.0f, 1.0f);
     GLfloat lightStrength1 = 1.0f;
     glm::vec3 gAmbientStrength(glm::vec3(0.1f));
-    glm::vec3 gDiffuseStrength(glm::vec3(1.0f));
     float gSpecularIntensity = 0.6f;
     // light 2
     glm::vec3 gLightPosition2(3.0f, 5.0f, 3.0f);
@@ -124,9 +225,6 @@ namespace
     GLfloat lightStrength2 = 1.0f;
  
 
-    // Color
-    glm::vec3 objectColor(1.0f, 1.0f, 1.0f);
-
 }
 
 /* User-defined Function prototypes to:
@@ -141,21 +239,20 @@ void UMousePositionCallback(GLFWwindow* window, double xpos, double ypos);
 void UMouseScrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 void UMouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
 void switchKeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
-void mugConfig(GLMesh& mesh);
-void planeConfig(GLMesh& mesh);
-void handleConfig(GLMesh& mesh);
-void teaConfig(GLMesh& mesh);
-void sphereConfig(GLMesh& mesh);
-void plateConfig(GLMesh& mesh);
 void planeMesh();
 void cubeMesh();
-void UDestroyMesh(GLMesh& mesh);
 void URender();
 bool loadTexture(const char* filename, GLuint& textureId, int textureUnit);
 void UDestroyTexture(GLuint textureId);
 void flipImageVertically(unsigned char* image, int width, int height, int channels);
-bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint& programId);
-void UDestroyShaderProgram(GLuint programId);
+void UGetUniforms();
+void UPrintMeshReport(const char* name, const MeshOptimizationReport& report);
+template<class Shape> void USubmitMesh(SceneDraw draw, const SharedMesh<Shape>& mesh, SceneMaterial material,
+    GLuint texture, GLuint extraTexture, const glm::mat4& view);
+void USubmitDraw(SceneDraw draw, const RenderPacket& packet, const glm::mat4& view, const MeshletDrawList* ranges);
+void UReportRenderQueue();
+void USetupScene();
+void UCullScene(const glm::mat4& view);
 
 
 // Vertex Shader Source Code 
@@ -164,24 +261,49 @@ const GLchar* vertexShaderSource = GLSL(440,
     layout(location = 0) in vec3 position;          
 layout(location = 1) in vec3 normal;                
 layout(location = 2) in vec2 textureCoordinate;     
-// Outgoing to fragment shader (normals, color, texture coordinates).
+// Outgoing to fragment shader (normals, color, texture coordinates, material).
 out vec3 vertexNormal;                             
 out vec3 vertexFragmentPos; 
 out vec2 vertexTextureCoordinate;
+flat out uint vertexMaterial;
 
 
-// Variables for matrices transformation
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Camera and lights, the same for every draw of a frame
+layout(std140, binding = 0) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    vec3 viewPosition;
+    vec3 lightPos1;
+    float lightStrength1;
+    vec3 lightPos2;
+    float lightStrength2;
+};
+
+// Model matrix and material of each draw, written by the render queue
+struct Instance
+{
+    mat4 model;
+    uint material;
+};
+layout(std430, binding = 0) readonly buffer InstanceData
+{
+    Instance instances[];
+};
+// Element of this instance, the base instance of its draw command + gl_InstanceID
+layout(location = 4) in uint instanceIndex;
 
 void main()
 {
+    Instance instance = instances[instanceIndex];
+    mat4 model = instance.model;
+
     // Reference: Tutorial module 5
     gl_Position = projection * view * model * vec4(position, 1.0f); // Vertices -> clip coordinates
     vertexFragmentPos = vec3(model * vec4(position, 1.0f));         // Fragment position in world space
     vertexNormal = mat3(transpose(inverse(model))) * normal;        // Normal vecs in world space 
     vertexTextureCoordinate = textureCoordinate;
+    vertexMaterial = instance.material;
 }
 );
 
@@ -191,32 +313,51 @@ const GLchar* fragmentShaderSource = GLSL(440,
     in vec3 vertexNormal; 
 in vec3 vertexFragmentPos; 
 in vec2 vertexTextureCoordinate;
+flat in uint vertexMaterial;
 
 out vec4 fragmentColor; 
 
-// Uniform variables for lighting (shader files)
-uniform vec3 lightPos1;
-uniform vec3 lightColor1;
-uniform float lightStrength1;
-uniform vec3 lightPos2;
-uniform vec3 lightColor2;
-uniform float lightStrength2;
-uniform vec3 ambientStrength;
-uniform float specularIntensity;
-uniform vec3 viewPosition;
+// Camera and lights, the same block as in the vertex shader
+layout(std140, binding = 0) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    vec3 viewPosition;
+    vec3 lightPos1;
+    float lightStrength1;
+    vec3 lightPos2;
+    float lightStrength2;
+};
+
+// Lighting of the objects (shader files), indexed by the material of the instance
+struct Material
+{
+    vec3 lightColor1;
+    float specularIntensity;
+    vec3 lightColor2;
+    int multipleTextures;
+    vec3 ambientStrength;
+};
+layout(std140, binding = 1) uniform MaterialData
+{
+    Material materials[16];
+};
 // For two cylinders
 uniform sampler2D uTexture;         
 uniform sampler2D uTextureExtra;
-uniform bool multipleTextures;
 uniform vec2 uvScale;
-// Base
-uniform vec3 objectColor;
 
 void main()
 {
+    Material material = materials[vertexMaterial];
+    vec3 lightColor1 = material.lightColor1;
+    vec3 lightColor2 = material.lightColor2;
+    vec3 ambientStrength = material.ambientStrength;
+    float specularIntensity = material.specularIntensity;
+
     vec4 textureColor = texture(uTexture, vertexTextureCoordinate * uvScale);
     // Sample 2D (learnOpenLg) to find another texture based on same objects color
-    if (multipleTextures) {
+    if (material.multipleTextures != 0) {
         vec4 extraTexture = texture(uTextureExtra, vertexTextureCoordinate);
         if (extraTexture.a != 0.0) {
             textureColor = extraTexture;
@@ -279,8 +420,12 @@ int main(int argc, char* argv[])
         return EXIT_FAILURE;
 
     // Create the shader program
-    if (!UCreateShaderProgram(vertexShaderSource, fragmentShaderSource, gProgramId))
+    if (!gProgram.create(vertexShaderSource, fragmentShaderSource))
         return EXIT_FAILURE;
+    UGetUniforms();
+    gFrameUniforms.create(FRAME_UNIFORM_BINDING, sizeof(FrameUniformData));
+    gMaterialUniforms.create(MATERIAL_UNIFORM_BINDING, sizeof(gMaterials));
+    gMaterialUniforms.update(gMaterials, sizeof(gMaterials));
 
     
 
@@ -378,9 +523,8 @@ int main(int argc, char* argv[])
 
     
     // Set samplers per unit 
-    glUseProgram(gProgramId);
-    glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 0);
-    glUniform1i(glGetUniformLocation(gProgramId, "uTextureExtra"), 1);
+    gProgram.set(gUniforms.texture, 0);
+    gProgram.set(gUniforms.textureExtra, 1);
 
 
     // Sets the background color of the window to black (it will be implicitely used by glClear)
@@ -407,7 +551,13 @@ int main(int argc, char* argv[])
     }
 
     // Release mesh data
-    UDestroyMesh(gMesh);
+    gGeometry->remove(gPlaneRange);
+    gGeometry->remove(gCubeRange);
+    cylinder1.clear();
+    cylinder2.clear();
+    cylinder3.clear();
+    sphere1.clear();
+    gGeometry->release();
 
     // Release textures
     UDestroyTexture(textPlaceMat);
@@ -421,7 +571,10 @@ int main(int argc, char* argv[])
 
 
     // Release shader programs
-    UDestroyShaderProgram(gProgramId);
+    gProgram.release();
+    gFrameUniforms.release();
+    gMaterialUniforms.release();
+    gRenderQueue.release();
 
     exit(EXIT_SUCCESS); // Terminates the program successfully
 }
@@ -453,6 +606,9 @@ bool UInitialize(int argc, char* argv[], GLFWwindow** window)
     }
     glfwMakeContextCurrent(*window);
     glfwSetFramebufferSizeCallback(*window, UResizeWindow);
+    // the framebuffer can be bigger than the window, e.g. on high DPI screens
+    int framebufferWidth;
+    glfwGetFramebufferSize(*window, &framebufferWidth, &gViewportHeight);
     glfwSetCursorPosCallback(*window, UMousePositionCallback);
     glfwSetScrollCallback(*window, UMouseScrollCallback);
     glfwSetMouseButtonCallback(*window, UMouseButtonCallback);
@@ -476,31 +632,241 @@ bool UInitialize(int argc, char* argv[], GLFWwindow** window)
     // Displays GPU OpenGL version
     cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << endl;
 
-    // create plane mesh
+    // create plane mesh and send it to the GPU
     planeMesh();
-    // create cube mesh
+    gGeometry->append(plane1.verts.data(), (unsigned int)plane1.verts.size() / 8,
+        plane1.indices.data(), (unsigned int)plane1.indices.size(), GL_UNSIGNED_SHORT, gPlaneRange);
+    // create cube mesh and send it to the GPU
     cubeMesh();
+    gGeometry->append(cube1.verts.data(), (unsigned int)cube1.verts.size() / 8,
+        cube1.indices.data(), (unsigned int)cube1.indices.size(), GL_UNSIGNED_SHORT, gCubeRange);
 
-    // generate all the vertex arrays
-    glGenVertexArrays(6, gMesh.vao);
+    // Generate and upload the shared meshes
+    // Cylinders: (float baseRadius, float topRadius, float height, int sectors, int stacks, bool smooth)
+    // each with coarser levels of detail for when it gets small on screen
+    cylinder1 = gMeshCache.getCylinderLods(1.0f, 1.5f, 2.0f, 25, 8, true);      // Mug
+    cylinder2 = gMeshCache.getCylinderLods(1.35f, 1.35f, 0.1f, 25, 8, true);    // Tea
+    cylinder3 = gMeshCache.getCylinderLods(1.4f, 2.3f, 0.5f, 25, 8, true);      // Plate
 
-    // Create all the buffers: 2 for each mesh: first one for the vertex data, second one for the indices
-    glGenBuffers(10, gMesh.vbos);
+    //Sphere: (float radius, int sectors, int stacks, bool smooth)
+    sphere1 = gMeshCache.getSphereLods(0.66f, 36, 18, true);                    // Tomato
 
-    // set up all the GPU buffer objects
-    planeConfig(gMesh);
-    mugConfig(gMesh);
-    handleConfig(gMesh);
-    teaConfig(gMesh);
-    sphereConfig(gMesh);
-    plateConfig(gMesh);
-    
+    // every mesh is in one VAO, which also needs the instance index of the render queue
+    gRenderQueue.attachInstanceIndices(gGeometry->getVao());
+    cout << "INFO: Geometry buffer: " << gGeometry->getRangeCount() << " meshes, room for "
+        << gGeometry->getVertexCapacity() << " vertices and " << gGeometry->getIndexCapacity() << " indices" << endl;
 
+    // vertex cache efficiency gained by the optimizer (finest levels)
+    UPrintMeshReport("Mug", cylinder1.getLevel(0)->getOptimizationReport());
+    UPrintMeshReport("Tea", cylinder2.getLevel(0)->getOptimizationReport());
+    UPrintMeshReport("Plate", cylinder3.getLevel(0)->getOptimizationReport());
+    UPrintMeshReport("Tomato", sphere1.getLevel(0)->getOptimizationReport());
+
+    // place the objects and store their world bounds
+    USetupScene();
 
     return true;
 }
 
 
+/* ------------------- Print vertex cache statistics of a mesh -------------------*/
+void UPrintMeshReport(const char* name, const MeshOptimizationReport& report)
+{
+    cout << "INFO: " << name << " mesh: ACMR " << report.before.acmr << " -> " << report.after.acmr
+        << ", ATVR " << report.before.atvr << " -> " << report.after.atvr << endl;
+}
+
+
+/* ------------------- Queue a draw of a shared mesh -------------------*/
+// Meshes split into meshlets only submit the clusters that may be visible:
+// inside the view frustum and not facing away from the camera
+template<class Shape>
+void USubmitMesh(SceneDraw draw, const SharedMesh<Shape>& mesh, SceneMaterial material,
+    GLuint texture, GLuint extraTexture, const glm::mat4& view)
+{
+    if (!gDrawVisible[draw])
+        return;
+
+    RenderPacket packet;
+    packet.vao = mesh.getVao();
+    packet.textures[0] = texture;
+    packet.textures[1] = extraTexture;
+    packet.material = material;
+    packet.model = gModels[draw];
+    packet.primitiveType = mesh.getPrimitiveType();
+    packet.indexType = mesh.getIndexType();
+    packet.indexCount = mesh.getIndexCount();
+    packet.firstIndex = mesh.getFirstIndex();
+    packet.baseVertex = mesh.getBaseVertex();
+    if (mesh.getMeshlets().empty())
+    {
+        USubmitDraw(draw, packet, view, NULL);
+        return;
+    }
+
+    unsigned int indexSize = mesh.getIndexType() == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    if (cullMeshlets(mesh.getMeshlets(), view * gModels[draw], projection, indexSize, gMeshletDrawList) > 0)
+    {
+        packet.primitiveType = GL_TRIANGLES;
+        USubmitDraw(draw, packet, view, &gMeshletDrawList);
+    }
+}
+
+
+/* ------------------- Queue a draw with its sort key -------------------*/
+// Opaque draws with the same state go front to back, by the distance of
+// their bounding sphere centre along the view direction
+void USubmitDraw(SceneDraw draw, const RenderPacket& packet, const glm::mat4& view, const MeshletDrawList* ranges)
+{
+    BoundingSphere sphere = gDrawBounds.get(draw);
+    float viewDepth = -(view * glm::vec4(sphere.center[0], sphere.center[1], sphere.center[2], 1.0f)).z;
+    std::uint64_t key = makeRenderKey(RENDER_PASS_OPAQUE, 0, packet.textures[0], packet.vao, viewDepth);
+
+    if (ranges)
+        gRenderQueue.submitRanges(key, packet, ranges->counts.data(), ranges->offsets.data(), ranges->getDrawCount());
+    else
+        gRenderQueue.submit(key, packet);
+}
+
+
+/* ------------------- Print the state changes of the render queue -------------------*/
+// Whenever the number of draws or state changes changes
+void UReportRenderQueue()
+{
+    const RenderQueueStats& stats = gRenderQueue.getStats();
+    unsigned int stateChanges = stats.vaoBinds + stats.textureBinds;
+    if (stats.draws == gReportedDrawCount && stateChanges == gReportedStateChanges)
+        return;
+
+    cout << "INFO: Render queue: " << stats.instances << " objects in " << stats.commands << " draw commands ("
+        << stats.instancedCommands << " instanced), " << stats.draws << " multi draws, " << stats.vaoBinds << " VAO binds, " << stats.textureBinds << " texture binds" << endl;
+    gReportedDrawCount = stats.draws;
+    gReportedStateChanges = stateChanges;
+}
+
+
+/* ------------------- Place the objects of the scene -------------------*/
+// Model matrices of the draws, and their world bounding spheres from the
+// bounds of the meshes (the finest level of detail encloses the coarser ones)
+void USetupScene()
+{
+    // Mug :: cylinder 1 out of 3
+    // 1. Scales the object
+    glm::mat4 scale = glm::mat4(1.0f);
+    // 2. Rotates shape 
+    glm::mat4 rotation = glm::mat4(1.0f);
+    rotation = glm::rotate(rotation, -1.5708f, glm::vec3(1.0, 0.0f, 0.0f));
+    // 3. Place object at the origin
+    glm::mat4 translation = glm::mat4(1.0f);
+    translation = glm::translate(translation, glm::vec3(0.0f, 1.00f, 0.0f));
+    // Model matrix: transformations are applied right-to-left order
+    gModels[DRAW_MUG] = translation * rotation * scale;
+
+    // Handle : Cube  1 out of 2
+    scale = glm::mat4(1.0f);
+    scale = glm::scale(scale, glm::vec3(0.3f, 0.1f, 1.1f));
+    rotation = glm::mat4(1.0f);
+    rotation = glm::rotate(rotation, 0.0f, glm::vec3(1.0, 0.0f, 0.0f));
+    translation = glm::mat4(1.0f);
+    translation = glm::translate(translation, glm::vec3(0.5f, 1.5f, 1.55f));
+    gModels[DRAW_HANDLE1] = translation * rotation * scale;
+
+    // Handle : Cube 2 out of 2
+    scale = glm::mat4(1.0f);
+    scale = glm::scale(scale, glm::vec3(0.3f, 0.1f, 1.7f));
+    rotation = glm::mat4(1.0f);
+    rotation = glm::rotate(rotation, -0.785398f, glm::vec3(1.0, 0.0f, 0.0f));
+    translation = glm::mat4(1.0f);
+    translation = glm::translate(translation, glm::vec3(0.5f, 0.83f, 1.5f));
+    gModels[DRAW_HANDLE2] = translation * rotation * scale;
+
+    // Tea : Cylinder 2 out of 3
+    scale = glm::mat4(1.0f);
+    rotation = glm::mat4(1.0f);
+    rotation = glm::rotate(rotation, -1.5708f, glm::vec3(1.0, 0.0f, 0.0f));
+    translation = glm::mat4(1.0f);
+    translation = glm::translate(translation, glm::vec3(0.0f, 1.951f, 0.0f));
+    gModels[DRAW_TEA] = translation * rotation * scale;
+
+    // Place Matt : Plane 1 out of 2
+    scale = glm::mat4(1.0f);
+    scale = glm::scale(scale, glm::vec3(12.0f, 1.0f, 10.0f));
+    rotation = glm::mat4(1.0f);
+    rotation = glm::rotate(rotation, -0.8f, glm::vec3(0.0f, 1.0f, 0.0f));
+    translation = glm::mat4(1.0f);
+    translation = glm::translate(translation, glm::vec3(-1.0f, -0.57f, -2.0f));
+    gModels[DRAW_PLACEMAT] = translation * rotation * scale;
+
+    // Napkin : Plane 2 out of 2
+    scale = glm::mat4(2.0f);
+    scale = glm::scale(scale, glm::vec3(4.0f, 1.0f, 4.0f));
+    rotation = glm::mat4(1.0f);
+    rotation = glm::rotate(rotation, -0.8f, glm::vec3(0.0f, 1.0f, 0.0f));
+    translation = glm::mat4(1.0f);
+    translation = glm::translate(translation, glm::vec3(0.0f, -0.56f, 0.0f));
+    gModels[DRAW_NAPKIN] = translation * rotation * scale;
+
+    // Tomato : Sphere
+    scale = glm::mat4(1.0f);
+    rotation = glm::mat4(1.0f);
+    rotation = glm::rotate(rotation, 1.0f, glm::vec3(0.0, 1.0f, 0.0f));
+    translation = glm::mat4(1.0f);
+    translation = glm::translate(translation, glm::vec3(-3.5f, 0.90f, -1.3f));
+    gModels[DRAW_TOMATO] = translation * rotation * scale;
+
+    // Plate : Cylinder 3 out of 3
+    scale = glm::mat4(1.0f);
+    rotation = glm::mat4(1.0f);
+    rotation = glm::rotate(rotation, -1.5708f, glm::vec3(0.0, 1.0f, 0.0f));
+    rotation = glm::rotate(rotation, -1.5708f, glm::vec3(1.0, 0.0f, 0.0f));
+    translation = glm::mat4(1.0f);
+    translation = glm::translate(translation, glm::vec3(-3.9f, 0.08f, -1.6f));
+    gModels[DRAW_PLATE] = translation * rotation * scale;
+
+    // Lighting of the objects, in std140 order: light colour 1, specular
+    // intensity, light colour 2, whether the second texture is used, ambient strength
+    gMaterials[MATERIAL_DEFAULT] = { gLightColor1, gSpecularIntensity, gLightColor2, 0, gAmbientStrength, 0.0f };
+    gMaterials[MATERIAL_TEA] = { gLightColor1, gSpecularIntensity, gLightColor2, 1, gAmbientStrength, 0.0f };
+    gMaterials[MATERIAL_PLACEMAT] = { glm::vec3(1.0f, 1.0f, 1.0f), 0.5f, glm::vec3(0.0f, 0.0f, 0.0f), 0, glm::vec3(0.3001f, 0.3001f, 0.3001f), 0.0f };
+    gMaterials[MATERIAL_NAPKIN] = { gLightColor1, 0.001f, gLightColor2, 0, glm::vec3(0.00001f, 0.00001f, 0.00001f), 0.0f };
+    gMaterials[MATERIAL_TOMATO] = { glm::vec3(1.0f, 1.0f, 0.80f), 0.4f, gLightColor2, 0, glm::vec3(0.09f, 0.09f, 0.08f), 0.0f };
+    gMaterials[MATERIAL_PLATE] = { glm::vec3(1.0f, 0.60f, 0.20f), 0.5f, gLightColor2, 0, glm::vec3(0.08f, 0.08f, 0.08f), 0.0f };
+
+    // World bounds, in the order of SceneDraw
+    BoundingBox planeBox;
+    BoundingSphere planeSphere;
+    computeBounds(plane1.verts.data(), 8, plane1.verts.size() / 8, planeBox, planeSphere);
+    BoundingBox cubeBox;
+    BoundingSphere cubeSphere;
+    computeBounds(cube1.verts.data(), 8, cube1.verts.size() / 8, cubeBox, cubeSphere);
+
+    gDrawBounds.clear();
+    gDrawBounds.add(cylinder1.getLevel(0)->getBoundingSphere(), gModels[DRAW_MUG]);
+    gDrawBounds.add(cubeSphere, gModels[DRAW_HANDLE1]);
+    gDrawBounds.add(cubeSphere, gModels[DRAW_HANDLE2]);
+    gDrawBounds.add(cylinder2.getLevel(0)->getBoundingSphere(), gModels[DRAW_TEA]);
+    gDrawBounds.add(planeSphere, gModels[DRAW_PLACEMAT]);
+    gDrawBounds.add(planeSphere, gModels[DRAW_NAPKIN]);
+    gDrawBounds.add(sphere1.getLevel(0)->getBoundingSphere(), gModels[DRAW_TOMATO]);
+    gDrawBounds.add(cylinder3.getLevel(0)->getBoundingSphere(), gModels[DRAW_PLATE]);
+}
+
+
+/* ------------------- Find the draws inside the view frustum -------------------*/
+// All the bounding spheres are tested at once; the counts are printed
+// whenever they change
+void UCullScene(const glm::mat4& view)
+{
+    size_t visibleCount = gDrawBounds.cull(Frustum(projection * view), gDrawVisible);
+    if (visibleCount != gReportedVisibleCount)
+    {
+        cout << "INFO: Culling: " << visibleCount << " visible, " << gDrawBounds.getCount() - visibleCount
+            << " culled of " << gDrawBounds.getCount() << " draws" << endl;
+        gReportedVisibleCount = visibleCount;
+    }
+}
+
+
 /* ------------------- Process key input for current frame -------------------*/
 // called every render loop, making it a very fast input reader
 void UProcessInput(GLFWwindow* window)
@@ -542,6 +908,8 @@ void switchKeyCallback(GLFWwindow* window, int key, int scancode, int action, in
 void UResizeWindow(GLFWwindow* window, int width, int height)
 {
     glViewport(0, 0, width, height);
+    if (height > 0)
+        gViewportHeight = height;   // 0 while minimized
 }
 
 
@@ -618,6 +986,9 @@ void URender()
     // Enable z-depth
     glEnable(GL_DEPTH_TEST);
 
+    // The shared meshes are triangle strips separated by the max index value
+    glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+
     // Clear the frame and z buffers
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -635,314 +1006,95 @@ void URender()
         projection = glm::perspective(45.0f, (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
     }
 
-    // Set the shader to be used
-    glUseProgram(gProgramId);
-
-    
-    // Mug :: cylinder 1 out of 3 : array 0
-    //--------------------------------------------------------------------
-    // 1. Scales the object
-    glm::mat4 scale = glm::mat4(1.0f);
-    // 2. Rotates shape 
-    glm::mat4 rotation = glm::mat4(1.0f);
-    rotation = glm::rotate(rotation, -1.5708f, glm::vec3(1.0, 0.0f, 0.0f));
-    // 3. Place object at the origin
-    glm::mat4 translation = glm::mat4(1.0f);
-    translation = glm::translate(translation, glm::vec3(0.0f, 1.00f, 0.0f));
-    // Model matrix: transformations are applied right-to-left order
-    glm::mat4 model = translation * rotation * scale;
-
-    // Specify color
-    GLfloat myColor[] = { 0.7f, 0.7f, 0.7f, 1.0f };
-
-    // Retrieves transform matricies
-    GLint modelLoc = glGetUniformLocation(gProgramId, "model");
-    GLint viewLoc = glGetUniformLocation(gProgramId, "view");
-    GLint projLoc = glGetUniformLocation(gProgramId, "projection");
-    
-    // Send transform matricies to shader 
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-
-    // Set texture uniform variable in shader 
-    GLint UVScaleLoc = glGetUniformLocation(gProgramId, "uvScale");
-    glUniform2fv(UVScaleLoc, 1, glm::value_ptr(gUVScale));
-
-    /*
-        Here we set all the uniforms for the 5/6 types of lights we have. We have to set them manually and index
-        the proper PointLight struct in the array to set each uniform variable. This can be done more code-friendly
-        by defining light types as classes and set their values in there, or by using a more efficient uniform approach
-        by using 'Uniform buffer objects', but that is something we'll discuss in the 'Advanced GLSL' tutorial.
-    */
-    GLint lightColor1Loc = glGetUniformLocation(gProgramId, "lightColor1");
-    GLint lightColor2Loc = glGetUniformLocation(gProgramId, "lightColor2");
-    GLint lightPosition1Loc = glGetUniformLocation(gProgramId, "lightPos1");
-    GLint lightPosition2Loc = glGetUniformLocation(gProgramId, "lightPos2");
-    GLint lightStrength1Loc = glGetUniformLocation(gProgramId, "lightStrength1");
-    GLint lightStrength2Loc = glGetUniformLocation(gProgramId, "lightStrength2");
-    GLint viewPositionLoc = glGetUniformLocation(gProgramId, "viewPosition");
-    GLint ambientStrengthLoc = glGetUniformLocation(gProgramId, "ambientStrength");
-    GLint diffuseStrengthLoc = glGetUniformLocation(gProgramId, "diffuseStrength");
-    GLint specularIntensityLoc = glGetUniformLocation(gProgramId, "specularIntensity");
-
-    glUniform3f(lightColor1Loc, gLightColor1.r, gLightColor1.g, gLightColor1.b);
-    glUniform3f(lightColor2Loc, gLightColor2.r, gLightColor2.g, gLightColor2.b);
-    glUniform3f(lightPosition1Loc, gLightPosition1.x, gLightPosition1.y, gLightPosition1.z);
-    glUniform3f(lightPosition2Loc, gLightPosition2.x, gLightPosition2.y, gLightPosition2.z);
-    glUniform1f(lightStrength1Loc, lightStrength1);
-    glUniform1f(lightStrength2Loc, lightStrength2);
-    glUniform3f(ambientStrengthLoc, gAmbientStrength.r, gAmbientStrength.g, gAmbientStrength.b);
-    glUniform3f(diffuseStrengthLoc, gDiffuseStrength.r, gAmbientStrength.g, gAmbientStrength.b);
-    glUniform1f(specularIntensityLoc, gSpecularIntensity);;
-    const glm::vec3 cameraPosition = camera.Position;
-    glUniform3f(viewPositionLoc, cameraPosition.x, cameraPosition.y, cameraPosition.z);
-
-    // There are no multiple textures
-    GLuint multipleTexturesLoc = glGetUniformLocation(gProgramId, "multipleTextures");
-    glUniform1i(multipleTexturesLoc, false);
-
-    // Activate the VBOs contained within the mesh's VAO
-    glBindVertexArray(gMesh.vao[0]);
-
-    // bind textures on corresponding texture units
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textMug);
-
-    // Draw a mug using a cylinder 
-    glDrawElements(GL_TRIANGLES, cylinder1.getIndexCount(), GL_UNSIGNED_INT, NULL);
-
-    // Deactivate the Vertex Array Object
-    glBindVertexArray(0);
-
-
-    // Handle : Cube  1 out of 2 : Array 2
-    // Set up cup handle buffers
-    //-------------------------------------------------------------------------
-    handleConfig(gMesh);
-
-    // Modify model view 
-    scale = glm::mat4(1.0f);
-    scale = glm::scale(scale, glm::vec3(0.3f, 0.1f, 1.1f));
-    rotation = glm::mat4(1.0f);
-    rotation = glm::rotate(rotation, 0.0f, glm::vec3(1.0, 0.0f, 0.0f));
-    translation = glm::mat4(1.0f);
-    translation = glm::translate(translation, glm::vec3(0.5f, 1.5f, 1.55f));
-    model = translation * rotation * scale;
-
-    // Specify color
-    myColor[0] = 0.7f;
-    myColor[1] = 0.7f;
-    myColor[2] = 0.7f;
-
-    // Set new model matrix and color in shader's uniform variables
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, &model[0][0]);
-
-    glUniform1i(multipleTexturesLoc, false);
-    glBindVertexArray(gMesh.vao[2]);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textHandle);
-    glDrawArrays(GL_TRIANGLES, 0, cube1.verts.size() / 8);
-    glBindVertexArray(0);
-
-    // Handle : Cube 2 out of 2 : Array 2
-    // ______________________________________________________________________
-    // Modify height
-    scale = glm::mat4(1.0f);
-    scale = glm::scale(scale, glm::vec3(0.3f, 0.1f, 1.7f));
-    rotation = glm::mat4(1.0f);
-    rotation = glm::rotate(rotation, -0.785398f, glm::vec3(1.0, 0.0f, 0.0f));
-    translation = glm::mat4(1.0f);
-    translation = glm::translate(translation, glm::vec3(0.5f, 0.83f, 1.5f));
-    model = translation * rotation * scale;
-
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, &model[0][0]);
-    glUniform1i(multipleTexturesLoc, false);
-    glBindVertexArray(gMesh.vao[2]);
-    glDrawArrays(GL_TRIANGLES, 0, cube1.verts.size() / 8);
-    glBindVertexArray(0);
-
-
-    // Tea : Cylinder 2 out of 3: Array 3
-    //-----------------------------------------------------------------------
-    scale = glm::mat4(1.0f);
-    rotation = glm::mat4(1.0f);
-    rotation = glm::rotate(rotation, -1.5708f, glm::vec3(1.0, 0.0f, 0.0f));
-    translation = glm::mat4(1.0f);
-    translation = glm::translate(translation, glm::vec3(0.0f, 1.951f, 0.0f));
-    model = translation * rotation * scale;
-
-       glUniformMatrix4fv(modelLoc, 1, GL_FALSE, &model[0][0]);
-
-    // Set to true to let fragment shader know of multiple textures
-    glUniform1i(multipleTexturesLoc, true);
-
-    glBindVertexArray(gMesh.vao[3]);
-    // Texture for Tea
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textTea);
-    // Texture for the Lemon inside the Tea
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, textLemon);
-
-    glDrawElements(GL_TRIANGLES, cylinder2.getIndexCount(), GL_UNSIGNED_INT, NULL);
-    glBindVertexArray(0);
-
-
-    // Place Matt : Plane 1 out of 2: Array 1
-   //-----------------------------------------------------------------------
-    // Change model view before drawing plane
-    scale = glm::mat4(1.0f);
-    scale = glm::scale(scale, glm::vec3(12.0f, 1.0f, 10.0f));
-    rotation = glm::mat4(1.0f);
-    rotation = glm::rotate(rotation, -0.8f, glm::vec3(0.0f, 1.0f, 0.0f));
-    translation = glm::mat4(1.0f);
-    translation = glm::translate(translation, glm::vec3(-1.0f, -0.57f, -2.0f));
-    model = translation * rotation * scale;
-
-
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, &model[0][0]);
-    // Adjust ambient strength and specular intensity for place matt
-    glUniform3f(lightColor1Loc, 1.0f, 1.0f, 1.0f);
-    glUniform3f(lightColor2Loc, 0.0f, 0.0f, 0.0f);
-    glUniform3f(ambientStrengthLoc, 0.3001f, 0.3001f, 0.3001f);
-    glUniform1f(specularIntensityLoc, 0.5f);
-
-    // tell fragment shader there is not multiple textures
-    glUniform1i(multipleTexturesLoc, false);
-
-    // Activate the VBOs contained within the mesh's VAO
-    glBindVertexArray(gMesh.vao[1]);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textPlaceMat);
-    glDrawArrays(GL_TRIANGLES, 0, plane1.verts.size() / 8);
-
-    // revert to original ambient strength, diffuse strength, and specular intensity
-    glUniform3f(lightColor1Loc, gLightColor1.r, gLightColor1.g, gLightColor1.b);
-    glUniform3f(lightColor2Loc, gLightColor2.r, gLightColor2.g, gLightColor2.b);
-    glUniform3f(ambientStrengthLoc, gAmbientStrength.r, gAmbientStrength.g, gAmbientStrength.b);
-    glUniform3f(diffuseStrengthLoc, gDiffuseStrength.r, gAmbientStrength.g, gAmbientStrength.b);
-    glUniform1f(specularIntensityLoc, gSpecularIntensity);
-
-    // Deactivate the Vertex Array Object
-    glBindVertexArray(0);
-
-
-   // Napkin : Plane 2 out of 2: Array 1
-   //-----------------------------------------------------------------------
-   // Change model view before drawing plane
-    scale = glm::mat4(2.0f);
-    scale = glm::scale(scale, glm::vec3(4.0f, 1.0f, 4.0f));
-    rotation = glm::mat4(1.0f);
-    rotation = glm::rotate(rotation, -0.8f, glm::vec3(0.0f, 1.0f, 0.0f));
-    translation = glm::mat4(1.0f);
-    translation = glm::translate(translation, glm::vec3(0.0f, -0.56f, 0.0f));
-    model = translation * rotation * scale;
-
-    // Set new model matrix and color in shader's uniform variables
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, &model[0][0]);
-    // Modify lighting for object
-    glUniform3f(ambientStrengthLoc, 0.00001f, 0.00001f, 0.00001f);
-    glUniform1f(specularIntensityLoc, 0.001f);
-
-    glUniform1i(multipleTexturesLoc, false);
-
-    glBindVertexArray(gMesh.vao[1]);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textNapkin);
-
-    // Draw the plane
-    glDrawArrays(GL_TRIANGLES, 0, plane1.verts.size() / 8);
-
-    // Revert to original ambient strength, diffuse strength, and specular intensity
-    glUniform3f(ambientStrengthLoc, gAmbientStrength.r, gAmbientStrength.g, gAmbientStrength.b);
-    glUniform1f(specularIntensityLoc, gSpecularIntensity);
-
-    // Deactivate the Vertex Array Object
-    glBindVertexArray(0);
-
-    // Tomato : Sphere: Array 4
-   //-----------------------------------------------------------------------
-    scale = glm::mat4(1.0f);
-    rotation = glm::mat4(1.0f);
-    rotation = glm::rotate(rotation, 1.0f, glm::vec3(0.0, 1.0f, 0.0f));
-    translation = glm::mat4(1.0f);
-    translation = glm::translate(translation, glm::vec3(-3.5f, 0.90f, -1.3f));
-    model = translation * rotation * scale;
-
-    // Specify color
-    myColor[0] = 1.0f;
-    myColor[1] = 1.0f;
-    myColor[2] = 1.0f;
-
-    // Set new model matrix and color in shader's uniform variables
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, &model[0][0]);
-    // Modify lighting for object
-    glUniform3f(lightColor1Loc, 1.0f, 1.0f, 0.80f);
-    glUniform3f(ambientStrengthLoc, 0.09f, 0.09f, 0.08f);
-    glUniform1f(specularIntensityLoc, 0.4f);
-
-    // tell fragment shader there is multiple textures
-    glUniform1i(multipleTexturesLoc, false);
-
-    // Activate the VBOs contained within the mesh's VAO
-    glBindVertexArray(gMesh.vao[4]);
-
-    // bind textures on corresponding texture units
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textTomato);
-
-    // Draw the tomato sphere
-    glDrawElements(GL_TRIANGLES, sphere1.getIndexCount(), GL_UNSIGNED_INT, NULL);
-
-    // set lighting components back to normal
-    glUniform3f(lightColor1Loc, gLightColor1.r, gLightColor1.g, gLightColor1.b);
-    glUniform3f(ambientStrengthLoc, gAmbientStrength.r, gAmbientStrength.g, gAmbientStrength.b);
-    glUniform1f(specularIntensityLoc, gSpecularIntensity);
-
-    // Deactivate the Vertex Array Object
-    glBindVertexArray(0);
-
-
-    // Plate : Cylinder 3 out of 3: Array 5
-   //-----------------------------------------------------------------------
-    scale = glm::mat4(1.0f);
-    rotation = glm::mat4(1.0f);
-    rotation = glm::rotate(rotation, -1.5708f, glm::vec3(0.0, 1.0f, 0.0f));
-    rotation = glm::rotate(rotation, -1.5708f, glm::vec3(1.0, 0.0f, 0.0f));
-    translation = glm::mat4(1.0f);
-    translation = glm::translate(translation, glm::vec3(-3.9f, 0.08f, -1.6f));
-    model = translation * rotation * scale;
-
-    // Set new model matrix and color in shader's uniform variables
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, &model[0][0]);
-    // change lighting components for this object
-    glUniform3f(lightColor1Loc, 1.0f, 0.60f, 0.20f);
-    glUniform3f(ambientStrengthLoc, 0.08f, 0.08f, 0.08f);
-    glUniform1f(specularIntensityLoc, 0.5f);
-
-    // tell fragment shader there is multiple textures
-    glUniform1i(multipleTexturesLoc, false);
-
-    // Activate the VBOs contained within the mesh's VAO
-    glBindVertexArray(gMesh.vao[5]);
-
-    // bind textures on corresponding texture units
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textPlate);
+    // Skip the objects outside the view frustum
+    UCullScene(view);
+
+    // Camera and lights for all draws, in one write
+    FrameUniformData frameData;
+    frameData.view = view;
+    frameData.projection = projection;
+    frameData.viewPosition = camera.Position;
+    frameData.padding0 = 0.0f;
+    frameData.lightPos1 = gLightPosition1;
+    frameData.lightStrength1 = lightStrength1;
+    frameData.lightPos2 = gLightPosition2;
+    frameData.lightStrength2 = lightStrength2;
+    gFrameUniforms.update(&frameData, sizeof(frameData));
 
-    // Draw the tea cylinder
-    glDrawElements(GL_TRIANGLES, cylinder3.getIndexCount(), GL_UNSIGNED_INT, NULL);
+    // Set the shader to be used
+    gProgram.use();
+
+    // Set texture uniform variable in shader
+    gProgram.set(gUniforms.uvScale, gUVScale);
+
+    // Queue the visible objects; the levels of detail are picked from the
+    // projected size even when culled, to keep their hysteresis
+    gRenderQueue.clear();
+
+    // Mug :: cylinder 1 out of 3
+    const SharedMesh<Cylinder>& mugMesh = cylinder1.select(view * gModels[DRAW_MUG], projection, (float)gViewportHeight, cylinder1Lod);
+    USubmitMesh(DRAW_MUG, mugMesh, MATERIAL_DEFAULT, textMug, 0, view);
+
+    // Handle : Cubes 1 and 2 out of 2
+    RenderPacket cubePacket;
+    cubePacket.vao = gGeometry->getVao();
+    cubePacket.textures[0] = textHandle;
+    cubePacket.textures[1] = 0;
+    cubePacket.material = MATERIAL_DEFAULT;
+    cubePacket.primitiveType = GL_TRIANGLES;
+    cubePacket.indexType = gGeometry->getIndexType();
+    cubePacket.indexCount = (GLsizei)gCubeRange.indexCount;
+    cubePacket.firstIndex = gCubeRange.firstIndex;
+    cubePacket.baseVertex = (GLint)gCubeRange.firstVertex;
+    for (int draw = DRAW_HANDLE1; draw <= DRAW_HANDLE2; ++draw)
+    {
+        if (!gDrawVisible[draw])
+            continue;
+        cubePacket.model = gModels[draw];
+        USubmitDraw((SceneDraw)draw, cubePacket, view, NULL);
+    }
 
-    // set lighting components back to normal
-    glUniform3f(lightColor1Loc, gLightColor1.r, gLightColor1.g, gLightColor1.b);
-    glUniform3f(ambientStrengthLoc, gAmbientStrength.r, gAmbientStrength.g, gAmbientStrength.b);
-    glUniform1f(specularIntensityLoc, gSpecularIntensity);
+    // Tea : Cylinder 2 out of 3, with the lemon slice as second texture
+    const SharedMesh<Cylinder>& teaMesh = cylinder2.select(view * gModels[DRAW_TEA], projection, (float)gViewportHeight, cylinder2Lod);
+    USubmitMesh(DRAW_TEA, teaMesh, MATERIAL_TEA, textTea, textLemon, view);
+
+    // Place Matt and Napkin : Planes 1 and 2 out of 2
+    RenderPacket planePacket;
+    planePacket.vao = gGeometry->getVao();
+    planePacket.textures[1] = 0;
+    planePacket.primitiveType = GL_TRIANGLES;
+    planePacket.indexType = gGeometry->getIndexType();
+    planePacket.indexCount = (GLsizei)gPlaneRange.indexCount;
+    planePacket.firstIndex = gPlaneRange.firstIndex;
+    planePacket.baseVertex = (GLint)gPlaneRange.firstVertex;
+    if (gDrawVisible[DRAW_PLACEMAT])
+    {
+        planePacket.textures[0] = textPlaceMat;
+        planePacket.material = MATERIAL_PLACEMAT;
+        planePacket.model = gModels[DRAW_PLACEMAT];
+        USubmitDraw(DRAW_PLACEMAT, planePacket, view, NULL);
+    }
+    if (gDrawVisible[DRAW_NAPKIN])
+    {
+        planePacket.textures[0] = textNapkin;
+        planePacket.material = MATERIAL_NAPKIN;
+        planePacket.model = gModels[DRAW_NAPKIN];
+        USubmitDraw(DRAW_NAPKIN, planePacket, view, NULL);
+    }
 
-    // Deactivate the Vertex Array Object
-    glBindVertexArray(0);
+    // Tomato : Sphere
+    const SharedMesh<Sphere>& tomatoMesh = sphere1.select(view * gModels[DRAW_TOMATO], projection, (float)gViewportHeight, sphere1Lod);
+    USubmitMesh(DRAW_TOMATO, tomatoMesh, MATERIAL_TOMATO, textTomato, 0, view);
 
+    // Plate : Cylinder 3 out of 3
+    const SharedMesh<Cylinder>& plateMesh = cylinder3.select(view * gModels[DRAW_PLATE], projection, (float)gViewportHeight, cylinder3Lod);
+    USubmitMesh(DRAW_PLATE, plateMesh, MATERIAL_PLATE, textPlate, 0, view);
 
+    // Draw them sorted by state, front to back, in one multi draw per texture
+    // and primitive type
+    gRenderQueue.sort();
+    gRenderQueue.execute();
+    UReportRenderQueue();
 
 
     //-------------------------------------------------------------------------------------
@@ -952,212 +1104,9 @@ void URender()
 
 
 
-/* Set up buffer(s) and configure vertex attributes for:
- * Mug (cylinder), Handle (cube), and Tea (cylinder)
- */
-
-// Mug
-// -----------------------------------------------
-void mugConfig(GLMesh& mesh)
-{
-    const GLuint floatsPerVertex = 3;
-    const GLuint floatsPerNormals = 3;
-    const GLuint floatsPerUV = 2;
-    const GLuint floatsInEachStride = 8;
-
-    glBindVertexArray(mesh.vao[0]); // activate vertex array object
-
-    // Activates the first buffer
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]);
-    // Sends vertex data to the GPU
-    glBufferData(GL_ARRAY_BUFFER, cylinder1.getInterleavedVertexSize(), cylinder1.getInterleavedVertices(), GL_STATIC_DRAW);
-
-    // activate second buffer for index array
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.vbos[1]);
-    // stores indices[] array on GPU
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, cylinder1.getIndexSize(), cylinder1.getIndices(), GL_STATIC_DRAW);
-
-    // Strides between vertex coordinates
-    GLint stride = cylinder1.getInterleavedStride();
-
-    // Create Vertex Attribute Pointers for array 0
-    // Position of data
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0); 
-    // Normals data for light
-    glVertexAttribPointer(1, floatsPerNormals, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1); 
-    // Texture data for coordinates
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2); 
-}
-
-
-// Handle
-// ----------------------------------------------
-void handleConfig(GLMesh& mesh) {
-
-    const GLuint floatsPerVertex = 3;
-    const GLuint floatsPerNormals = 3;
-    const GLuint floatsPerUV = 2;
-    const GLuint floatsInEachStride = 8;
-
-    glBindVertexArray(mesh.vao[2]); // activate vertex array object
-
-    // Activates the first buffer
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[3]);
-    // Sends vertex data to the GPU
-    glBufferData(GL_ARRAY_BUFFER, cube1.verts.size() * sizeof(float), cube1.verts.data(), GL_STATIC_DRAW);
-
-    // Strides between vertex coordinates
-    GLint stride = sizeof(float) * (floatsInEachStride);// The number of floats before each
-
-    // Create Vertex Attribute Pointers for array 1
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0); 
-    glVertexAttribPointer(1, floatsPerNormals, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerVertex));
-    glEnableVertexAttribArray(1); 
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormals)));
-    glEnableVertexAttribArray(2); 
-}
-
-
-// Tea
-// -------------------------------------------
-void teaConfig(GLMesh& mesh)
-{
-    const GLuint floatsPerVertex = 3;
-    const GLuint floatsPerNormals = 3;
-    const GLuint floatsPerUV = 2;
-    const GLuint floatsInEachStride = 8;
-
-    glBindVertexArray(mesh.vao[3]); // activate vertex array object
-
-    // Activates the first buffer
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[4]);
-    // Sends vertex data to the GPU
-    glBufferData(GL_ARRAY_BUFFER, cylinder2.getInterleavedVertexSize(), cylinder2.getInterleavedVertices(), GL_STATIC_DRAW);
-
-    // activate second buffer for index array
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.vbos[5]);
-    // stores indices[] array on GPU
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, cylinder2.getIndexSize(), cylinder2.getIndices(), GL_STATIC_DRAW);
-
-    // The number of floats that make up a block of vertex data. Should be 32 bytes
-    GLint stride = cylinder2.getInterleavedStride();
-
-    // Create Vertex Attribute Pointers for array 2
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, floatsPerNormals, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2); 
-
-}
-
-// Place Matt
-// -------------------------------------------
-void planeConfig(GLMesh& mesh) {
-    const GLuint floatsPerVertex = 3;
-    const GLuint floatsPerNormals = 3;
-    const GLuint floatsPerUV = 2;
-    const GLuint floatsInEachStride = 8;
-
-    glBindVertexArray(mesh.vao[1]); // activate vertex array object
-
-    // Activates the first buffer
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[2]);
-    // Sends vertex data to the GPU
-    glBufferData(GL_ARRAY_BUFFER, plane1.verts.size() * sizeof(float), plane1.verts.data(), GL_STATIC_DRAW);
-
-    // Strides between vertex coordinates
-    GLint stride = sizeof(float) * (floatsInEachStride);// The number of floats before each
-
-    // Create Vertex Attribute Pointers for array 3
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, floatsPerNormals, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerVertex));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormals)));
-    glEnableVertexAttribArray(2);
-
-}
-
-// Tomato
-// -------------------------------------------
-void sphereConfig(GLMesh& mesh)
-{
-    const GLuint floatsPerVertex = 3;
-    const GLuint floatsPerNormals = 3;
-    const GLuint floatsPerUV = 2;
-    const GLuint floatsInEachStride = 8;
-
-    glBindVertexArray(mesh.vao[4]); // activate vertex array object
-
-    // Activates the first buffer
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[6]);
-    // Sends vertex data to the GPU
-    glBufferData(GL_ARRAY_BUFFER, sphere1.getInterleavedVertexSize(), sphere1.getInterleavedVertices(), GL_STATIC_DRAW);
-
-    // activate second buffer for index array
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.vbos[7]);
-    // stores indices[] array on GPU
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sphere1.getIndexSize(), sphere1.getIndices(), GL_STATIC_DRAW);
-
-    // Strides between vertex coordinates
-    GLint stride = sphere1.getInterleavedStride();
-
-    // Create Vertex Attribute Pointers
-    // position attribute -- instructs GPU how to handle vertex position data
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0); // enables the vertex attribute array numbered 0
-    // normals attribute -- instructs GPU how to handle normals data
-    glVertexAttribPointer(1, floatsPerNormals, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1); // enables the vertex attribute array numbered 0
-    // texture coordinate attribute -- instructs GPU how to handle texture coordinates
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2); // enables the vertex attribute array numbered 0
-}
-
-// Plate
-// -------------------------------------------
-void plateConfig(GLMesh& mesh)
-{
-    const GLuint floatsPerVertex = 3;
-    const GLuint floatsPerNormals = 3;
-    const GLuint floatsPerUV = 2;
-    const GLuint floatsInEachStride = 8;
-
-    glBindVertexArray(mesh.vao[5]); // activate vertex array object
-
-    // Activates the first buffer
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[8]);
-    // Sends vertex data to the GPU
-    glBufferData(GL_ARRAY_BUFFER, cylinder3.getInterleavedVertexSize(), cylinder3.getInterleavedVertices(), GL_STATIC_DRAW);
-
-    // activate second buffer for index array
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.vbos[9]);
-    // stores indices[] array on GPU
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, cylinder3.getIndexSize(), cylinder3.getIndices(), GL_STATIC_DRAW);
-
-    // The number of floats that make up a block of vertex data. Should be 32 bytes
-    GLint stride = cylinder3.getInterleavedStride();
-
-    // Create Vertex Attribute Pointers
-    // position attribute -- instructs GPU how to handle vertex position data
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0); // enables the vertex attribute array numbered 0
-    // normals attribute -- instructs GPU how to handle normals data
-    glVertexAttribPointer(1, floatsPerNormals, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1); // enables the vertex attribute array numbered 0
-    // texture coordinate attribute -- instructs GPU how to handle texture coordinates
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2); // enables the vertex attribute array numbered 0
-
-}
-
 // Set up vertex data and populate plane structure for configuration
+// Place Matt (plane) and Handle (cube); Mug, Tea, Plate (cylinders) and Tomato
+// (sphere) are uploaded by the mesh cache
 // -----------------------------------------------------------------------
 void planeMesh() {
 
@@ -1167,13 +1116,15 @@ void planeMesh() {
         -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f,
          0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  1.0f,
          0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  0.0f,
-         0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  0.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  0.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f
+        -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  0.0f
     };
 
+    // 2 triangles sharing the diagonal
+    vector<unsigned short> indices = { 0, 1, 2, 2, 3, 0 };
+
     // populate plane1 struct with this mesh data
     verts.swap(plane1.verts);
+    indices.swap(plane1.indices);
 }
 
 
@@ -1226,21 +1177,15 @@ void cubeMesh() {
         -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  0.0f,
         -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f
     };
-    glm::vec3 glColor3f(1.0f, 0.0f, 0.0f);
+
+    // the 36 vertices in draw order, 2 triangles per face
+    vector<unsigned short> indices(verts.size() / 8);
+    for (size_t i = 0; i < indices.size(); ++i)
+        indices[i] = (unsigned short)i;
 
     // populate cube1 struct with this mesh data
     verts.swap(cube1.verts);
-}
-
-
-
-
-void UDestroyMesh(GLMesh& mesh)
-{
-    // delete the VAOs
-    glDeleteVertexArrays(6, mesh.vao);
-    // delete the VBOs
-    glDeleteBuffers(8, mesh.vbos);
+    indices.swap(cube1.indices);
 }
 
 
@@ -1330,72 +1275,25 @@ void flipImageVertically(unsigned char* image, int width, int height, int channe
 
 
 
-bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint& programId)
+/* ------------------- Look up the uniforms of the shader program -------------------*/
+// Once after linking; the names are not looked up again while rendering
+void UGetUniforms()
 {
-    // Compilation and linkage error reporting
-    int success = 0;
-    char infoLog[512]; // create character string of length 512 for the error log
-
-    // Create a Shader program object.
-    programId = glCreateProgram();
-
-    // Create the vertex and fragment shader objects
-    GLuint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
-    GLuint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
-
-    // Retrive the shader source
-    glShaderSource(vertexShaderId, 1, &vtxShaderSource, NULL);
-    glShaderSource(fragmentShaderId, 1, &fragShaderSource, NULL);
-
-    // Compile the vertex shader, and print compilation errors (if any)
-    glCompileShader(vertexShaderId); // compile the vertex shader
-    // check for shader compile errors
-    glGetShaderiv(vertexShaderId, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(vertexShaderId, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-
-        return false;
-    }
-
-    glCompileShader(fragmentShaderId); // compile the fragment shader
-    // check for shader compile errors
-    glGetShaderiv(fragmentShaderId, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(fragmentShaderId, sizeof(infoLog), NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-
-        return false;
-    }
-
-    // Attached compiled shaders to the shader program
-    glAttachShader(programId, vertexShaderId);
-    glAttachShader(programId, fragmentShaderId);
-
-    glLinkProgram(programId);   // links the shader program
-    // check for linking errors
-    glGetProgramiv(programId, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        glGetProgramInfoLog(programId, sizeof(infoLog), NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-
-        return false;
-    }
-
-    glUseProgram(programId);    // Uses the shader program
-
-    return true;
+    gUniforms.uvScale = gProgram.getUniform<glm::vec2>("uvScale");
+    gUniforms.texture = gProgram.getUniform<int>("uTexture");
+    gUniforms.textureExtra = gProgram.getUniform<int>("uTextureExtra");
+
+    cout << "INFO: Shader program: " << gProgram.getUniformCount() << " active uniforms" << endl;
+
+    // the block is written as a C++ struct, so its layout must match
+    GLint frameDataSize = gProgram.getUniformBlockSize("FrameData");
+    if (frameDataSize != (GLint)sizeof(FrameUniformData))
+        cout << "WARNING: FrameData block is " << frameDataSize << " bytes, FrameUniformData " << sizeof(FrameUniformData) << endl;
+    GLint materialDataSize = gProgram.getUniformBlockSize("MaterialData");
+    if (materialDataSize != (GLint)sizeof(gMaterials))
+        cout << "WARNING: MaterialData block is " << materialDataSize << " bytes, gMaterials " << sizeof(gMaterials) << endl;
 }
 
 
 
-void UDestroyShaderProgram(GLuint programId)
-{
-    glDeleteProgram(programId); // delete the shader program
-}
-
-
 
@@ -4,33 +4,46 @@
 #include <windows.h>    // include windows.h to avoid thousands of compile errors even though this class is not depending on Windows
 #endif
 
-#ifdef __APPLE__
-#include <OpenGL/gl.h>
-#else
-#include <GL/gl.h>
-#endif
+#include <GL/glew.h>
 
 #include <iostream>
 #include <iomanip>
 #include <cmath>
+#include <unordered_map>
 #include "Sphere.h"
+#include "MeshBuilder.h"
+#include "SinCos.h"
+#include "ThreadPool.h"
 
 
 
 // constants //////////////////////////////////////////////////////////////////
 const int MIN_SECTOR_COUNT = 3;
 const int MIN_STACK_COUNT = 2;
+const int MAX_SUBDIVISION_COUNT = 7;                        // 327680 triangles for the icosphere
+const unsigned int MIN_PARALLEL_VERTEX_COUNT = 64 * 1024;   // smaller meshes build faster serially
 
 
 
 ///////////////////////////////////////////////////////////////////////////////
 // ctor
 ///////////////////////////////////////////////////////////////////////////////
-Sphere::Sphere(float radius, int sectors, int stacks, bool smooth) : interleavedStride(32)
+Sphere::Sphere(float radius, int sectors, int stacks, bool smooth, ThreadPool* threadPool)
+    : topology(SPHERE_TOPOLOGY_UV), subdivisionCount(0), threadPool(threadPool)
 {
     set(radius, sectors, stacks, smooth);
 }
 
+Sphere::Sphere(float radius, SphereTopology topology, int subdivisions, bool smooth, ThreadPool* threadPool)
+    : topology(topology), subdivisionCount(subdivisions), threadPool(threadPool)
+{
+    if (subdivisions < 0)
+        subdivisionCount = 0;
+    if (subdivisions > MAX_SUBDIVISION_COUNT)
+        subdivisionCount = MAX_SUBDIVISION_COUNT;
+    set(radius, 36, 18, smooth);
+}
+
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -43,20 +56,27 @@ void Sphere::set(float radius, int sectors, int stacks, bool smooth)
     if (sectors < MIN_SECTOR_COUNT)
         this->sectorCount = MIN_SECTOR_COUNT;
     this->stackCount = stacks;
-    if (sectors < MIN_STACK_COUNT)
-        this->sectorCount = MIN_STACK_COUNT;
+    if (stacks < MIN_STACK_COUNT)
+        this->stackCount = MIN_STACK_COUNT;
     this->smooth = smooth;
 
-    if (smooth)
-        buildVerticesSmooth();
-    else
-        buildVerticesFlat();
+    // generate sin/cos of sector and stack angles first
+    buildRingTables();
+
+    buildVertices();
+    applyStorage();
 }
 
 void Sphere::setRadius(float radius)
 {
-    if (radius != this->radius)
+    if (radius == this->radius)
+        return;
+
+    // a sphere of radius 0 has no directions left to scale
+    if (this->radius == 0)
         set(radius, sectorCount, stackCount, smooth);
+    else
+        updateRadius(radius);
 }
 
 void Sphere::setSectorCount(int sectors)
@@ -77,10 +97,28 @@ void Sphere::setSmooth(bool smooth)
         return;
 
     this->smooth = smooth;
-    if (smooth)
-        buildVerticesSmooth();
-    else
-        buildVerticesFlat();
+    buildVertices();
+    applyStorage();
+}
+
+void Sphere::setTopology(SphereTopology topology, int subdivisions)
+{
+    if (subdivisions < 0)
+        subdivisions = 0;
+    if (subdivisions > MAX_SUBDIVISION_COUNT)
+        subdivisions = MAX_SUBDIVISION_COUNT;
+    if (topology == this->topology && subdivisions == this->subdivisionCount)
+        return;
+
+    this->topology = topology;
+    this->subdivisionCount = subdivisions;
+    buildVertices();
+    applyStorage();
+}
+
+void Sphere::setThreadPool(ThreadPool* pool)
+{
+    threadPool = pool;
 }
 
 
@@ -94,6 +132,9 @@ void Sphere::printSelf() const
         << "        Radius: " << radius << "\n"
         << "  Sector Count: " << sectorCount << "\n"
         << "   Stack Count: " << stackCount << "\n"
+        << "      Topology: " << (topology == SPHERE_TOPOLOGY_ICOSPHERE ? "icosphere"
+                                : (topology == SPHERE_TOPOLOGY_CUBE ? "cube" : "UV")) << "\n"
+        << "  Subdivisions: " << subdivisionCount << "\n"
         << "Smooth Shading: " << (smooth ? "true" : "false") << "\n"
         << "Triangle Count: " << getTriangleCount() << "\n"
         << "   Index Count: " << getIndexCount() << "\n"
@@ -104,107 +145,58 @@ void Sphere::printSelf() const
 
 
 
-///////////////////////////////////////////////////////////////////////////////
-// draw a sphere in VertexArray mode
-// OpenGL RC must be set before calling it
-///////////////////////////////////////////////////////////////////////////////
-void Sphere::draw() const
-{
-    // interleaved array
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glEnableClientState(GL_NORMAL_ARRAY);
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-    glVertexPointer(3, GL_FLOAT, interleavedStride, &interleavedVertices[0]);
-    glNormalPointer(GL_FLOAT, interleavedStride, &interleavedVertices[3]);
-    glTexCoordPointer(2, GL_FLOAT, interleavedStride, &interleavedVertices[6]);
-
-    glDrawElements(GL_TRIANGLES, (unsigned int)indices.size(), GL_UNSIGNED_INT, indices.data());
-
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableClientState(GL_NORMAL_ARRAY);
-    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-}
-
-
-
-///////////////////////////////////////////////////////////////////////////////
-// draw lines only
-// the caller must set the line width before call this
-///////////////////////////////////////////////////////////////////////////////
-void Sphere::drawLines(const float lineColor[4]) const
-{
-    // set line colour
-    glColor4fv(lineColor);
-    glMaterialfv(GL_FRONT, GL_DIFFUSE, lineColor);
-
-    // draw lines with VA
-    glDisable(GL_LIGHTING);
-    glDisable(GL_TEXTURE_2D);
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glVertexPointer(3, GL_FLOAT, 0, vertices.data());
-
-    glDrawElements(GL_LINES, (unsigned int)lineIndices.size(), GL_UNSIGNED_INT, lineIndices.data());
-
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glEnable(GL_LIGHTING);
-    glEnable(GL_TEXTURE_2D);
-}
-
-
-
-///////////////////////////////////////////////////////////////////////////////
-// draw a sphere surfaces and lines on top of it
-// the caller must set the line width before call this
-///////////////////////////////////////////////////////////////////////////////
-void Sphere::drawWithLines(const float lineColor[4]) const
-{
-    glEnable(GL_POLYGON_OFFSET_FILL);
-    glPolygonOffset(1.0, 1.0f); // move polygon backward
-    this->draw();
-    glDisable(GL_POLYGON_OFFSET_FILL);
-
-    // draw lines with VA
-    drawLines(lineColor);
-}
-
-
-
-/*@@ FIXME: when the radius  = 0
 ///////////////////////////////////////////////////////////////////////////////
 // update vertex positions only
+// every position scales with the radius; normals, tex coords and indices stay,
+// so this works in any vertex order (after optimize() too)
 ///////////////////////////////////////////////////////////////////////////////
-void Sphere::updateRadius()
+void Sphere::updateRadius(float radius)
 {
-    float scale = sqrtf(radius * radius / (vertices[0] * vertices[0] + vertices[1] * vertices[1] + vertices[2] * vertices[2]));
+    restoreArrays();
+
+    float scale = radius / this->radius;
+    this->radius = radius;
 
     std::size_t i, j;
     std::size_t count = vertices.size();
-    for(i = 0, j = 0; i < count; i += 3, j += 8)
+    for (i = 0, j = 0; i < count; i += 3, j += 8)
     {
-        vertices[i]   *= scale;
-        vertices[i+1] *= scale;
-        vertices[i+2] *= scale;
+        vertices[i] *= scale;
+        vertices[i + 1] *= scale;
+        vertices[i + 2] *= scale;
 
         // for interleaved array
-        interleavedVertices[j]   *= scale;
-        interleavedVertices[j+1] *= scale;
-        interleavedVertices[j+2] *= scale;
+        interleavedVertices[j] *= scale;
+        interleavedVertices[j + 1] *= scale;
+        interleavedVertices[j + 2] *= scale;
+    }
+    for (i = 0; i < meshlets.size(); ++i)
+    {
+        // normal cones don't change with the scale
+        meshlets[i].center[0] *= scale;
+        meshlets[i].center[1] *= scale;
+        meshlets[i].center[2] *= scale;
+        meshlets[i].radius *= scale;
     }
+    markDirty(0, getVertexCount());
+    applyStorage();
 }
-*/
 
 
 
 ///////////////////////////////////////////////////////////////////////////////
-// dealloc vectors
+// build the mesh for the current topology and shading
 ///////////////////////////////////////////////////////////////////////////////
-void Sphere::clearArrays()
+void Sphere::buildVertices()
 {
-    std::vector<float>().swap(vertices);
-    std::vector<float>().swap(normals);
-    std::vector<float>().swap(texCoords);
-    std::vector<unsigned int>().swap(indices);
-    std::vector<unsigned int>().swap(lineIndices);
+    if (topology == SPHERE_TOPOLOGY_ICOSPHERE)
+        buildVerticesIcosphere();
+    else if (topology == SPHERE_TOPOLOGY_CUBE)
+        buildVerticesCube();
+    else if (smooth)
+        buildVerticesSmooth();
+    else
+        buildVerticesFlat();
 }
 
 
@@ -216,59 +208,87 @@ void Sphere::clearArrays()
 // z = r * sin(u)
 // where u: stack(latitude) angle (-90 <= u <= 90)
 //       v: sector(longitude) angle (0 <= v <= 360)
+//
+// all counts are known from sectors/stacks, so the arrays are sized once and
+// positions, normals, tex coords (separate and interleaved) and indices are
+// written in a single pass
+// with a thread pool, large meshes are split into ranges of stacks built
+// concurrently; every element is still computed by the same expression at the
+// same offset, so the result is identical to the serial build
 ///////////////////////////////////////////////////////////////////////////////
 void Sphere::buildVerticesSmooth()
 {
-    const float PI = acos(-1);
+    // (sectorCount+1) vertices per stack, 2 triangles per sector except 1st/last stacks,
+    // a strip of 2 indices per vertex column per stack, plus restarts in between
+    unsigned int vertexCount = (stackCount + 1) * (sectorCount + 1);
+    unsigned int indexCount = 6 * sectorCount * (stackCount - 1);
+    unsigned int stripIndexCount = stackCount * (2 * sectorCount + 3) - 1;
+    resizeArrays(vertexCount, indexCount, stripIndexCount);
+
+    if (threadPool && vertexCount >= MIN_PARALLEL_VERTEX_COUNT)
+        threadPool->parallelFor(0, stackCount + 1, [this](int first, int last) { buildStacksSmooth(first, last); });
+    else
+        buildStacksSmooth(0, stackCount + 1);
+    packIndices();
+}
 
-    // clear memory of prev arrays
-    clearArrays();
 
+
+///////////////////////////////////////////////////////////////////////////////
+// write the vertex rows [firstStack, lastStack) and the triangles/strips of the
+// stacks starting on those rows into the presized arrays
+// the write offsets depend only on the stack number, so disjoint ranges can be
+// built in any order or at the same time
+///////////////////////////////////////////////////////////////////////////////
+void Sphere::buildStacksSmooth(int firstStack, int lastStack)
+{
     float x, y, z, xy;                              // vertex position
-    float nx, ny, nz, lengthInv = 1.0f / radius;    // normal
+    float lengthInv = 1.0f / radius;                // normal
     float s, t;                                     // texCoord
 
-    float sectorStep = 2 * PI / sectorCount;
-    float stackStep = PI / stackCount;
-    float sectorAngle, stackAngle;
-
-    for (int i = 0; i <= stackCount; ++i)
+    unsigned int index = firstStack * (sectorCount + 1);
+    for (int i = firstStack; i < lastStack; ++i)
     {
-        stackAngle = PI / 2 - i * stackStep;        // starting from pi/2 to -pi/2
-        xy = radius * cosf(stackAngle);             // r * cos(u)
-        z = radius * sinf(stackAngle);              // r * sin(u)
+        xy = radius * stackCosines[i];              // r * cos(u)
+        z = radius * stackSines[i];                 // r * sin(u)
+        t = (float)i / stackCount;
 
         // add (sectorCount+1) vertices per stack
         // the first and last vertices have same position and normal, but different tex coords
-        for (int j = 0; j <= sectorCount; ++j)
+        for (int j = 0; j <= sectorCount; ++j, ++index)
         {
-            sectorAngle = j * sectorStep;           // starting from 0 to 2pi
-
             // vertex position
-            x = xy * cosf(sectorAngle);             // r * cos(u) * cos(v)
-            y = xy * sinf(sectorAngle);             // r * cos(u) * sin(v)
-            addVertex(x, y, z);
-
-            // normalized vertex normal
-            nx = x * lengthInv;
-            ny = y * lengthInv;
-            nz = z * lengthInv;
-            addNormal(nx, ny, nz);
+            x = xy * sectorCosines[j];              // r * cos(u) * cos(v)
+            y = xy * sectorSines[j];                // r * cos(u) * sin(v)
 
             // vertex tex coord between [0, 1]
             s = (float)j / sectorCount;
-            t = (float)i / stackCount;
-            addTexCoord(s, t);
+
+            // position, normalized vertex normal and tex coord
+            setVertex(index, x, y, z, x * lengthInv, y * lengthInv, z * lengthInv, s, t);
         }
     }
 
+    // the last row only closes the stack above it
+    if (lastStack > stackCount)
+        lastStack = stackCount;
+    if (firstStack >= lastStack)
+        return;
+
+    // 1st stack has 3 triangle indices per sector, the others 6
+    // each strip takes 2 indices per column and a restart index after it
+    unsigned int* triangle = indices.data();
+    unsigned int* strip = stripIndices.data() + (2 * sectorCount + 3) * firstStack;
+    if (firstStack > 0)
+        triangle += 3 * sectorCount + 6 * sectorCount * (firstStack - 1);
+
     // indices
     //  k1--k1+1
     //  |  / |
     //  | /  |
     //  k2--k2+1
     unsigned int k1, k2;
-    for (int i = 0; i < stackCount; ++i)
+    for (int i = firstStack; i < lastStack; ++i)
     {
         k1 = i * (sectorCount + 1);     // beginning of current stack
         k2 = k1 + sectorCount + 1;      // beginning of next stack
@@ -278,27 +298,31 @@ void Sphere::buildVerticesSmooth()
             // 2 triangles per sector excluding 1st and last stacks
             if (i != 0)
             {
-                addIndices(k1, k2, k1 + 1);   // k1---k2---k1+1
+                *triangle++ = k1;       // k1---k2---k1+1
+                *triangle++ = k2;
+                *triangle++ = k1 + 1;
             }
 
             if (i != (stackCount - 1))
             {
-                addIndices(k1 + 1, k2, k2 + 1); // k1+1---k2---k2+1
+                *triangle++ = k1 + 1;   // k1+1---k2---k2+1
+                *triangle++ = k2;
+                *triangle++ = k2 + 1;
             }
+        }
 
-            // vertical lines for all stacks
-            lineIndices.push_back(k1);
-            lineIndices.push_back(k2);
-            if (i != 0)  // horizontal lines except 1st stack
-            {
-                lineIndices.push_back(k1);
-                lineIndices.push_back(k1 + 1);
-            }
+        // strip k1, k2, k1+1, k2+1, ... gives the same triangles as above
+        // (the ones touching the poles are degenerate and not rasterized)
+        k1 = i * (sectorCount + 1);
+        k2 = k1 + sectorCount + 1;
+        for (int j = 0; j <= sectorCount; ++j)
+        {
+            *strip++ = k1 + j;
+            *strip++ = k2 + j;
         }
+        if (i != (stackCount - 1))
+            *strip++ = RESTART_INDEX;
     }
-
-    // generate interleaved vertex array as well
-    buildInterleavedVertices();
 }
 
 
@@ -306,281 +330,417 @@ void Sphere::buildVerticesSmooth()
 ///////////////////////////////////////////////////////////////////////////////
 // generate vertices with flat shading
 // each triangle is independent (no shared vertices)
+// the counts are known from sectors/stacks, so the arrays are sized once and
+// every vertex is written in place from the ring tables
 ///////////////////////////////////////////////////////////////////////////////
 void Sphere::buildVerticesFlat()
 {
-    const float PI = acos(-1);
-
-    // tmp vertex definition (x,y,z,s,t)
-    struct Vertex
-    {
-        float x, y, z, s, t;
-    };
-    std::vector<Vertex> tmpVertices;
-
-    float sectorStep = 2 * PI / sectorCount;
-    float stackStep = PI / stackCount;
-    float sectorAngle, stackAngle;
-
-    // compute all vertices first, each vertex contains (x,y,z,s,t) except normal
-    for (int i = 0; i <= stackCount; ++i)
-    {
-        stackAngle = PI / 2 - i * stackStep;        // starting from pi/2 to -pi/2
-        float xy = radius * cosf(stackAngle);       // r * cos(u)
-        float z = radius * sinf(stackAngle);        // r * sin(u)
-
-        // add (sectorCount+1) vertices per stack
-        // the first and last vertices have same position and normal, but different tex coords
-        for (int j = 0; j <= sectorCount; ++j)
-        {
-            sectorAngle = j * sectorStep;           // starting from 0 to 2pi
-
-            Vertex vertex;
-            vertex.x = xy * cosf(sectorAngle);      // x = r * cos(u) * cos(v)
-            vertex.y = xy * sinf(sectorAngle);      // y = r * cos(u) * sin(v)
-            vertex.z = z;                           // z = r * sin(u)
-            vertex.s = (float)j / sectorCount;        // s
-            vertex.t = (float)i / stackCount;         // t
-            tmpVertices.push_back(vertex);
-        }
-    }
-
-    // clear memory of prev arrays
-    clearArrays();
-
-    Vertex v1, v2, v3, v4;                          // 4 vertex positions and tex coords
-    std::vector<float> n;                           // 1 face normal
-
-    int i, j, k, vi1, vi2;
-    int index = 0;                                  // index for vertex
-    for (i = 0; i < stackCount; ++i)
+    // 1st/last stacks: 1 triangle of 3 vertices per sector, others: a quad of 4
+    // same triangle count as smooth shading
+    unsigned int vertexCount = sectorCount * (4 * stackCount - 2);
+    unsigned int indexCount = 6 * sectorCount * (stackCount - 1);
+    resizeArrays(vertexCount, indexCount, 0);
+
+    // 4 vertex positions and tex coords per sector
+    //  v1--v3  <== stack i
+    //  |    |
+    //  v2--v4  <== stack i+1
+    float x1, y1, z1, x2, y2, z2, x3, y3, z3, x4, y4, z4;
+    float s1, s2, t1, t2;
+    float n[3];                                     // 1 face normal
+
+    unsigned int* triangle = indices.data();
+    unsigned int index = 0;                         // index for vertex
+    for (int i = 0; i < stackCount; ++i)
     {
-        vi1 = i * (sectorCount + 1);                // index of tmpVertices
-        vi2 = (i + 1) * (sectorCount + 1);
-
-        for (j = 0; j < sectorCount; ++j, ++vi1, ++vi2)
+        float xy1 = radius * stackCosines[i];       // r * cos(u) of stack i
+        float xy2 = radius * stackCosines[i + 1];
+        z1 = z3 = radius * stackSines[i];           // r * sin(u)
+        z2 = z4 = radius * stackSines[i + 1];
+        t1 = (float)i / stackCount;
+        t2 = (float)(i + 1) / stackCount;
+
+        for (int j = 0; j < sectorCount; ++j)
         {
-            // get 4 vertices per sector
-            //  v1--v3
-            //  |    |
-            //  v2--v4
-            v1 = tmpVertices[vi1];
-            v2 = tmpVertices[vi2];
-            v3 = tmpVertices[vi1 + 1];
-            v4 = tmpVertices[vi2 + 1];
+            x1 = xy1 * sectorCosines[j];
+            y1 = xy1 * sectorSines[j];
+            x2 = xy2 * sectorCosines[j];
+            y2 = xy2 * sectorSines[j];
+            x3 = xy1 * sectorCosines[j + 1];
+            y3 = xy1 * sectorSines[j + 1];
+            x4 = xy2 * sectorCosines[j + 1];
+            y4 = xy2 * sectorSines[j + 1];
+            s1 = (float)j / sectorCount;
+            s2 = (float)(j + 1) / sectorCount;
 
             // if 1st stack and last stack, store only 1 triangle per sector
             // otherwise, store 2 triangles (quad) per sector
             if (i == 0) // a triangle for first stack ==========================
             {
-                // put a triangle
-                addVertex(v1.x, v1.y, v1.z);
-                addVertex(v2.x, v2.y, v2.z);
-                addVertex(v4.x, v4.y, v4.z);
-
-                // put tex coords of triangle
-                addTexCoord(v1.s, v1.t);
-                addTexCoord(v2.s, v2.t);
-                addTexCoord(v4.s, v4.t);
-
-                // put normal
-                n = computeFaceNormal(v1.x, v1.y, v1.z, v2.x, v2.y, v2.z, v4.x, v4.y, v4.z);
-                for (k = 0; k < 3; ++k)  // same normals for 3 vertices
-                {
-                    addNormal(n[0], n[1], n[2]);
-                }
+                computeFaceNormal(x1, y1, z1, x2, y2, z2, x4, y4, z4, n);
+                setVertex(index, x1, y1, z1, n[0], n[1], n[2], s1, t1);
+                setVertex(index + 1, x2, y2, z2, n[0], n[1], n[2], s1, t2);
+                setVertex(index + 2, x4, y4, z4, n[0], n[1], n[2], s2, t2);
 
                 // put indices of 1 triangle
-                addIndices(index, index + 1, index + 2);
-
-                // indices for line (first stack requires only vertical line)
-                lineIndices.push_back(index);
-                lineIndices.push_back(index + 1);
+                *triangle++ = index;
+                *triangle++ = index + 1;
+                *triangle++ = index + 2;
 
                 index += 3;     // for next
             }
             else if (i == (stackCount - 1)) // a triangle for last stack =========
             {
-                // put a triangle
-                addVertex(v1.x, v1.y, v1.z);
-                addVertex(v2.x, v2.y, v2.z);
-                addVertex(v3.x, v3.y, v3.z);
-
-                // put tex coords of triangle
-                addTexCoord(v1.s, v1.t);
-                addTexCoord(v2.s, v2.t);
-                addTexCoord(v3.s, v3.t);
-
-                // put normal
-                n = computeFaceNormal(v1.x, v1.y, v1.z, v2.x, v2.y, v2.z, v3.x, v3.y, v3.z);
-                for (k = 0; k < 3; ++k)  // same normals for 3 vertices
-                {
-                    addNormal(n[0], n[1], n[2]);
-                }
+                computeFaceNormal(x1, y1, z1, x2, y2, z2, x3, y3, z3, n);
+                setVertex(index, x1, y1, z1, n[0], n[1], n[2], s1, t1);
+                setVertex(index + 1, x2, y2, z2, n[0], n[1], n[2], s1, t2);
+                setVertex(index + 2, x3, y3, z3, n[0], n[1], n[2], s2, t1);
 
                 // put indices of 1 triangle
-                addIndices(index, index + 1, index + 2);
-
-                // indices for lines (last stack requires both vert/hori lines)
-                lineIndices.push_back(index);
-                lineIndices.push_back(index + 1);
-                lineIndices.push_back(index);
-                lineIndices.push_back(index + 2);
+                *triangle++ = index;
+                *triangle++ = index + 1;
+                *triangle++ = index + 2;
 
                 index += 3;     // for next
             }
             else // 2 triangles for others ====================================
             {
                 // put quad vertices: v1-v2-v3-v4
-                addVertex(v1.x, v1.y, v1.z);
-                addVertex(v2.x, v2.y, v2.z);
-                addVertex(v3.x, v3.y, v3.z);
-                addVertex(v4.x, v4.y, v4.z);
-
-                // put tex coords of quad
-                addTexCoord(v1.s, v1.t);
-                addTexCoord(v2.s, v2.t);
-                addTexCoord(v3.s, v3.t);
-                addTexCoord(v4.s, v4.t);
-
-                // put normal
-                n = computeFaceNormal(v1.x, v1.y, v1.z, v2.x, v2.y, v2.z, v3.x, v3.y, v3.z);
-                for (k = 0; k < 4; ++k)  // same normals for 4 vertices
-                {
-                    addNormal(n[0], n[1], n[2]);
-                }
+                computeFaceNormal(x1, y1, z1, x2, y2, z2, x3, y3, z3, n);
+                setVertex(index, x1, y1, z1, n[0], n[1], n[2], s1, t1);
+                setVertex(index + 1, x2, y2, z2, n[0], n[1], n[2], s1, t2);
+                setVertex(index + 2, x3, y3, z3, n[0], n[1], n[2], s2, t1);
+                setVertex(index + 3, x4, y4, z4, n[0], n[1], n[2], s2, t2);
 
                 // put indices of quad (2 triangles)
-                addIndices(index, index + 1, index + 2);
-                addIndices(index + 2, index + 1, index + 3);
-
-                // indices for lines
-                lineIndices.push_back(index);
-                lineIndices.push_back(index + 1);
-                lineIndices.push_back(index);
-                lineIndices.push_back(index + 2);
+                *triangle++ = index;
+                *triangle++ = index + 1;
+                *triangle++ = index + 2;
+                *triangle++ = index + 2;
+                *triangle++ = index + 1;
+                *triangle++ = index + 3;
 
                 index += 4;     // for next
             }
         }
     }
 
-    // generate interleaved vertex array as well
-    buildInterleavedVertices();
+    packIndices();
 }
 
 
 
 ///////////////////////////////////////////////////////////////////////////////
-// generate interleaved vertices: V/N/T
-// stride must be 32 bytes
+// build an icosphere: start from an icosahedron with a vertex at each pole and
+// 2 rings of 5 vertices at latitude +-atan(1/2), then split every triangle into
+// 4 per subdivision, pushing the edge midpoints out to the unit sphere
+// every triangle has about the same size, unlike the UV sphere whose triangles
+// shrink to slivers near the poles
 ///////////////////////////////////////////////////////////////////////////////
-void Sphere::buildInterleavedVertices()
+void Sphere::buildVerticesIcosphere()
 {
-    std::vector<float>().swap(interleavedVertices);
-
-    std::size_t i, j;
-    std::size_t count = vertices.size();
-    for (i = 0, j = 0; i < count; i += 3, j += 2)
+    const float PI = acos(-1);
+    const float ringZ = 1.0f / sqrtf(5.0f);         // sin(atan(1/2))
+    const float ringXY = 2.0f / sqrtf(5.0f);        // cos(atan(1/2))
+
+    // 10 * 4^n + 2 points and 20 * 4^n triangles after n subdivisions
+    std::vector<float> points;
+    std::vector<unsigned int> triangles;
+    points.reserve((10 * ((std::size_t)1 << (2 * subdivisionCount)) + 2) * 3);
+    triangles.reserve(60 * ((std::size_t)1 << (2 * subdivisionCount)));
+
+    // north pole (0), upper ring (1-5), lower ring (6-10) rotated by 36 degrees, south pole (11)
+    points.insert(points.end(), { 0, 0, 1 });
+    for (int k = 0; k < 5; ++k)
+        points.insert(points.end(), { ringXY * cosf(k * 2 * PI / 5), ringXY * sinf(k * 2 * PI / 5), ringZ });
+    for (int k = 0; k < 5; ++k)
+        points.insert(points.end(), { ringXY * cosf((k * 2 + 1) * PI / 5), ringXY * sinf((k * 2 + 1) * PI / 5), -ringZ });
+    points.insert(points.end(), { 0, 0, -1 });
+
+    // counter-clockwise seen from outside
+    for (unsigned int k = 0; k < 5; ++k)
     {
-        interleavedVertices.push_back(vertices[i]);
-        interleavedVertices.push_back(vertices[i + 1]);
-        interleavedVertices.push_back(vertices[i + 2]);
+        unsigned int u1 = 1 + k, u2 = 1 + (k + 1) % 5;
+        unsigned int l1 = 6 + k, l2 = 6 + (k + 1) % 5;
+        triangles.insert(triangles.end(), { 0, u1, u2 });
+        triangles.insert(triangles.end(), { u1, l1, u2 });
+        triangles.insert(triangles.end(), { u2, l1, l2 });
+        triangles.insert(triangles.end(), { 11, l2, l1 });
+    }
 
-        interleavedVertices.push_back(normals[i]);
-        interleavedVertices.push_back(normals[i + 1]);
-        interleavedVertices.push_back(normals[i + 2]);
+    // split a-b-c into 4 at the edge midpoints ab, bc, ca:
+    // a-ab-ca, ab-b-bc, ca-bc-c and the middle one ab-bc-ca
+    std::unordered_map<unsigned long long, unsigned int> midpoints;
+    std::vector<unsigned int> subdivided;
+    for (int n = 0; n < subdivisionCount; ++n)
+    {
+        midpoints.clear();
+        subdivided.clear();
+        subdivided.reserve(triangles.size() * 4);
 
-        interleavedVertices.push_back(texCoords[j]);
-        interleavedVertices.push_back(texCoords[j + 1]);
+        // shared edges get the same midpoint from both of their triangles
+        auto midpoint = [&points, &midpoints](unsigned int i1, unsigned int i2)
+        {
+            unsigned long long key = i1 < i2 ? ((unsigned long long)i1 << 32) | i2
+                                             : ((unsigned long long)i2 << 32) | i1;
+            std::unordered_map<unsigned long long, unsigned int>::iterator it = midpoints.find(key);
+            if (it != midpoints.end())
+                return it->second;
+
+            float x = points[i1 * 3] + points[i2 * 3];
+            float y = points[i1 * 3 + 1] + points[i2 * 3 + 1];
+            float z = points[i1 * 3 + 2] + points[i2 * 3 + 2];
+            float lengthInv = 1.0f / sqrtf(x * x + y * y + z * z);
+            unsigned int index = (unsigned int)points.size() / 3;
+            points.insert(points.end(), { x * lengthInv, y * lengthInv, z * lengthInv });
+            midpoints[key] = index;
+            return index;
+        };
+
+        for (std::size_t i = 0; i < triangles.size(); i += 3)
+        {
+            unsigned int a = triangles[i], b = triangles[i + 1], c = triangles[i + 2];
+            unsigned int ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+            subdivided.insert(subdivided.end(), { a, ab, ca });
+            subdivided.insert(subdivided.end(), { ab, b, bc });
+            subdivided.insert(subdivided.end(), { ca, bc, c });
+            subdivided.insert(subdivided.end(), { ab, bc, ca });
+        }
+        triangles.swap(subdivided);
     }
+
+    buildFromUnitTriangles(points, triangles);
 }
 
 
 
 ///////////////////////////////////////////////////////////////////////////////
-// add single vertex to array
+// build a cube sphere: 6 cube faces of 2^n x 2^n quads projected onto the sphere
+// the grid is spaced by tan() of the angle across the face, so the quads keep
+// about the same size from face centre to face corner
+// points on cube edges/corners are shared by the faces meeting there, found by
+// their integer grid coordinates
 ///////////////////////////////////////////////////////////////////////////////
-void Sphere::addVertex(float x, float y, float z)
+void Sphere::buildVerticesCube()
 {
-    vertices.push_back(x);
-    vertices.push_back(y);
-    vertices.push_back(z);
-}
+    const float PI = acos(-1);
+    const int n = 1 << subdivisionCount;            // quads per face edge
+
+    // face normal N and axes U, V with U x V = N, so the quads face outwards
+    const int FACES[6][3][3] = {
+        { {  1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } },
+        { { -1, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 } },
+        { { 0,  1, 0 }, { 0, 0, 1 }, { 1, 0, 0 } },
+        { { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+        { { 0, 0,  1 }, { 1, 0, 0 }, { 0, 1, 0 } },
+        { { 0, 0, -1 }, { 0, 1, 0 }, { 1, 0, 0 } }
+    };
 
+    // grid coordinate -n...n to a point on the cube [-1, 1], spaced evenly in angle
+    std::vector<float> warp(2 * n + 1);
+    for (int i = 0; i <= 2 * n; ++i)
+        warp[i] = tanf((float)(i - n) / n * PI / 4);
 
+    std::vector<float> points;
+    std::vector<unsigned int> triangles;
+    points.reserve((6 * n * n + 2) * 3);
+    triangles.reserve(36 * n * n);
 
-///////////////////////////////////////////////////////////////////////////////
-// add single normal to array
-///////////////////////////////////////////////////////////////////////////////
-void Sphere::addNormal(float nx, float ny, float nz)
-{
-    normals.push_back(nx);
-    normals.push_back(ny);
-    normals.push_back(nz);
-}
+    std::unordered_map<int, unsigned int> pointIndices;     // grid coordinates to point
+    std::vector<unsigned int> grid((n + 1) * (n + 1));       // points of the current face
+    for (int f = 0; f < 6; ++f)
+    {
+        const int* N = FACES[f][0];
+        const int* U = FACES[f][1];
+        const int* V = FACES[f][2];
+        for (int j = 0; j <= n; ++j)
+        {
+            for (int i = 0; i <= n; ++i)
+            {
+                int c[3];
+                for (int k = 0; k < 3; ++k)
+                    c[k] = n * N[k] + (2 * i - n) * U[k] + (2 * j - n) * V[k];
 
+                int key = ((c[0] + n) * (2 * n + 1) + (c[1] + n)) * (2 * n + 1) + (c[2] + n);
+                std::unordered_map<int, unsigned int>::iterator it = pointIndices.find(key);
+                if (it == pointIndices.end())
+                {
+                    float x = warp[c[0] + n], y = warp[c[1] + n], z = warp[c[2] + n];
+                    float lengthInv = 1.0f / sqrtf(x * x + y * y + z * z);
+                    it = pointIndices.insert(std::make_pair(key, (unsigned int)points.size() / 3)).first;
+                    points.insert(points.end(), { x * lengthInv, y * lengthInv, z * lengthInv });
+                }
+                grid[j * (n + 1) + i] = it->second;
+            }
+        }
 
+        //  k3--k4   (j+1)
+        //  |  / |
+        //  | /  |
+        //  k1--k2   (j)
+        for (int j = 0; j < n; ++j)
+        {
+            for (int i = 0; i < n; ++i)
+            {
+                unsigned int k1 = grid[j * (n + 1) + i];
+                unsigned int k2 = grid[j * (n + 1) + i + 1];
+                unsigned int k3 = grid[(j + 1) * (n + 1) + i];
+                unsigned int k4 = grid[(j + 1) * (n + 1) + i + 1];
+                triangles.insert(triangles.end(), { k1, k2, k4 });
+                triangles.insert(triangles.end(), { k1, k4, k3 });
+            }
+        }
+    }
 
-///////////////////////////////////////////////////////////////////////////////
-// add single texture coord to array
-///////////////////////////////////////////////////////////////////////////////
-void Sphere::addTexCoord(float s, float t)
-{
-    texCoords.push_back(s);
-    texCoords.push_back(t);
+    buildFromUnitTriangles(points, triangles);
 }
 
 
 
 ///////////////////////////////////////////////////////////////////////////////
-// add 3 indices to array
+// make the vertex and index arrays from triangles on the unit sphere
+// tex coords are longitude/latitude as on the UV sphere:
+//   s = atan2(y, x) / 2pi, t = acos(z) / pi
+// points are split into several vertices where the tex coords jump
+// - at the seam (s = 0 = 1): triangles crossing it take s + 1 on the small side
+// - at the poles (s undefined): one vertex per triangle, with s in the middle
+//   of the triangle's other 2 vertices
 ///////////////////////////////////////////////////////////////////////////////
-void Sphere::addIndices(unsigned int i1, unsigned int i2, unsigned int i3)
+void Sphere::buildFromUnitTriangles(const std::vector<float>& points, const std::vector<unsigned int>& triangles)
 {
-    indices.push_back(i1);
-    indices.push_back(i2);
-    indices.push_back(i3);
+    const float PI = acos(-1);
+    const unsigned int NONE = 0xFFFFFFFF;
+    std::size_t pointCount = points.size() / 3;
+    std::size_t triangleCount = triangles.size() / 3;
+
+    std::vector<float> pointS(pointCount);
+    std::vector<float> pointT(pointCount);
+    std::vector<bool> poles(pointCount);
+    for (std::size_t i = 0; i < pointCount; ++i)
+    {
+        float x = points[i * 3], y = points[i * 3 + 1], z = points[i * 3 + 2];
+        float s = atan2f(y, x) / (2 * PI);
+        pointS[i] = s < 0 ? s + 1 : s;
+        pointT[i] = acosf(z > 1 ? 1 : (z < -1 ? -1 : z)) / PI;
+        poles[i] = x * x + y * y < 1e-12f;
+    }
+
+    // pick a vertex (point + s) for every corner
+    std::vector<unsigned int> vertexPoints;         // point of each vertex
+    std::vector<float> vertexS;
+    std::vector<unsigned int> corners(triangles.size());
+    std::vector<unsigned int> firstVertex(pointCount, NONE);
+    std::vector<unsigned int> wrappedVertex(pointCount, NONE);     // copy with s + 1
+    vertexPoints.reserve(pointCount + pointCount / 8);
+    vertexS.reserve(pointCount + pointCount / 8);
+    for (std::size_t i = 0; i < triangleCount; ++i)
+    {
+        const unsigned int* p = &triangles[i * 3];
+        float minS = 1, maxS = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            if (!poles[p[k]])
+            {
+                minS = pointS[p[k]] < minS ? pointS[p[k]] : minS;
+                maxS = pointS[p[k]] > maxS ? pointS[p[k]] : maxS;
+            }
+        }
+        bool crossesSeam = maxS - minS > 0.5f;
+
+        float s[3];
+        float sumS = 0;
+        int count = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            s[k] = pointS[p[k]];
+            if (crossesSeam && s[k] < 0.5f)
+                s[k] += 1;
+            if (!poles[p[k]])
+            {
+                sumS += s[k];
+                ++count;
+            }
+        }
+
+        for (int k = 0; k < 3; ++k)
+        {
+            unsigned int vertex;
+            if (poles[p[k]])
+            {
+                vertex = (unsigned int)vertexPoints.size();
+                vertexPoints.push_back(p[k]);
+                vertexS.push_back(count > 0 ? sumS / count : 0.5f);
+            }
+            else
+            {
+                std::vector<unsigned int>& copies = s[k] > pointS[p[k]] ? wrappedVertex : firstVertex;
+                if (copies[p[k]] == NONE)
+                {
+                    copies[p[k]] = (unsigned int)vertexPoints.size();
+                    vertexPoints.push_back(p[k]);
+                    vertexS.push_back(s[k]);
+                }
+                vertex = copies[p[k]];
+            }
+            corners[i * 3 + k] = vertex;
+        }
+    }
+
+    unsigned int indexCount = (unsigned int)triangles.size();
+    if (smooth)
+    {
+        // shared vertices, normal = point on the unit sphere
+        unsigned int vertexCount = (unsigned int)vertexPoints.size();
+        resizeArrays(vertexCount, indexCount, 0);
+        for (unsigned int i = 0; i < vertexCount; ++i)
+        {
+            const float* n = &points[vertexPoints[i] * 3];
+            setVertex(i, radius * n[0], radius * n[1], radius * n[2], n[0], n[1], n[2],
+                vertexS[i], pointT[vertexPoints[i]]);
+        }
+        indices.assign(corners.begin(), corners.end());
+    }
+    else
+    {
+        // 3 vertices per triangle with the face normal
+        resizeArrays(indexCount, indexCount, 0);
+        for (unsigned int i = 0; i < indexCount; i += 3)
+        {
+            const float* p1 = &points[triangles[i] * 3];
+            const float* p2 = &points[triangles[i + 1] * 3];
+            const float* p3 = &points[triangles[i + 2] * 3];
+            float n[3];
+            computeFaceNormal(p1[0], p1[1], p1[2], p2[0], p2[1], p2[2], p3[0], p3[1], p3[2], n);
+            for (unsigned int k = 0; k < 3; ++k)
+            {
+                unsigned int vertex = corners[i + k];
+                const float* p = &points[vertexPoints[vertex] * 3];
+                setVertex(i + k, radius * p[0], radius * p[1], radius * p[2], n[0], n[1], n[2],
+                    vertexS[vertex], pointT[vertexPoints[vertex]]);
+                indices[i + k] = i + k;
+            }
+        }
+    }
+
+    packIndices();
 }
 
 
 
 ///////////////////////////////////////////////////////////////////////////////
-// return face normal of a triangle v1-v2-v3
-// if a triangle has no surface (normal length = 0), then return a zero vector
+// compute sin/cos of every sector angle (0 to 2pi) and stack angle (pi/2 to -pi/2)
+// once, so the builders only multiply per vertex
 ///////////////////////////////////////////////////////////////////////////////
-std::vector<float> Sphere::computeFaceNormal(float x1, float y1, float z1,  // v1
-    float x2, float y2, float z2,  // v2
-    float x3, float y3, float z3)  // v3
+void Sphere::buildRingTables()
 {
-    const float EPSILON = 0.000001f;
-
-    std::vector<float> normal(3, 0.0f);     // default return value (0,0,0)
-    float nx, ny, nz;
-
-    // find 2 edge vectors: v1-v2, v1-v3
-    float ex1 = x2 - x1;
-    float ey1 = y2 - y1;
-    float ez1 = z2 - z1;
-    float ex2 = x3 - x1;
-    float ey2 = y3 - y1;
-    float ez2 = z3 - z1;
-
-    // cross product: e1 x e2
-    nx = ey1 * ez2 - ez1 * ey2;
-    ny = ez1 * ex2 - ex1 * ez2;
-    nz = ex1 * ey2 - ey1 * ex2;
-
-    // normalize only if the length is > 0
-    float length = sqrtf(nx * nx + ny * ny + nz * nz);
-    if (length > EPSILON)
-    {
-        // normalize
-        float lengthInv = 1.0f / length;
-        normal[0] = nx * lengthInv;
-        normal[1] = ny * lengthInv;
-        normal[2] = nz * lengthInv;
-    }
+    const float PI = acos(-1);
+    float sectorStep = 2 * PI / sectorCount;
+    float stackStep = PI / stackCount;
 
-    return normal;
+    sectorSines.resize(sectorCount + 1);
+    sectorCosines.resize(sectorCount + 1);
+    stackSines.resize(stackCount + 1);
+    stackCosines.resize(stackCount + 1);
+    computeSinCosRing(0, sectorStep, sectorCount + 1, sectorSines.data(), sectorCosines.data());
+    computeSinCosRing(PI / 2, -stackStep, stackCount + 1, stackSines.data(), stackCosines.data());
 }
@@ -0,0 +1,78 @@
+#pragma once
+// Source: Song Ho Ahn - http://www.songho.ca/opengl/gl_sphere.html
+
+#ifndef GEOMETRY_SPHERE_H
+#define GEOMETRY_SPHERE_H
+
+#include <vector>
+#include "IndexedMesh.h"
+
+class ThreadPool;
+
+// layout of the triangles on the sphere surface
+enum SphereTopology
+{
+    SPHERE_TOPOLOGY_UV,                     // sectors x stacks grid, dense at the poles
+    SPHERE_TOPOLOGY_ICOSPHERE,              // subdivided icosahedron, 20 * 4^n triangles
+    SPHERE_TOPOLOGY_CUBE                    // cube of 6 faces with 2^n x 2^n quads, projected out
+};
+
+// storage, indices, dirty ranges, GPU buffers and drawing: see IndexedMesh.h
+// strips are only built for smooth shading of the UV topology
+class Sphere : public IndexedMesh
+{
+public:
+    // ctor/dtor
+    Sphere(float radius = 1.0f, int sectorCount = 36, int stackCount = 18, bool smooth = true,
+        ThreadPool* threadPool = nullptr);
+    Sphere(float radius, SphereTopology topology, int subdivisionCount, bool smooth = true,
+        ThreadPool* threadPool = nullptr);
+    ~Sphere() {}
+
+    // getters/setters
+    float getRadius() const { return radius; }
+    int getSectorCount() const { return sectorCount; }
+    int getStackCount() const { return stackCount; }
+    SphereTopology getTopology() const { return topology; }
+    int getSubdivisionCount() const { return subdivisionCount; }   // icosphere/cube only
+    float getBoundingRadius() const { return radius; }     // about the centre
+    void set(float radius, int sectorCount, int stackCount, bool smooth = true);
+    void setRadius(float radius);           // scales the vertices in place and keeps the meshlet bounds, others rebuild
+    void setSectorCount(int sectorCount);
+    void setStackCount(int stackCount);
+    void setSmooth(bool smooth);
+    void setTopology(SphereTopology topology, int subdivisionCount = 3);
+    ThreadPool* getThreadPool() const { return threadPool; }
+    void setThreadPool(ThreadPool* pool);   // used from the next build on, nullptr = serial
+
+    // debug
+    void printSelf() const;
+
+    // member functions
+    void buildVertices() override;
+    bool hasGridTexCoords() const override { return topology == SPHERE_TOPOLOGY_UV; }
+    void buildVerticesSmooth();
+    void buildStacksSmooth(int firstStack, int lastStack);
+    void buildVerticesFlat();
+    void buildVerticesIcosphere();
+    void buildVerticesCube();
+    void buildFromUnitTriangles(const std::vector<float>& points, const std::vector<unsigned int>& triangles);
+    void buildRingTables();
+    void updateRadius(float radius);
+
+    // memeber vars
+    float radius;
+    int sectorCount;                        // longitude, # of slices
+    int stackCount;                         // latitude, # of stacks
+    bool smooth;
+    SphereTopology topology;
+    int subdivisionCount;                   // icosphere: 4x triangles per step, cube: 2x quads per face edge
+    ThreadPool* threadPool;                 // not owned; splits large smooth builds by stacks
+    std::vector<float> sectorSines;         // sin/cos of sector angles, sectorCount+1
+    std::vector<float> sectorCosines;
+    std::vector<float> stackSines;          // sin/cos of stack angles, stackCount+1
+    std::vector<float> stackCosines;
+
+};
+
+#endif
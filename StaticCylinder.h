@@ -0,0 +1,222 @@
+#pragma once
+// Compile-time cylinder with fixed tessellation
+// generates the same smooth-shaded mesh as
+// Cylinder(baseRadius, topRadius, height, Sectors, Stacks, true) into constexpr
+// std::arrays, so a constexpr instance is baked into read-only data:
+//
+//     constexpr StaticCylinder<25, 8> mug(1.0f, 1.5f, 2.0f);
+
+#ifndef GEOMETRY_STATIC_CYLINDER_H
+#define GEOMETRY_STATIC_CYLINDER_H
+
+#include <array>
+#include <type_traits>
+#include "StaticMath.h"
+
+template<int Sectors, int Stacks>
+class StaticCylinder
+{
+public:
+    static_assert(Sectors >= 3, "a cylinder needs at least 3 sectors");
+    static_assert(Stacks >= 1, "a cylinder needs at least 1 stack");
+
+    static constexpr unsigned int SIDE_VERTEX_COUNT = (Stacks + 1) * (Sectors + 1);
+    static constexpr unsigned int VERTEX_COUNT = SIDE_VERTEX_COUNT + 2 * (Sectors + 1);
+    static constexpr unsigned int BASE_INDEX = 6 * Sectors * Stacks;
+    static constexpr unsigned int TOP_INDEX = BASE_INDEX + 3 * Sectors;
+    static constexpr unsigned int INDEX_COUNT = TOP_INDEX + 3 * Sectors;
+    static constexpr unsigned int LINE_INDEX_COUNT = Sectors * (4 * Stacks + 2);
+
+    // 16-bit indices whenever every vertex can be addressed with them (0xFFFF stays free)
+    typedef typename std::conditional<VERTEX_COUNT <= 0xFFFF, unsigned short, unsigned int>::type IndexType;
+    static constexpr unsigned int INDEX_TYPE = VERTEX_COUNT <= 0xFFFF ? 0x1403 : 0x1405;   // GL_UNSIGNED_SHORT : GL_UNSIGNED_INT
+
+    // ctor
+    constexpr StaticCylinder(float baseRadius = 1.0f, float topRadius = 1.0f, float height = 1.0f)
+        : baseRadius(baseRadius), topRadius(topRadius), height(height)
+    {
+        buildVertices();
+        buildIndices();
+    }
+
+    // getters
+    constexpr float getBaseRadius() const { return baseRadius; }
+    constexpr float getTopRadius() const { return topRadius; }
+    constexpr float getHeight() const { return height; }
+    constexpr int getSectorCount() const { return Sectors; }
+    constexpr int getStackCount() const { return Stacks; }
+
+    // for vertex data
+    constexpr unsigned int getVertexCount() const { return VERTEX_COUNT; }
+    constexpr unsigned int getNormalCount() const { return VERTEX_COUNT; }
+    constexpr unsigned int getTexCoordCount() const { return VERTEX_COUNT; }
+    constexpr unsigned int getIndexCount() const { return INDEX_COUNT; }
+    constexpr unsigned int getLineIndexCount() const { return LINE_INDEX_COUNT; }
+    constexpr unsigned int getTriangleCount() const { return INDEX_COUNT / 3; }
+    constexpr unsigned int getVertexSize() const { return VERTEX_COUNT * 3 * sizeof(float); }
+    constexpr unsigned int getNormalSize() const { return VERTEX_COUNT * 3 * sizeof(float); }
+    constexpr unsigned int getTexCoordSize() const { return VERTEX_COUNT * 2 * sizeof(float); }
+    constexpr unsigned int getIndexSize() const { return INDEX_COUNT * sizeof(IndexType); }
+    constexpr unsigned int getLineIndexSize() const { return LINE_INDEX_COUNT * sizeof(IndexType); }
+    constexpr const float* getVertices() const { return vertices.data(); }
+    constexpr const float* getNormals() const { return normals.data(); }
+    constexpr const float* getTexCoords() const { return texCoords.data(); }
+    constexpr const IndexType* getIndices() const { return indices.data(); }
+    constexpr const IndexType* getLineIndices() const { return lineIndices.data(); }
+    constexpr unsigned int getIndexType() const { return INDEX_TYPE; }
+
+    // for interleaved vertices: V/N/T
+    constexpr unsigned int getInterleavedVertexCount() const { return VERTEX_COUNT; }
+    constexpr unsigned int getInterleavedVertexSize() const { return VERTEX_COUNT * 8 * sizeof(float); }
+    constexpr int getInterleavedStride() const { return 32; }
+    constexpr const float* getInterleavedVertices() const { return interleavedVertices.data(); }
+
+    // for indices of base/top/side parts
+    constexpr unsigned int getBaseIndexCount() const { return TOP_INDEX - BASE_INDEX; }
+    constexpr unsigned int getTopIndexCount() const { return INDEX_COUNT - TOP_INDEX; }
+    constexpr unsigned int getSideIndexCount() const { return BASE_INDEX; }
+    constexpr unsigned int getBaseStartIndex() const { return BASE_INDEX; }
+    constexpr unsigned int getTopStartIndex() const { return TOP_INDEX; }
+    constexpr unsigned int getSideStartIndex() const { return 0; }
+
+private:
+    // same layout as Cylinder::buildVerticesSmooth(): side, base cap, top cap
+    constexpr void buildVertices()
+    {
+        float sectorStep = 2 * STATIC_PI / Sectors;
+
+        // unit circle on XY plane
+        std::array<float, Sectors + 1> circleX{};
+        std::array<float, Sectors + 1> circleY{};
+        for (int j = 0; j <= Sectors; ++j)
+        {
+            float sectorAngle = j * sectorStep;
+            circleX[j] = (float)staticCos(sectorAngle);
+            circleY[j] = (float)staticSin(sectorAngle);
+        }
+
+        // side normal at 0 degree: (cos(a), 0, sin(a)) with tan(a) = (baseRadius-topRadius) / height
+        double slope = baseRadius - topRadius;
+        double length = staticSqrt(slope * slope + (double)height * height);
+        float x0 = length > 0 ? (float)(height / length) : 1.0f;
+        float z0 = length > 0 ? (float)(slope / length) : 0.0f;
+
+        unsigned int index = 0;
+        for (int i = 0; i <= Stacks; ++i)
+        {
+            float z = -(height * 0.5f) + (float)i / Stacks * height;
+            float radius = baseRadius + (float)i / Stacks * (topRadius - baseRadius);
+            float t = 1.0f - (float)i / Stacks;
+
+            for (int j = 0; j <= Sectors; ++j, ++index)
+            {
+                setVertex(index, circleX[j] * radius, circleY[j] * radius, z,
+                    circleX[j] * x0, circleY[j] * x0, z0, (float)j / Sectors, t);
+            }
+        }
+
+        // base cap
+        float z = -height * 0.5f;
+        setVertex(index++, 0, 0, z, 0, 0, -1, 0.5f, 0.5f);
+        for (int j = 0; j < Sectors; ++j, ++index)
+        {
+            setVertex(index, circleX[j] * baseRadius, circleY[j] * baseRadius, z, 0, 0, -1,
+                -circleX[j] * 0.5f + 0.5f, -circleY[j] * 0.5f + 0.5f);
+        }
+
+        // top cap
+        z = height * 0.5f;
+        setVertex(index++, 0, 0, z, 0, 0, 1, 0.5f, 0.5f);
+        for (int j = 0; j < Sectors; ++j, ++index)
+        {
+            setVertex(index, circleX[j] * topRadius, circleY[j] * topRadius, z, 0, 0, 1,
+                circleX[j] * 0.5f + 0.5f, -circleY[j] * 0.5f + 0.5f);
+        }
+    }
+
+    constexpr void buildIndices()
+    {
+        unsigned int triangle = 0;
+        unsigned int line = 0;
+
+        // sides
+        for (int i = 0; i < Stacks; ++i)
+        {
+            unsigned int k1 = i * (Sectors + 1);
+            unsigned int k2 = k1 + Sectors + 1;
+
+            for (int j = 0; j < Sectors; ++j, ++k1, ++k2)
+            {
+                indices[triangle++] = (IndexType)k1;
+                indices[triangle++] = (IndexType)(k1 + 1);
+                indices[triangle++] = (IndexType)k2;
+                indices[triangle++] = (IndexType)k2;
+                indices[triangle++] = (IndexType)(k1 + 1);
+                indices[triangle++] = (IndexType)(k2 + 1);
+
+                lineIndices[line++] = (IndexType)k1;
+                lineIndices[line++] = (IndexType)k2;
+                lineIndices[line++] = (IndexType)k2;
+                lineIndices[line++] = (IndexType)(k2 + 1);
+                if (i == 0)
+                {
+                    lineIndices[line++] = (IndexType)k1;
+                    lineIndices[line++] = (IndexType)(k1 + 1);
+                }
+            }
+        }
+
+        // base cap (fan around the centre vertex)
+        unsigned int baseVertexIndex = SIDE_VERTEX_COUNT;
+        for (unsigned int i = 0, k = baseVertexIndex + 1; i < (unsigned int)Sectors; ++i, ++k)
+        {
+            indices[triangle++] = (IndexType)baseVertexIndex;
+            indices[triangle++] = (IndexType)(i < Sectors - 1u ? k + 1 : baseVertexIndex + 1);
+            indices[triangle++] = (IndexType)k;
+        }
+
+        // top cap
+        unsigned int topVertexIndex = SIDE_VERTEX_COUNT + Sectors + 1;
+        for (unsigned int i = 0, k = topVertexIndex + 1; i < (unsigned int)Sectors; ++i, ++k)
+        {
+            indices[triangle++] = (IndexType)topVertexIndex;
+            indices[triangle++] = (IndexType)k;
+            indices[triangle++] = (IndexType)(i < Sectors - 1u ? k + 1 : topVertexIndex + 1);
+        }
+    }
+
+    constexpr void setVertex(unsigned int index, float x, float y, float z,
+        float nx, float ny, float nz, float s, float t)
+    {
+        vertices[index * 3] = x;
+        vertices[index * 3 + 1] = y;
+        vertices[index * 3 + 2] = z;
+        normals[index * 3] = nx;
+        normals[index * 3 + 1] = ny;
+        normals[index * 3 + 2] = nz;
+        texCoords[index * 2] = s;
+        texCoords[index * 2 + 1] = t;
+
+        interleavedVertices[index * 8] = x;
+        interleavedVertices[index * 8 + 1] = y;
+        interleavedVertices[index * 8 + 2] = z;
+        interleavedVertices[index * 8 + 3] = nx;
+        interleavedVertices[index * 8 + 4] = ny;
+        interleavedVertices[index * 8 + 5] = nz;
+        interleavedVertices[index * 8 + 6] = s;
+        interleavedVertices[index * 8 + 7] = t;
+    }
+
+    // memeber vars
+    float baseRadius;
+    float topRadius;
+    float height;
+    std::array<float, VERTEX_COUNT * 3> vertices{};
+    std::array<float, VERTEX_COUNT * 3> normals{};
+    std::array<float, VERTEX_COUNT * 2> texCoords{};
+    std::array<IndexType, INDEX_COUNT> indices{};
+    std::array<IndexType, LINE_INDEX_COUNT> lineIndices{};
+    std::array<float, VERTEX_COUNT * 8> interleavedVertices{};
+};
+
+#endif
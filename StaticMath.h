@@ -0,0 +1,77 @@
+#pragma once
+// constexpr math for compile-time geometry (StaticSphere, StaticCylinder)
+// evaluated in double precision, then rounded to float by the callers
+
+#ifndef GEOMETRY_STATIC_MATH_H
+#define GEOMETRY_STATIC_MATH_H
+
+// same value as the runtime builders' acos(-1) rounded to float
+constexpr float STATIC_PI = 3.14159265358979323846f;
+
+// sine of |x| <= pi/4 with Taylor series up to x^17
+constexpr double staticSinReduced(double x)
+{
+    double x2 = x * x;
+    double term = x;
+    double sum = x;
+    for (int n = 1; n <= 8; ++n)
+    {
+        term *= -x2 / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+// cosine of |x| <= pi/4 with Taylor series up to x^16
+constexpr double staticCosReduced(double x)
+{
+    double x2 = x * x;
+    double term = 1.0;
+    double sum = 1.0;
+    for (int n = 1; n <= 8; ++n)
+    {
+        term *= -x2 / ((2 * n - 1) * (2 * n));
+        sum += term;
+    }
+    return sum;
+}
+
+// reduce to the nearest quadrant so the series stay in |x| <= pi/4
+constexpr double staticSin(double x)
+{
+    const double HALF_PI = 1.57079632679489661923;
+    double q = x / HALF_PI;
+    long long k = (long long)(q < 0 ? q - 0.5 : q + 0.5);
+    double r = x - k * HALF_PI;
+    switch (((k % 4) + 4) % 4)
+    {
+    case 0:  return staticSinReduced(r);
+    case 1:  return staticCosReduced(r);
+    case 2:  return -staticSinReduced(r);
+    default: return -staticCosReduced(r);
+    }
+}
+
+constexpr double staticCos(double x)
+{
+    const double HALF_PI = 1.57079632679489661923;
+    return staticSin(x + HALF_PI);
+}
+
+// Newton-Raphson square root, x >= 0
+constexpr double staticSqrt(double x)
+{
+    if (x <= 0)
+        return 0;
+    double r = x > 1 ? x : 1;
+    for (int i = 0; i < 64; ++i)
+    {
+        double next = 0.5 * (r + x / r);
+        if (next == r)
+            break;
+        r = next;
+    }
+    return r;
+}
+
+#endif
@@ -0,0 +1,173 @@
+#pragma once
+// Compile-time sphere with fixed tessellation
+// generates the same smooth-shaded mesh as Sphere(radius, Sectors, Stacks, true)
+// into constexpr std::arrays, so a constexpr instance is baked into read-only
+// data and costs nothing at startup:
+//
+//     constexpr StaticSphere<36, 18> tomato(0.66f);
+//     glBufferData(GL_ARRAY_BUFFER, tomato.getInterleavedVertexSize(), tomato.getInterleavedVertices(), ...);
+
+#ifndef GEOMETRY_STATIC_SPHERE_H
+#define GEOMETRY_STATIC_SPHERE_H
+
+#include <array>
+#include <type_traits>
+#include "StaticMath.h"
+
+template<int Sectors, int Stacks>
+class StaticSphere
+{
+public:
+    static_assert(Sectors >= 3, "a sphere needs at least 3 sectors");
+    static_assert(Stacks >= 2, "a sphere needs at least 2 stacks");
+
+    static constexpr unsigned int VERTEX_COUNT = (Stacks + 1) * (Sectors + 1);
+    static constexpr unsigned int INDEX_COUNT = 6 * Sectors * (Stacks - 1);
+    static constexpr unsigned int LINE_INDEX_COUNT = Sectors * (4 * Stacks - 2);
+
+    // 16-bit indices whenever every vertex can be addressed with them (0xFFFF stays free)
+    typedef typename std::conditional<VERTEX_COUNT <= 0xFFFF, unsigned short, unsigned int>::type IndexType;
+    static constexpr unsigned int INDEX_TYPE = VERTEX_COUNT <= 0xFFFF ? 0x1403 : 0x1405;   // GL_UNSIGNED_SHORT : GL_UNSIGNED_INT
+
+    // ctor
+    constexpr explicit StaticSphere(float radius = 1.0f) : radius(radius)
+    {
+        buildVertices();
+        buildIndices();
+    }
+
+    // getters
+    constexpr float getRadius() const { return radius; }
+    constexpr int getSectorCount() const { return Sectors; }
+    constexpr int getStackCount() const { return Stacks; }
+
+    // for vertex data
+    constexpr unsigned int getVertexCount() const { return VERTEX_COUNT; }
+    constexpr unsigned int getNormalCount() const { return VERTEX_COUNT; }
+    constexpr unsigned int getTexCoordCount() const { return VERTEX_COUNT; }
+    constexpr unsigned int getIndexCount() const { return INDEX_COUNT; }
+    constexpr unsigned int getLineIndexCount() const { return LINE_INDEX_COUNT; }
+    constexpr unsigned int getTriangleCount() const { return INDEX_COUNT / 3; }
+    constexpr unsigned int getVertexSize() const { return VERTEX_COUNT * 3 * sizeof(float); }
+    constexpr unsigned int getNormalSize() const { return VERTEX_COUNT * 3 * sizeof(float); }
+    constexpr unsigned int getTexCoordSize() const { return VERTEX_COUNT * 2 * sizeof(float); }
+    constexpr unsigned int getIndexSize() const { return INDEX_COUNT * sizeof(IndexType); }
+    constexpr unsigned int getLineIndexSize() const { return LINE_INDEX_COUNT * sizeof(IndexType); }
+    constexpr const float* getVertices() const { return vertices.data(); }
+    constexpr const float* getNormals() const { return normals.data(); }
+    constexpr const float* getTexCoords() const { return texCoords.data(); }
+    constexpr const IndexType* getIndices() const { return indices.data(); }
+    constexpr const IndexType* getLineIndices() const { return lineIndices.data(); }
+    constexpr unsigned int getIndexType() const { return INDEX_TYPE; }
+
+    // for interleaved vertices: V/N/T
+    constexpr unsigned int getInterleavedVertexCount() const { return VERTEX_COUNT; }
+    constexpr unsigned int getInterleavedVertexSize() const { return VERTEX_COUNT * 8 * sizeof(float); }
+    constexpr int getInterleavedStride() const { return 32; }
+    constexpr const float* getInterleavedVertices() const { return interleavedVertices.data(); }
+
+private:
+    // same parametric equation as Sphere::buildVerticesSmooth()
+    constexpr void buildVertices()
+    {
+        float sectorStep = 2 * STATIC_PI / Sectors;
+        float stackStep = STATIC_PI / Stacks;
+
+        // sin/cos of every sector angle once
+        std::array<float, Sectors + 1> sectorSines{};
+        std::array<float, Sectors + 1> sectorCosines{};
+        for (int j = 0; j <= Sectors; ++j)
+        {
+            float sectorAngle = j * sectorStep;
+            sectorSines[j] = (float)staticSin(sectorAngle);
+            sectorCosines[j] = (float)staticCos(sectorAngle);
+        }
+
+        float lengthInv = 1.0f / radius;
+        unsigned int index = 0;
+        for (int i = 0; i <= Stacks; ++i)
+        {
+            float stackAngle = STATIC_PI / 2 - i * stackStep;
+            float xy = radius * (float)staticCos(stackAngle);
+            float z = radius * (float)staticSin(stackAngle);
+            float t = (float)i / Stacks;
+
+            for (int j = 0; j <= Sectors; ++j, ++index)
+            {
+                float x = xy * sectorCosines[j];
+                float y = xy * sectorSines[j];
+                float s = (float)j / Sectors;
+                setVertex(index, x, y, z, x * lengthInv, y * lengthInv, z * lengthInv, s, t);
+            }
+        }
+    }
+
+    constexpr void buildIndices()
+    {
+        unsigned int triangle = 0;
+        unsigned int line = 0;
+        for (int i = 0; i < Stacks; ++i)
+        {
+            unsigned int k1 = i * (Sectors + 1);
+            unsigned int k2 = k1 + Sectors + 1;
+
+            for (int j = 0; j < Sectors; ++j, ++k1, ++k2)
+            {
+                if (i != 0)
+                {
+                    indices[triangle++] = (IndexType)k1;
+                    indices[triangle++] = (IndexType)k2;
+                    indices[triangle++] = (IndexType)(k1 + 1);
+                }
+
+                if (i != (Stacks - 1))
+                {
+                    indices[triangle++] = (IndexType)(k1 + 1);
+                    indices[triangle++] = (IndexType)k2;
+                    indices[triangle++] = (IndexType)(k2 + 1);
+                }
+
+                lineIndices[line++] = (IndexType)k1;
+                lineIndices[line++] = (IndexType)k2;
+                if (i != 0)
+                {
+                    lineIndices[line++] = (IndexType)k1;
+                    lineIndices[line++] = (IndexType)(k1 + 1);
+                }
+            }
+        }
+    }
+
+    constexpr void setVertex(unsigned int index, float x, float y, float z,
+        float nx, float ny, float nz, float s, float t)
+    {
+        vertices[index * 3] = x;
+        vertices[index * 3 + 1] = y;
+        vertices[index * 3 + 2] = z;
+        normals[index * 3] = nx;
+        normals[index * 3 + 1] = ny;
+        normals[index * 3 + 2] = nz;
+        texCoords[index * 2] = s;
+        texCoords[index * 2 + 1] = t;
+
+        interleavedVertices[index * 8] = x;
+        interleavedVertices[index * 8 + 1] = y;
+        interleavedVertices[index * 8 + 2] = z;
+        interleavedVertices[index * 8 + 3] = nx;
+        interleavedVertices[index * 8 + 4] = ny;
+        interleavedVertices[index * 8 + 5] = nz;
+        interleavedVertices[index * 8 + 6] = s;
+        interleavedVertices[index * 8 + 7] = t;
+    }
+
+    // memeber vars
+    float radius;
+    std::array<float, VERTEX_COUNT * 3> vertices{};
+    std::array<float, VERTEX_COUNT * 3> normals{};
+    std::array<float, VERTEX_COUNT * 2> texCoords{};
+    std::array<IndexType, INDEX_COUNT> indices{};
+    std::array<IndexType, LINE_INDEX_COUNT> lineIndices{};
+    std::array<float, VERTEX_COUNT * 8> interleavedVertices{};
+};
+
+#endif
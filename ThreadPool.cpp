@@ -0,0 +1,113 @@
+// Fixed set of worker threads for data-parallel loops
+
+#include <algorithm>
+#include "ThreadPool.h"
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor/dtor
+///////////////////////////////////////////////////////////////////////////////
+ThreadPool::ThreadPool(unsigned int threadCount) : body(nullptr), rangeEnd(0), chunkSize(1),
+    nextIndex(0), busyWorkers(0), generation(0), stopping(false)
+{
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    // the calling thread is the last one
+    for (unsigned int i = 1; i < threadCount; ++i)
+        workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+
+    for (std::size_t i = 0; i < workers.size(); ++i)
+        workers[i].join();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// publish the range, work on it together with the workers, wait for them
+///////////////////////////////////////////////////////////////////////////////
+void ThreadPool::parallelFor(int begin, int end, const std::function<void(int, int)>& body)
+{
+    if (begin >= end)
+        return;
+
+    // nothing to share
+    if (workers.empty() || end - begin == 1)
+    {
+        body(begin, end);
+        return;
+    }
+
+    std::lock_guard<std::mutex> callLock(callMutex);
+
+    {
+        // a few chunks per thread so an unlucky slow thread does not hold everyone
+        int chunkCount = (int)getThreadCount() * 4;
+        std::lock_guard<std::mutex> lock(mutex);
+        this->body = &body;
+        rangeEnd = end;
+        chunkSize = std::max(1, (end - begin + chunkCount - 1) / chunkCount);
+        nextIndex.store(begin);
+        busyWorkers = (unsigned int)workers.size();
+        ++generation;
+    }
+    wakeCondition.notify_all();
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [this] { return busyWorkers == 0; });
+    this->body = nullptr;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// take chunks until the range is exhausted
+///////////////////////////////////////////////////////////////////////////////
+void ThreadPool::runChunks()
+{
+    for (;;)
+    {
+        int first = nextIndex.fetch_add(chunkSize);
+        if (first >= rangeEnd)
+            break;
+        (*body)(first, std::min(first + chunkSize, rangeEnd));
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// sleep until a new job (or shutdown), help with it, report back
+///////////////////////////////////////////////////////////////////////////////
+void ThreadPool::workerLoop()
+{
+    unsigned int seenGeneration = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeCondition.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping)
+                return;
+            seenGeneration = generation;
+        }
+
+        runChunks();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busyWorkers == 0)
+            doneCondition.notify_one();
+    }
+}
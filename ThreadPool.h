@@ -0,0 +1,53 @@
+#pragma once
+// Fixed set of worker threads for data-parallel loops
+// parallelFor() splits an index range into chunks that the workers and the
+// calling thread pull until the range is exhausted, then returns. Workers sleep
+// between calls, so one pool can be kept around and reused for every build.
+
+#ifndef GEOMETRY_THREAD_POOL_H
+#define GEOMETRY_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    // ctor/dtor
+    // threadCount includes the calling thread; 0 = one per hardware thread
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    // # of threads sharing a parallelFor(), including the caller
+    unsigned int getThreadCount() const { return (unsigned int)workers.size() + 1; }
+
+    // call body(first, last) over disjoint sub-ranges covering [begin, end)
+    // blocks until every sub-range is done; calls from several threads are serialized
+    void parallelFor(int begin, int end, const std::function<void(int, int)>& body);
+
+private:
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void workerLoop();
+    void runChunks();
+
+    std::vector<std::thread> workers;
+    std::mutex callMutex;                   // one parallelFor() at a time
+    std::mutex mutex;                       // guards the job description below
+    std::condition_variable wakeCondition;  // workers wait for a new job
+    std::condition_variable doneCondition;  // caller waits for the workers
+    const std::function<void(int, int)>* body;
+    int rangeEnd;
+    int chunkSize;
+    std::atomic<int> nextIndex;             // first index of the next chunk to take
+    unsigned int busyWorkers;
+    unsigned int generation;                // bumped for every job
+    bool stopping;
+};
+
+#endif
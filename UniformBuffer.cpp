@@ -0,0 +1,66 @@
+// Uniform buffer object bound to a fixed binding point
+
+#include "UniformBuffer.h"
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctor/dtor
+///////////////////////////////////////////////////////////////////////////////
+UniformBuffer::UniformBuffer() : id(0), binding(0), size(0)
+{
+}
+
+UniformBuffer::~UniformBuffer()
+{
+    release();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// the storage is allocated once; update() only copies into it
+///////////////////////////////////////////////////////////////////////////////
+void UniformBuffer::create(GLuint binding, GLsizeiptr size)
+{
+    if (!id)
+        glGenBuffers(1, &id);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, id);
+    glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, id);
+
+    this->binding = binding;
+    this->size = size;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// copy the new data; the binding point is left as it is
+///////////////////////////////////////////////////////////////////////////////
+void UniformBuffer::update(const void* data, GLsizeiptr size)
+{
+    if (!id || size > this->size)
+        return;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, id);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// delete the buffer
+///////////////////////////////////////////////////////////////////////////////
+void UniformBuffer::release()
+{
+    if (!id)
+        return;
+
+    glDeleteBuffers(1, &id);
+    id = 0;
+    size = 0;
+}
@@ -0,0 +1,42 @@
+#pragma once
+// Uniform buffer object bound to a fixed binding point
+// holds a uniform block's data, e.g. a std140 struct, for every program that
+// declares the block with layout(binding = ...); written once per frame with
+// one call instead of a glUniform*() per value and per program
+// owns the buffer and deletes it on destruction; the GL context must be
+// current for both
+
+#ifndef GEOMETRY_UNIFORM_BUFFER_H
+#define GEOMETRY_UNIFORM_BUFFER_H
+
+#include <GL/glew.h>
+
+class UniformBuffer
+{
+public:
+    // ctor/dtor
+    UniformBuffer();
+    ~UniformBuffer();
+
+    // allocate size bytes and bind the buffer to the binding point; it stays
+    // bound there, nothing else in the program uses uniform buffer bindings
+    void create(GLuint binding, GLsizeiptr size);
+    // replace the first size bytes
+    void update(const void* data, GLsizeiptr size);
+    void release();
+
+    GLuint getId() const { return id; }
+    GLuint getBinding() const { return binding; }
+    GLsizeiptr getSize() const { return size; }
+
+private:
+    // buffers are not shared between objects
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    GLuint id;
+    GLuint binding;
+    GLsizeiptr size;
+};
+
+#endif
@@ -0,0 +1,147 @@
+// Vertex layouts for uploading interleaved V/N/T vertices
+
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include "VertexFormat.h"
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// # of bytes per vertex
+///////////////////////////////////////////////////////////////////////////////
+int getVertexFormatStride(VertexFormat format)
+{
+    if (format == VERTEX_FORMAT_PACKED)
+        return sizeof(PackedVertex);
+    return 8 * sizeof(float);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// convert interleaved float vertices (x,y,z, nx,ny,nz, s,t) to PackedVertex
+///////////////////////////////////////////////////////////////////////////////
+void packVertices(const float* interleavedVertices, unsigned int count, PackedVertex* packedVertices)
+{
+    const float* src = interleavedVertices;
+    PackedVertex* dst = packedVertices;
+    for (unsigned int i = 0; i < count; ++i, src += 8, ++dst)
+    {
+        dst->position[0] = packHalf(src[0]);
+        dst->position[1] = packHalf(src[1]);
+        dst->position[2] = packHalf(src[2]);
+        dst->position[3] = 0x3C00;                  // 1.0
+        dst->normal = packSnorm1010102(src[3], src[4], src[5]);
+        dst->texCoord[0] = packUnorm16(src[6]);
+        dst->texCoord[1] = packUnorm16(src[7]);
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// describe the layout to GL
+// the packed normal uses 4 components (w = 0) as required for packed types;
+// the shader reads it as vec3
+///////////////////////////////////////////////////////////////////////////////
+void setVertexFormatAttributes(VertexFormat format)
+{
+    if (format == VERTEX_FORMAT_PACKED)
+    {
+        const GLsizei stride = sizeof(PackedVertex);
+        glVertexAttribPointer(0, 4, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, position));
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(PackedVertex, normal));
+        glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, texCoord));
+    }
+    else
+    {
+        const GLsizei stride = 8 * sizeof(float);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, 0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
+    }
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// float to IEEE half, rounded to nearest even
+///////////////////////////////////////////////////////////////////////////////
+GLushort packHalf(float value)
+{
+    unsigned int bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    unsigned int sign = (bits >> 16) & 0x8000;
+    unsigned int absBits = bits & 0x7FFFFFFF;
+
+    // inf, nan
+    if (absBits >= 0x7F800000)
+        return (GLushort)(sign | 0x7C00 | (absBits > 0x7F800000 ? 0x200 : 0));
+
+    // rounds to 65520 or more: overflow to inf
+    if (absBits >= 0x477FF000)
+        return (GLushort)(sign | 0x7C00);
+
+    // below half of the smallest subnormal (2^-25): zero
+    if (absBits < 0x33000000)
+        return (GLushort)sign;
+
+    unsigned int half;
+    unsigned int remainder;
+    unsigned int halfway;
+    if (absBits < 0x38800000)
+    {
+        // subnormal half: shift the mantissa with its implicit bit into 2^-24 units
+        unsigned int shift = 126 - (absBits >> 23);
+        unsigned int mantissa = (absBits & 0x7FFFFF) | 0x800000;
+        half = mantissa >> shift;
+        remainder = mantissa & ((1u << shift) - 1);
+        halfway = 1u << (shift - 1);
+    }
+    else
+    {
+        // normal half: rebias the exponent from 127 to 15, drop 13 mantissa bits
+        half = (absBits - 0x38000000) >> 13;
+        remainder = absBits & 0x1FFF;
+        halfway = 0x1000;
+    }
+
+    // a carry out of the mantissa correctly bumps the exponent
+    if (remainder > halfway || (remainder == halfway && (half & 1)))
+        ++half;
+    return (GLushort)(sign | half);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// 3 signed normalized 10-bit components, 2-bit w = 0
+// decoded by GL 4.2+ as max(c / 511, -1)
+///////////////////////////////////////////////////////////////////////////////
+GLuint packSnorm1010102(float x, float y, float z)
+{
+    const float v[3] = { x, y, z };
+    GLuint packed = 0;
+    for (int i = 0; i < 3; ++i)
+    {
+        float c = v[i] < -1.0f ? -1.0f : (v[i] > 1.0f ? 1.0f : v[i]);
+        int snorm = (int)std::floor(c * 511.0f + 0.5f);
+        packed |= ((GLuint)snorm & 0x3FF) << (10 * i);
+    }
+    return packed;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// [0, 1] to 16-bit unsigned normalized
+///////////////////////////////////////////////////////////////////////////////
+GLushort packUnorm16(float value)
+{
+    float c = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+    return (GLushort)(c * 65535.0f + 0.5f);
+}
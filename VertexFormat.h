@@ -0,0 +1,42 @@
+#pragma once
+// Vertex layouts for uploading interleaved V/N/T vertices
+// VERTEX_FORMAT_FLOAT:  3 float position, 3 float normal, 2 float tex coord = 32 bytes
+// VERTEX_FORMAT_PACKED: 4 half position (w = 1), normal in signed 10:10:10:2,
+//                       2 unsigned normalized 16-bit tex coords      = 16 bytes
+// both feed the same shader inputs: 0 = position, 1 = normal, 2 = tex coord
+
+#ifndef GEOMETRY_VERTEX_FORMAT_H
+#define GEOMETRY_VERTEX_FORMAT_H
+
+#include <GL/glew.h>
+
+enum VertexFormat
+{
+    VERTEX_FORMAT_FLOAT = 0,
+    VERTEX_FORMAT_PACKED
+};
+
+struct PackedVertex
+{
+    GLushort position[4];           // half floats
+    GLuint normal;                  // GL_INT_2_10_10_10_REV, normalized
+    GLushort texCoord[2];           // normalized to [0, 1]
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must be 16 bytes");
+
+// # of bytes per vertex
+int getVertexFormatStride(VertexFormat format);
+
+// convert count interleaved V/N/T float vertices (8 floats each)
+// tex coords are clamped to [0, 1], normals to [-1, 1]
+void packVertices(const float* interleavedVertices, unsigned int count, PackedVertex* packedVertices);
+
+// set and enable attributes 0/1/2 for the bound VAO and GL_ARRAY_BUFFER
+void setVertexFormatAttributes(VertexFormat format);
+
+// scalar conversions used by packVertices()
+GLushort packHalf(float value);
+GLuint packSnorm1010102(float x, float y, float z);
+GLushort packUnorm16(float value);
+
+#endif